@@ -2,10 +2,13 @@
 
 #include <unistd.h>
 #include <sys/reboot.h>
+#include <algorithm>
 #include <charconv>
+#include <iterator>
 
 #include "control.h"
 #include "input.h"
+#include "intent.h"
 #include "logger.h"
 #include "notification.h"
 #include "reports.h"
@@ -14,6 +17,102 @@
 // Constants
 //
 
+// The maximum amount of time to wait for the reboot notification to finish.
+static constexpr std::chrono::seconds kRebootDelayDuration{ 60 };
+
+// Types
+//
+
+// A word that stands for a command token.
+struct CommandKeyword
+{
+	// The word, in lowercase.
+	std::string_view m_name;
+
+	// The token it stands for.
+	CommandToken::Types m_type;
+};
+
+// Constants
+//
+
+// The words that stand for command tokens, sorted so that they can be binary searched.
+static constexpr CommandKeyword kCommandKeywords[] =
+{
+	{ "back",		CommandToken::kTypeBack },
+	{ "down",		CommandToken::kTypeLower },	// Alternative.
+	{ "elevation",	CommandToken::kTypeElevation },
+	{ "legs",		CommandToken::kTypeLegs },
+	{ "lower",		CommandToken::kTypeLower },
+	{ "no",			CommandToken::kTypeNo },
+	{ "raise",		CommandToken::kTypeRaise },
+	{ "reboot",		CommandToken::kTypeReboot },
+	{ "routine",	CommandToken::kTypeRoutine },
+	{ "start",		CommandToken::kTypeStart },
+	{ "status",		CommandToken::kTypeStatus },
+	{ "stop",		CommandToken::kTypeStop },
+	{ "up",			CommandToken::kTypeRaise },	// Alternative.
+	{ "yes",			CommandToken::kTypeYes },
+
+	// "integer", 	kTypeInteger
+};
+
+// Check that the keywords are sorted, because the lookup depends on it.
+//
+// Returns:	True if the keywords are sorted, false otherwise.
+//
+static constexpr bool CommandKeywordsAreSorted()
+{
+	for (std::size_t keywordIndex = 1u; keywordIndex < std::size(kCommandKeywords); keywordIndex++)
+	{
+		if ((kCommandKeywords[keywordIndex - 1u].m_name < kCommandKeywords[keywordIndex].m_name) ==
+			 false)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static_assert(CommandKeywordsAreSorted() == true, "The command keywords must be sorted by name.");
+
+// Get the length of the longest keyword.
+//
+// Returns:	The length.
+//
+static constexpr std::size_t CommandGetMaxKeywordLength()
+{
+	std::size_t maxLength = 0u;
+
+	for (auto const& keyword : kCommandKeywords)
+	{
+		maxLength = std::max(maxLength, keyword.m_name.size());
+	}
+
+	return maxLength;
+}
+
+// Nothing longer than this can be a keyword.
+static constexpr std::size_t kCommandMaxKeywordLength{ CommandGetMaxKeywordLength() };
+
+// The characters that separate the words of a command.
+static constexpr std::string_view kCommandWordSeparators{ " \t\r\n" };
+
+// The names of the controls that the control tokens refer to, indexed by token type.
+static constexpr char const* const kCommandControlNames[] =
+{
+	"back",	// kTypeBack
+	"legs",	// kTypeLegs
+	"elev",	// kTypeElevation
+};
+
+static constexpr unsigned int kCommandControlCount{ std::size(kCommandControlNames) };
+
+static_assert((CommandToken::kTypeBack == 0) && (CommandToken::kTypeLegs == 1) &&
+				  (CommandToken::kTypeElevation == 2) &&
+				  (kCommandControlCount == CommandToken::kTypeElevation + 1),
+				  "The control names must line up with the control token types.");
 
 // Locals
 //
@@ -37,30 +136,15 @@ static constexpr char const* const kCommandTokenNames[] =
 	"integer", 		// kTypeInteger
 };
 
-// A mapping between token names and token type.
-static std::map<std::string, CommandToken::Types> const s_commandTokenNameToTypeMap = 
+// The controls that the control tokens refer to, indexed by token type. They're looked up once, so
+// that commands don't have to.
+static ControlHandle s_commandControlHandles[kCommandControlCount] =
 {
-	{ "back", 		CommandToken::kTypeBack }, 
-	{ "legs",		CommandToken::kTypeLegs },
-	{ "elevation",	CommandToken::kTypeElevation },
-	{ "raise",		CommandToken::kTypeRaise },
-	{ "up",			CommandToken::kTypeRaise },	// Alternative.
-	{ "lower",		CommandToken::kTypeLower },
-	{ "down",		CommandToken::kTypeLower },	// Alternative.
-	{ "stop",		CommandToken::kTypeStop },
-	{ "routine",	CommandToken::kTypeRoutine },
-	{ "start",		CommandToken::kTypeStart },
-	{ "status",		CommandToken::kTypeStatus },
-	{ "reboot", 	CommandToken::kTypeReboot }, 
-	{ "yes", 		CommandToken::kTypeYes }, 
-	{ "no", 			CommandToken::kTypeNo },
-
-	// "integer", 	kTypeInteger
+	kInvalidControlHandle,
+	kInvalidControlHandle,
+	kInvalidControlHandle,
 };
 
-// Keep a handle to the input.
-static Input const* s_input = nullptr;
-
 // Signals whether we are in the process of rebooting.
 static bool s_rebooting = false;
 
@@ -72,18 +156,31 @@ static Time s_rebootDelayStartTime;
 
 // Initialize the system.
 //
-// input:	The input device.
-//
-void CommandInitialize(Input const& input)
+void CommandInitialize()
 {
-	s_input = &input;
+	// The controls should already have been created.
+	for (unsigned int controlIndex = 0u; controlIndex < kCommandControlCount; controlIndex++)
+	{
+		auto const* const controlName = kCommandControlNames[controlIndex];
+		s_commandControlHandles[controlIndex] = Control::GetHandleByName(controlName);
+
+		if (s_commandControlHandles[controlIndex] == kInvalidControlHandle)
+		{
+			Logger::WriteLine(Shell::Yellow("There is no control \""), controlName,
+									Shell::Yellow("\", so \""), kCommandTokenNames[controlIndex],
+									Shell::Yellow("\" commands will be ignored."));
+		}
+	}
 }
 
 // Uninitialize the system.
 //
 void CommandUninitialize()
 {
-	s_input = nullptr;
+	for (auto& controlHandle : s_commandControlHandles)
+	{
+		controlHandle = kInvalidControlHandle;
+	}
 }
 
 // Process the system.
@@ -119,20 +216,39 @@ void CommandProcess()
 	}
 
 	// Wait for a maximum amount of time regardless.
-	Time rebootDelayCurrentTime;
-	TimerGetCurrent(rebootDelayCurrentTime);
-	
-	float const durationMS = TimerGetElapsedMilliseconds(s_rebootDelayStartTime, 
-																		  rebootDelayCurrentTime);
+	if (TimerClock::now() >= s_rebootDelayStartTime + kRebootDelayDuration)
+	{
+		DoReboot();
+	}
+}
 
-	auto const durationSeconds{static_cast<unsigned long>(durationMS) / 1'000};
+// Get the next time that the system needs to be processed, if any.
+//
+// deadline:	(Output) The time by which the system needs to be processed.
+//
+// Returns:	True if the system needs to be processed again, false otherwise.
+//
+bool CommandGetNextDeadline(Time& deadline)
+{
+	if (s_rebooting == false)
+	{
+		return false;
+	}
 
-	static constexpr unsigned long kDelayDurationSeconds{60u};
+	// The notification may have finished after we last checked, like when MQTT is processed after us
+	// in the same pass, so check again right away.
+	Time notificationFinishedTime;
+	NotificationGetLastPlayFinishedTime(notificationFinishedTime);
 
-	if (durationSeconds >= kDelayDurationSeconds)
+	if (notificationFinishedTime > s_rebootDelayStartTime)
 	{
-		DoReboot();
+		deadline = TimerClock::now();
+		return true;
 	}
+
+	// Otherwise, the notification finishing will wake us up, or we wait for the maximum delay.
+	deadline = s_rebootDelayStartTime + kRebootDelayDuration;
+	return true;
 }
 
 // Parse the command tokens into commands.
@@ -141,7 +257,7 @@ void CommandProcess()
 //
 // Returns:	A value signifying the result of the parsing.
 //
-CommandParseTokensReturnTypes CommandParseTokens(std::vector<CommandToken> const& commandTokens)
+CommandParseTokensReturnTypes CommandParseTokens(CommandTokenList const& commandTokens)
 {
 	char const* confirmationText = nullptr;
 	return CommandParseTokens(confirmationText, commandTokens);
@@ -156,10 +272,10 @@ CommandParseTokensReturnTypes CommandParseTokens(std::vector<CommandToken> const
 // Returns:	A value signifying the result of the parsing.
 //
 CommandParseTokensReturnTypes CommandParseTokens(char const*& confirmationText, 
-	std::vector<CommandToken> const& commandTokens)
+	CommandTokenList const& commandTokens)
 {
 	// Parse command tokens.
-	auto const tokenCount = static_cast<unsigned int>(commandTokens.size());
+	auto const tokenCount = commandTokens.GetCount();
 	for (unsigned int tokenIndex = 0; tokenIndex < tokenCount; tokenIndex++)
 	{
 		// Parse commands.
@@ -171,36 +287,7 @@ CommandParseTokensReturnTypes CommandParseTokens(char const*& confirmationText,
 			case CommandToken::kTypeElevation:	
 			{
 				// Try to access the control corresponding to the command token.
-				Control* control = nullptr;
-				
-				switch (token.m_type)
-				{
-					case CommandToken::kTypeBack:
-					{
-						control = Control::GetByName("back");
-					}
-					break;
-					
-					case CommandToken::kTypeLegs:
-					{						
-						control = Control::GetByName("legs");
-					}
-					break;
-					
-					case CommandToken::kTypeElevation:
-					{
-						control = Control::GetByName("elev");
-					}
-					break;
-					
-					default:
-					{
-						Logger::WriteLine("Unrecognized token \"", kCommandTokenNames[token.m_type],
-												"\" trying to process a control movement "
-												"command.");
-					}
-					break;
-				}
+				auto* const control = Control::GetByHandle(s_commandControlHandles[token.m_type]);
 			
 				if (control == nullptr)
 				{
@@ -301,7 +388,7 @@ CommandParseTokensReturnTypes CommandParseTokens(char const*& confirmationText,
 					NotificationPlay("routine_running");
 				}
 				
-				if ((s_input != nullptr) && (s_input->IsConnected() == true))
+				if (InputsGetConnectedCount() > 0u)
 				{
 					NotificationPlay("control_connected");
 				}
@@ -333,7 +420,7 @@ CommandParseTokensReturnTypes CommandParseTokens(char const*& confirmationText,
 
 				// Kick off the reboot.
 				s_rebooting = true;
-				TimerGetCurrent(s_rebootDelayStartTime);
+				s_rebootDelayStartTime = TimerClock::now();
 
 				Logger::WriteLine("Reboot starting!");
 				NotificationPlay("restarting");
@@ -351,53 +438,70 @@ CommandParseTokensReturnTypes CommandParseTokens(char const*& confirmationText,
 	return CommandParseTokensReturnTypes::kInvalid;
 }
 
-// Take a token string and convert it into a token type, if possible.
+// Take a token string and convert it into a token type, if possible. Case is ignored.
 //
 // tokenString:	The string to attempt to convert.
 // 
 // Returns:	The corresponding token type or invalid if one couldn't be found.
 // 
-static CommandToken::Types CommandConvertStringToTokenType(std::string const& tokenString)
+static CommandToken::Types CommandConvertStringToTokenType(std::string_view tokenString)
 {
-	// Try to find it in the map.
-	auto const resultIterator = s_commandTokenNameToTypeMap.find(tokenString);
+	// Anything longer than every keyword can't match, which also lets us lowercase on the stack.
+	if (tokenString.size() > kCommandMaxKeywordLength)
+	{
+		return CommandToken::kTypeInvalid;
+	}
+
+	char lowercaseBuffer[kCommandMaxKeywordLength];
+
+	for (std::size_t characterIndex = 0u; characterIndex < tokenString.size(); characterIndex++)
+	{
+		auto const character = tokenString[characterIndex];
+		lowercaseBuffer[characterIndex] = ((character >= 'A') && (character <= 'Z')) ?
+			static_cast<char>(character - 'A' + 'a') : character;
+	}
+
+	std::string_view const lowercaseTokenString(lowercaseBuffer, tokenString.size());
 
-	if (resultIterator == s_commandTokenNameToTypeMap.end()) 
-	{		
+	// Try to find it in the table.
+	auto const IsBefore = [](CommandKeyword const& keyword, std::string_view name)
+	{
+		return keyword.m_name < name;
+	};
+
+	auto const keywordIterator = std::lower_bound(std::begin(kCommandKeywords),
+																 std::end(kCommandKeywords), lowercaseTokenString,
+																 IsBefore);
+
+	if ((keywordIterator == std::end(kCommandKeywords)) ||
+		 (keywordIterator->m_name != lowercaseTokenString))
+	{
 		// No match.
 		return CommandToken::kTypeInvalid;
 	}
 
 	// Found it!
-	return resultIterator->second;
+	return keywordIterator->m_type;
 }
 
-// Take a command string and turn it into a list of tokens.
+// Take a command string and turn it into a list of tokens. Words are separated by whitespace and
+// matched regardless of case.
 //
 // commandTokens:	(Output) The resulting command tokens, in order.
 // commandString:	The command string to tokenize.
 //
-void CommandTokenizeString(std::vector<CommandToken>& commandTokens, 
-	std::string const& commandString)
+void CommandTokenizeString(CommandTokenList& commandTokens, std::string_view commandString)
 {
 	// Get the first token string start.
-	auto nextTokenStringStart = std::string::size_type{0};
+	auto tokenStringStart = commandString.find_first_not_of(kCommandWordSeparators);
 
-	while (nextTokenStringStart != std::string::npos)
+	while (tokenStringStart != std::string_view::npos)
 	{
-		// Get the next token string end.
-		auto const nextTokenStringEnd = commandString.find(' ', nextTokenStringStart);
-
-		// Get the token string.
-		auto const tokenStringLength = (nextTokenStringEnd != std::string::npos) ? 
-			(nextTokenStringEnd - nextTokenStringStart) : commandString.size();
-		auto tokenString = commandString.substr(nextTokenStringStart, tokenStringLength);
-
-		// Make sure the token string is lowercase.
-		for (auto& character : tokenString)
-		{
-			character = std::tolower(character, std::locale::classic());
-		}
+		// Get the token string, which runs to the next separator or the end.
+		auto const tokenStringEnd = commandString.find_first_of(kCommandWordSeparators,
+																				  tokenStringStart);
+		auto const tokenString = commandString.substr(tokenStringStart,
+																	 tokenStringEnd - tokenStringStart);
 
 		// Match the token string to a token (with no parameter) if possible.
 		CommandToken token;
@@ -406,160 +510,71 @@ void CommandTokenizeString(std::vector<CommandToken>& commandTokens,
 		// If we couldn't turn it into a plain old token, see if it is a parameter token.
 		if (token.m_type == CommandToken::kTypeInvalid)
 		{
-			std::string_view const tokenStringView(tokenString);
-
 			// Attempt to parse the string into a number; save result into `token.m_parameter`.
-			auto const [endPointer, errorCode] = std::from_chars(tokenStringView.begin(),
-																				  tokenStringView.end(),
+			auto const* const tokenStringEndPointer = tokenString.data() + tokenString.size();
+			auto const [endPointer, errorCode] = std::from_chars(tokenString.data(),
+																				  tokenStringEndPointer,
 																				  token.m_parameter);
 
 			// Check if successfully parsed to number and matched whole string.
-			if (errorCode == std::errc() and endPointer == tokenStringView.end())
+			if (errorCode == std::errc() and endPointer == tokenStringEndPointer)
 			{
 				token.m_type = CommandToken::kTypeInteger;
 			}
-
-		}
-
-		// Add the token to the list.
-		commandTokens.push_back(token);
-
-		// Get the next token string start (skip delimiter).
-		nextTokenStringStart = nextTokenStringEnd;
-
-		if (nextTokenStringEnd != std::string::npos)
-		{
-			nextTokenStringStart++;
-		}
-	}
-}
-
-// Just a simple structure to store a slot name/value pair.
-//
-struct SlotNameValue
-{
-	std::string	m_name;
-	std::string	m_value;
-};
-
-// Extract the slots from a JSON document.
-//
-// extractedSlots:		(Output) The slot name/value pairs that we found.
-// commandDocument:	The command document to get the slots for.
-//
-static void CommandExtractSlotsFromJSONDocument(std::vector<SlotNameValue>& extractedSlots, 
-	rapidjson::Document const& commandDocument)
-{
-	auto const slotsIterator = commandDocument.FindMember("slots");
-
-	if (slotsIterator == commandDocument.MemberEnd())
-	{
-		return;
-	}
-
-	auto const& slots = slotsIterator->value;
-
-	if (slots.IsArray() == false)
-	{
-		return;
-	}
-
-	// Now extract each slot individually.
-	for (auto const& slot : slots.GetArray())
-	{
-		if (slot.IsObject() == false) 
-		{
-			continue;
 		}
 
-		// Try to find the slot name.
-		auto const slotNameIterator = slot.FindMember("slotName");
-
-		if (slotNameIterator == slot.MemberEnd()) 
+		// Add the token to the list. No command is long enough to fill it, so ignore the rest.
+		if (commandTokens.Add(token) == false)
 		{
-			continue;
-		}
-
-		auto const& slotName = slotNameIterator->value;
-
-		if (slotName.IsString() == false) 
-		{
-			continue;
-		}
-
-		// Now try to find the value.
-		auto const slotValueIterator = slot.FindMember("rawValue");
-
-		if (slotValueIterator == slot.MemberEnd()) 
-		{
-			continue;
-		}
-
-		auto const& slotValue = slotValueIterator->value;
-
-		if (slotValue.IsString() == false) 
-		{
-			continue;
+			break;
 		}
-		
-		// Now that we found the name and the value, we can add it to the output.
-		SlotNameValue extractedSlot;
-		extractedSlot.m_name = slotName.GetString();
-		extractedSlot.m_value = slotValue.GetString();
 
-		extractedSlots.push_back(extractedSlot);
+		// Get the next token string start (skip separators).
+		tokenStringStart = commandString.find_first_not_of(kCommandWordSeparators, tokenStringEnd);
 	}
 }
 
-// Take a command JSON document and turn it into a list of tokens.
+// Take an intent and turn it into a list of tokens.
 //
-// commandTokens:		(Input/Output) The resulting command tokens, in order. If there was a 
-// 							command pending confirmation, the corresponding tokens will be passed in.
-// commandDocument:	The command document to tokenize.
+// commandTokens:	(Input/Output) The resulting command tokens, in order. If there was a command
+// 					pending confirmation, the corresponding tokens will be passed in.
+// intent:			The intent to tokenize.
 //
-void CommandTokenizeJSONDocument(std::vector<CommandToken>& commandTokens,
-											rapidjson::Document const& commandDocument)
+void CommandTokenizeIntent(CommandTokenList& commandTokens, IntentMessage const& intent)
 {
-	// First we need the intent, then the name of the intent.
-	auto const intentIterator = commandDocument.FindMember("intent");
-
-	if (intentIterator == commandDocument.MemberEnd())
-	{
-		return;
-	}
-
-	auto const intentNameIterator = intentIterator->value.FindMember("intentName");
-
-	if (intentNameIterator == commandDocument.MemberEnd())
+	// We need the name of the intent.
+	if (intent.m_intentName.empty() == true)
 	{
 		return;
 	}
 
 	// Now, try to recognize the intent.
-	auto const intentName = intentNameIterator->value.GetString();
+	auto const intentName = intent.m_intentName;
+
+	// Slots are looked at in the order they were given.
+	auto const slotsBegin = intent.m_slots.begin();
+	auto const slotsEnd = slotsBegin + intent.m_slotCount;
 
 	// We handle confirmations first so we can short-circuit more easily.
-	if (strcmp(intentName, "ConfirmationResponse") == 0)
+	if (intentName == "ConfirmationResponse")
 	{
 		// We can ignore this if we are not waiting for confirmation.
-		if (commandTokens.empty() == true)
+		if (commandTokens.IsEmpty() == true)
 		{
 			Logger::WriteLine("Received a confirmation response, but wasn't waiting for confirmation. "
 									"Ignoring.");
 			return;
 		}
 
-		// We need to get the slots so that we can get the necessary parameters.
-		std::vector<SlotNameValue> slots;
-		CommandExtractSlotsFromJSONDocument(slots, commandDocument);
-
 		// We are looking to fill out one token, the response. 
 		CommandToken responseToken;
 
-		for (auto const& slot : slots)
-		{			
+		for (auto slotIterator = slotsBegin; slotIterator != slotsEnd; slotIterator++)
+		{
+			auto const& slot = *slotIterator;
+
 			// This is the response slot.
-			if (slot.m_name.compare("response") == 0)
+			if (slot.m_name == "response")
 			{
 				responseToken.m_type = CommandConvertStringToTokenType(slot.m_value);
 			}		
@@ -569,7 +584,7 @@ void CommandTokenizeJSONDocument(std::vector<CommandToken>& commandTokens,
 		{
 			// It's important in this case that we clear the command tokens so that we don't attempt 
 			// to process the pending command.
-			commandTokens.clear();
+			commandTokens.Clear();
 
 			Logger::WriteLine("Couldn't recognize a ", intentName,
 									" intent because of invalid parameters.");
@@ -579,20 +594,20 @@ void CommandTokenizeJSONDocument(std::vector<CommandToken>& commandTokens,
 		Logger::WriteLine("Recognized a ", intentName, " intent.");
 
 		// Now that we theoretically have a set of valid tokens, add them to the output.
-		commandTokens.push_back(responseToken);
+		commandTokens.Add(responseToken);
 		return;
 	}
-	else if (commandTokens.empty() == false)
+	else if (commandTokens.IsEmpty() == false)
 	{
 		// If we were waiting on confirmation but got something else instead, ignore it.
-		commandTokens.clear();
+		commandTokens.Clear();
 
 		Logger::WriteLine("Ignoring intent ", intentName,
 								" because there was a command pending confirmation.");
 		return;
 	}
 
-	if (strcmp(intentName, "GetStatus") == 0)
+	if (intentName == "GetStatus")
 	{
 		Logger::WriteLine("Recognized a ", intentName, " intent.");
 
@@ -600,31 +615,29 @@ void CommandTokenizeJSONDocument(std::vector<CommandToken>& commandTokens,
 		CommandToken token;
 		token.m_type = CommandToken::kTypeStatus;
 
-		commandTokens.push_back(token);
+		commandTokens.Add(token);
 		return;
 	}
 
-	if (strcmp(intentName, "MovePart") == 0)
+	if (intentName == "MovePart")
 	{
-		// We need to get the slots so that we can get the necessary parameters.
-		std::vector<SlotNameValue> slots;
-		CommandExtractSlotsFromJSONDocument(slots, commandDocument);
-
 		// We are looking to fill out two tokens, the part and the direction.
 		CommandToken partToken;
 		CommandToken directionToken;
 
-		for (auto const& slot : slots)
+		for (auto slotIterator = slotsBegin; slotIterator != slotsEnd; slotIterator++)
 		{
+			auto const& slot = *slotIterator;
+
 			// This is the part slot.
-			if (slot.m_name.compare("name") == 0)
+			if (slot.m_name == "name")
 			{
 				partToken.m_type = CommandConvertStringToTokenType(slot.m_value);
 				continue;
 			}
 
 			// This is the direction slot.
-			if (slot.m_name.compare("direction") == 0)
+			if (slot.m_name == "direction")
 			{
 				directionToken.m_type = CommandConvertStringToTokenType(slot.m_value);
 				continue;
@@ -642,27 +655,25 @@ void CommandTokenizeJSONDocument(std::vector<CommandToken>& commandTokens,
 		Logger::WriteLine("Recognized a ", intentName, " intent.");
 
 		// Now that we theoretically have a set of valid tokens, add them to the output.
-		commandTokens.push_back(partToken);
-		commandTokens.push_back(directionToken);
+		commandTokens.Add(partToken);
+		commandTokens.Add(directionToken);
 		return;
 	}
 
-	if (strcmp(intentName, "SetRoutine") == 0)
+	if (intentName == "SetRoutine")
 	{
-		// We need to get the slots so that we can get the necessary parameters.
-		std::vector<SlotNameValue> slots;
-		CommandExtractSlotsFromJSONDocument(slots, commandDocument);
-
 		// We are looking to fill out one token, what to do to the routine.
 		CommandToken routineToken;
 		routineToken.m_type = CommandToken::kTypeRoutine;
 
 		CommandToken actionToken;
 
-		for (auto const& slot : slots)
+		for (auto slotIterator = slotsBegin; slotIterator != slotsEnd; slotIterator++)
 		{
+			auto const& slot = *slotIterator;
+
 			// This is the action slot.
-			if (slot.m_name.compare("action") == 0)
+			if (slot.m_name == "action")
 			{
 				actionToken.m_type = CommandConvertStringToTokenType(slot.m_value);
 				continue;
@@ -679,12 +690,12 @@ void CommandTokenizeJSONDocument(std::vector<CommandToken>& commandTokens,
 		Logger::WriteLine("Recognized a ", intentName, " intent.");
 
 		// Now that we theoretically have a set of valid tokens, add them to the output.
-		commandTokens.push_back(routineToken);
-		commandTokens.push_back(actionToken);
+		commandTokens.Add(routineToken);
+		commandTokens.Add(actionToken);
 		return;
 	}
 
-	if (strcmp(intentName, "Reboot") == 0)
+	if (intentName == "Reboot")
 	{
 		Logger::WriteLine("Recognized a ", intentName, " intent.");
 
@@ -692,7 +703,7 @@ void CommandTokenizeJSONDocument(std::vector<CommandToken>& commandTokens,
 		CommandToken token;
 		token.m_type = CommandToken::kTypeReboot;
 
-		commandTokens.push_back(token);
+		commandTokens.Add(token);
 		return;
 	}
 
@@ -1,10 +1,10 @@
 #pragma once
 
-#include <string>
-#include <vector>
+#include <array>
+#include <string_view>
 #include <cstddef>
 
-#include "rapidjson/document.h"
+#include "timer.h"
 
 // Types
 //
@@ -45,6 +45,73 @@ struct CommandToken
 	unsigned int m_parameter = 0u;
 };
 
+// A list of command tokens with a fixed capacity, so that tokenizing never allocates.
+class CommandTokenList
+{
+	public:
+
+		// Constants.
+
+		// The most tokens a command can be made of. Any more are dropped.
+		static constexpr unsigned int kCapacity{ 8u };
+
+		// Add a token to the end of the list, unless it is full.
+		//
+		// token:	The token to add.
+		//
+		// Returns:	True if the token was added, false if the list was full.
+		//
+		bool Add(CommandToken const& token)
+		{
+			if (m_count >= kCapacity)
+			{
+				return false;
+			}
+
+			m_tokens[m_count] = token;
+			m_count++;
+			return true;
+		}
+
+		// Remove all of the tokens.
+		//
+		void Clear()
+		{
+			m_count = 0u;
+		}
+
+		// Get whether there are no tokens.
+		//
+		bool IsEmpty() const
+		{
+			return m_count == 0u;
+		}
+
+		// Get the number of tokens.
+		//
+		unsigned int GetCount() const
+		{
+			return m_count;
+		}
+
+		// Get a token.
+		//
+		// index:	The index of the token, which must be less than the count.
+		//
+		CommandToken const& operator[](unsigned int index) const
+		{
+			return m_tokens[index];
+		}
+
+	private:
+
+		// Storage for the tokens.
+		std::array<CommandToken, kCapacity> m_tokens;
+
+		// The number of tokens in the list.
+		unsigned int m_count = 0u;
+};
+
 // Potential return values from parsing tokens.
 enum class CommandParseTokensReturnTypes
 {
@@ -58,9 +125,7 @@ enum class CommandParseTokensReturnTypes
 
 // Initialize the system.
 //
-// input:	The input device.
-//
-void CommandInitialize(class Input const& input);
+void CommandInitialize();
 
 // Uninitialize the system.
 //
@@ -70,13 +135,21 @@ void CommandUninitialize();
 //
 void CommandProcess();
 
+// Get the next time that the system needs to be processed, if any.
+//
+// deadline:	(Output) The time by which the system needs to be processed.
+//
+// Returns:	True if the system needs to be processed again, false otherwise.
+//
+bool CommandGetNextDeadline(Time& deadline);
+
 // Parse the command tokens into commands.
 //
 // commandTokens:	All of the potential tokens for the command.
 //
 // Returns:	A value signifying the result of the parsing.
 //
-CommandParseTokensReturnTypes CommandParseTokens(std::vector<CommandToken> const& commandTokens);
+CommandParseTokensReturnTypes CommandParseTokens(CommandTokenList const& commandTokens);
 
 // Parse the command tokens into commands.
 //
@@ -87,21 +160,20 @@ CommandParseTokensReturnTypes CommandParseTokens(std::vector<CommandToken> const
 // Returns:	A value signifying the result of the parsing.
 //
 CommandParseTokensReturnTypes CommandParseTokens(char const*& confirmationText, 
-	std::vector<CommandToken> const& commandTokens);
+	CommandTokenList const& commandTokens);
 
-// Take a command string and turn it into a list of tokens.
+// Take a command string and turn it into a list of tokens. Words are separated by whitespace and
+// matched regardless of case.
 //
 // commandTokens:	(Output) The resulting command tokens, in order.
 // commandString:	The command string to tokenize.
 //
-void CommandTokenizeString(std::vector<CommandToken>& commandTokens, 
-	std::string const& commandString);
+void CommandTokenizeString(CommandTokenList& commandTokens, std::string_view commandString);
 
-// Take a command JSON document and turn it into a list of tokens.
+// Take an intent and turn it into a list of tokens.
 //
-// commandTokens:		(Input/Output) The resulting command tokens, in order. If there was a 
-// 							command pending confirmation, the corresponding tokens will be passed in.
-// commandDocument:	The command document to tokenize.
+// commandTokens:	(Input/Output) The resulting command tokens, in order. If there was a command
+// 					pending confirmation, the corresponding tokens will be passed in.
+// intent:			The intent to tokenize.
 //
-void CommandTokenizeJSONDocument(std::vector<CommandToken>& commandTokens, 
-	rapidjson::Document const& commandDocument);
\ No newline at end of file
+void CommandTokenizeIntent(CommandTokenList& commandTokens, struct IntentMessage const& intent);
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Common
+{
+	/// @brief A bounded, lock-free queue which may be pushed to from any number of threads and
+	/// popped from by a single thread. Neither operation ever blocks or allocates, so it is safe to
+	/// use from a real-time thread.
+	/// @tparam ElementType The type of the elements. It should be cheap to copy.
+	/// @tparam kCapacity The maximum number of elements. It must be a power of two.
+	template <typename ElementType, std::size_t kCapacity>
+	class RingBuffer
+	{
+		static_assert((kCapacity >= 2u) && ((kCapacity & (kCapacity - 1u)) == 0u),
+						  "The capacity must be a power of two.");
+
+	public:
+
+		RingBuffer()
+		{
+			for (std::size_t cellIndex = 0u; cellIndex < kCapacity; cellIndex++)
+			{
+				m_cells[cellIndex].m_sequence.store(cellIndex, std::memory_order_relaxed);
+			}
+		}
+
+		RingBuffer(RingBuffer const&) = delete;
+		RingBuffer& operator=(RingBuffer const&) = delete;
+
+		/// @brief Add an element to the back of the queue. Safe to call from multiple threads.
+		/// @return True if the element was added, false if the queue was full.
+		[[nodiscard]] bool TryPush(ElementType const& value)
+		{
+			auto position = m_pushPosition.load(std::memory_order_relaxed);
+
+			while (true)
+			{
+				auto& cell = m_cells[position & kIndexMask];
+				auto const sequence = cell.m_sequence.load(std::memory_order_acquire);
+				auto const difference = static_cast<std::intptr_t>(sequence) -
+					static_cast<std::intptr_t>(position);
+
+				// The cell is free for this position, so try to claim it.
+				if (difference == 0)
+				{
+					if (m_pushPosition.compare_exchange_weak(position, position + 1u,
+																		  std::memory_order_relaxed) == true)
+					{
+						cell.m_value = value;
+
+						// Publish the element to the consumer.
+						cell.m_sequence.store(position + 1u, std::memory_order_release);
+						return true;
+					}
+				}
+				// The cell still holds an element from a lap ago, so we're full.
+				else if (difference < 0)
+				{
+					return false;
+				}
+				// Another producer got here first.
+				else
+				{
+					position = m_pushPosition.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		/// @brief Remove the element at the front of the queue. Must only be called from one thread.
+		/// @return True if an element was removed, false if the queue was empty.
+		[[nodiscard]] bool TryPop(ElementType& value)
+		{
+			auto const position = m_popPosition.load(std::memory_order_relaxed);
+			auto& cell = m_cells[position & kIndexMask];
+
+			// The element isn't there until the producer has published it.
+			if (cell.m_sequence.load(std::memory_order_acquire) != position + 1u)
+			{
+				return false;
+			}
+
+			value = cell.m_value;
+
+			// Hand the cell back to the producers for the next lap.
+			cell.m_sequence.store(position + kCapacity, std::memory_order_release);
+			m_popPosition.store(position + 1u, std::memory_order_relaxed);
+			return true;
+		}
+
+	private:
+
+		static constexpr std::size_t kIndexMask{ kCapacity - 1u };
+
+		// Keep the positions on separate cache lines so producers and the consumer don't contend.
+		static constexpr std::size_t kCacheLineSize{ 64u };
+
+		struct Cell
+		{
+			/// Which lap of the buffer the cell is ready for, which tells the producers and the
+			/// consumer whether it's empty or full.
+			std::atomic<std::size_t> m_sequence;
+
+			ElementType m_value;
+		};
+
+		std::array<Cell, kCapacity> m_cells;
+
+		alignas(kCacheLineSize) std::atomic<std::size_t> m_pushPosition{ 0u };
+
+		alignas(kCacheLineSize) std::atomic<std::size_t> m_popPosition{ 0u };
+	};
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#include "ring_buffer.h"
+
+namespace Common
+{
+	/// @brief Fixed storage for handing items from one producer thread to one consumer thread.
+	/// The producer fills a free slot in place and then queues it. The consumer takes queued slots
+	/// in the order they were queued and releases each one when it's done. Each slot is always
+	/// either free or queued, so neither side ever blocks or allocates. When every slot is in use,
+	/// the producer's item is dropped and counted rather than waiting or overwriting one.
+	/// @tparam SlotType The type of the slots.
+	/// @tparam kSlotCount The number of slots. It must be a power of two.
+	template <typename SlotType, std::size_t kSlotCount>
+	class SlotQueue
+	{
+	public:
+
+		SlotQueue()
+		{
+			Reset();
+		}
+
+		SlotQueue(SlotQueue const&) = delete;
+		SlotQueue& operator=(SlotQueue const&) = delete;
+
+		/// @brief Make every slot free again and clear the dropped count. Must only be called while
+		/// neither the producer nor the consumer is using the queue.
+		void Reset()
+		{
+			unsigned int slotIndex = 0u;
+
+			while (m_queuedSlotIndices.TryPop(slotIndex) == true)
+			{
+			}
+
+			while (m_freeSlotIndices.TryPop(slotIndex) == true)
+			{
+			}
+
+			for (slotIndex = 0u; slotIndex < kSlotCount; slotIndex++)
+			{
+				[[maybe_unused]] auto const pushed = m_freeSlotIndices.TryPush(slotIndex);
+			}
+
+			m_droppedCount.store(0u, std::memory_order_relaxed);
+		}
+
+		/// @brief Get a free slot to fill. Must only be called from the producer thread.
+		/// @param slotIndex (Output) The index of the slot.
+		/// @return True if a slot was free, false if all of them are in use, in which case the
+		/// item is counted as dropped.
+		[[nodiscard]] bool TryAcquire(unsigned int& slotIndex)
+		{
+			if (m_freeSlotIndices.TryPop(slotIndex) == false)
+			{
+				m_droppedCount.fetch_add(1u, std::memory_order_relaxed);
+				return false;
+			}
+
+			return true;
+		}
+
+		/// @brief Hand a filled slot to the consumer. Must only be called from the producer thread,
+		/// with a slot it acquired.
+		/// @param slotIndex The index of the slot.
+		void Queue(unsigned int slotIndex)
+		{
+			[[maybe_unused]] auto const pushed = m_queuedSlotIndices.TryPush(slotIndex);
+		}
+
+		/// @brief Take the oldest queued slot. Must only be called from the consumer thread.
+		/// @param slotIndex (Output) The index of the slot.
+		/// @return True if a slot was queued, false otherwise.
+		[[nodiscard]] bool TryTake(unsigned int& slotIndex)
+		{
+			return m_queuedSlotIndices.TryPop(slotIndex);
+		}
+
+		/// @brief Make a slot that was taken free again. Must only be called from the consumer
+		/// thread.
+		/// @param slotIndex The index of the slot.
+		void Release(unsigned int slotIndex)
+		{
+			[[maybe_unused]] auto const pushed = m_freeSlotIndices.TryPush(slotIndex);
+		}
+
+		/// @brief Get a slot. Only the thread that acquired or took it may use it.
+		/// @param slotIndex The index of the slot.
+		SlotType& GetSlot(unsigned int slotIndex)
+		{
+			return m_slots[slotIndex];
+		}
+
+		/// @brief Get the number of items dropped since this was last called, and start over.
+		unsigned int TakeDroppedCount()
+		{
+			return m_droppedCount.exchange(0u, std::memory_order_relaxed);
+		}
+
+	private:
+
+		std::array<SlotType, kSlotCount> m_slots;
+
+		/// The indices of the slots that are free to fill. Only the producer takes them and only
+		/// the consumer gives them back.
+		RingBuffer<unsigned int, kSlotCount> m_freeSlotIndices;
+
+		/// The indices of the filled slots, in the order they were queued.
+		RingBuffer<unsigned int, kSlotCount> m_queuedSlotIndices;
+
+		/// The number of items dropped because every slot was in use.
+		std::atomic<unsigned int> m_droppedCount{ 0u };
+	};
+}
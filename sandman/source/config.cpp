@@ -18,11 +18,6 @@
 
 // Config members
 
-Config::Config()
-{
-	m_inputDeviceName[0] = '\0';
-}
-
 // Read the configuration from a file.
 // 
 // configFileName:	The name of the config file.
@@ -89,6 +84,17 @@ bool Config::ReadFromFile(char const* configFileName)
 		}
 	}
 
+	// If there are MQTT settings, try to read them.
+	auto const mqttSettingsIterator = configDocument.FindMember("mqttSettings");
+
+	if (mqttSettingsIterator != configDocument.MemberEnd())
+	{
+		if (ReadMQTTSettingsFromJSON(mqttSettingsIterator->value) == false)
+		{
+			Logger::WriteLine(Shell::Red("Encountered error trying to read MQTT settings."));
+		}
+	}
+
 	fclose(configFile);
 	return true;
 }
@@ -129,6 +135,39 @@ bool Config::ReadControlSettingsFromJSON(rapidjson::Value const& object)
 		}
 	}
 
+	// Try to get whether the controls should be processed on their own thread.
+	auto const actuationThreadEnabledIterator = object.FindMember("actuationThreadEnabled");
+
+	if (actuationThreadEnabledIterator != object.MemberEnd())
+	{
+		if (actuationThreadEnabledIterator->value.IsBool() == true)
+		{
+			m_controlActuationThreadEnabled = actuationThreadEnabledIterator->value.GetBool();
+		}
+	}
+
+	// Try to get the priority of that thread.
+	auto const actuationThreadPriorityIterator = object.FindMember("actuationThreadPriority");
+
+	if (actuationThreadPriorityIterator != object.MemberEnd())
+	{
+		if (actuationThreadPriorityIterator->value.IsInt() == true)
+		{
+			m_controlActuationThreadPriority = actuationThreadPriorityIterator->value.GetInt();
+		}
+	}
+
+	// Try to get whether requests should change the pins right away.
+	auto const immediateActuationIterator = object.FindMember("immediateActuationEnabled");
+
+	if (immediateActuationIterator != object.MemberEnd())
+	{
+		if (immediateActuationIterator->value.IsBool() == true)
+		{
+			m_controlImmediateActuationEnabled = immediateActuationIterator->value.GetBool();
+		}
+	}
+
 	// A controls array is required, but it may be empty.
 	m_controlConfigs.clear();
 
@@ -176,86 +215,95 @@ bool Config::ReadInputSettingsFromJSON(rapidjson::Value const& object)
 		return false;
 	}
 
-	// We must have an array of input devices.
-	auto const inputDevicesIterator = object.FindMember("inputDevices");
-
-	if (inputDevicesIterator == object.MemberEnd())
+	// Try to get how the gestures are timed.
+	auto const ReadGestureTiming = [&](char const* name, unsigned int& timingMS)
 	{
-		Logger::WriteLine(Shell::Red("Config is missing in input devices member."));
-		return false;
-	}
+		auto const timingIterator = object.FindMember(name);
 
-	if (inputDevicesIterator->value.IsArray() == false)
-	{
-		Logger::WriteLine(Shell::Red("Config has an input devices member, but it is not an array."));
-		return false;
-	}
+		if (timingIterator == object.MemberEnd())
+		{
+			return;
+		}
 
-	rapidjson::Value const& inputDevices = inputDevicesIterator->value;
+		if (timingIterator->value.IsUint() == true)
+		{
+			timingMS = timingIterator->value.GetUint();
+		}
+	};
 
-	// In the future we may support multiple input devices, but for now we will just read the first
-	// one.
-	if (inputDevices.Size() == 0)
-	{
-		return true;
-	}
+	ReadGestureTiming("chordWindowMS", m_inputGestureTimings.m_chordWindowMS);
+	ReadGestureTiming("longPressDurationMS", m_inputGestureTimings.m_longPressDurationMS);
+	ReadGestureTiming("doubleTapWindowMS", m_inputGestureTimings.m_doubleTapWindowMS);
 
-	rapidjson::Value const& inputDevice = inputDevices[0];
+	// Try to get whether input latencies should be written into the reports.
+	auto const latencyReportsEnabledIterator = object.FindMember("latencyReportsEnabled");
 
-	if (inputDevice.IsObject() == false)
+	if (latencyReportsEnabledIterator != object.MemberEnd())
 	{
-		Logger::WriteLine(Shell::Red("Config has an input device that is not an object."));
-		return false;
+		if (latencyReportsEnabledIterator->value.IsBool() == true)
+		{
+			m_inputLatencyReportsEnabled = latencyReportsEnabledIterator->value.GetBool();
+		}
 	}
 
-	// We must have a device name.
-	auto const deviceIterator = inputDevice.FindMember("device");
+	// We must have an array of input devices.
+	auto const inputDevicesIterator = object.FindMember("inputDevices");
 
-	if (deviceIterator == object.MemberEnd())
+	if (inputDevicesIterator == object.MemberEnd())
 	{
-		Logger::WriteLine(Shell::Red("Config input device is missing the device name."));
+		Logger::WriteLine(Shell::Red("Config is missing in input devices member."));
 		return false;
 	}
 
-	if (deviceIterator->value.IsString() == false)
+	if (inputDevicesIterator->value.IsArray() == false)
 	{
-		Logger::WriteLine(Shell::Red("Config input device name is not a string."));
+		Logger::WriteLine(Shell::Red("Config has an input devices member, but it is not an array."));
 		return false;
 	}
-	
-	// Copy no more than the amount of text the buffer can hold.
-	strncpy(m_inputDeviceName, deviceIterator->value.GetString(), sizeof(m_inputDeviceName) - 1);
-	m_inputDeviceName[sizeof(m_inputDeviceName) - 1] = '\0';
-
-	// We must have a bindings array, but it can be empty.
-	m_inputBindings.clear();
 
-	auto const bindingsIterator = inputDevice.FindMember("bindings");
+	// Every device is optional, so ones that can't be read are skipped.
+	m_inputDeviceConfigs.clear();
 
-	if (bindingsIterator == inputDevice.MemberEnd())
+	for (auto const& inputDeviceObject : inputDevicesIterator->value.GetArray())
 	{
-		Logger::WriteLine(Shell::Red("Config input device is missing a bindings array."));
-		return false;
+		// Try to read the device.
+		InputDeviceConfig inputDeviceConfig;
+		if (inputDeviceConfig.ReadFromJSON(inputDeviceObject) == false)
+		{
+			continue;
+		}
+
+		// If we successfully read a device config, add it to the list.
+		m_inputDeviceConfigs.push_back(inputDeviceConfig);
 	}
 
-	if (bindingsIterator->value.IsArray() == false)
+	return true;
+}
+
+// Read MQTT settings from JSON. 
+//
+// object:	The JSON object representing the MQTT settings.
+//
+// Returns:		True if the settings were read successfully, false otherwise.
+//
+bool Config::ReadMQTTSettingsFromJSON(rapidjson::Value const& object)
+{
+	if (object.IsObject() == false)
 	{
-		Logger::WriteLine(Shell::Red("Config input device bindings exists, but it is not an array."));
+		Logger::WriteLine(Shell::Red("Config has an MQTT settings member, but it's not an object."));
 		return false;
 	}
 
-	for (auto const& bindingObject : bindingsIterator->value.GetArray())
+	// Try to get whether the client should run on its own thread.
+	auto const threadEnabledIterator = object.FindMember("threadEnabled");
+
+	if (threadEnabledIterator != object.MemberEnd())
 	{
-		// Try to read the binding.
-		InputBinding binding;
-		if (binding.ReadFromJSON(bindingObject) == false)
+		if (threadEnabledIterator->value.IsBool() == true)
 		{
-			continue;
+			m_mqttThreadEnabled = threadEnabledIterator->value.GetBool();
 		}
-
-		// If we successfully read a binding, add it to the list.
-		m_inputBindings.push_back(binding);
 	}
 
 	return true;
-}
\ No newline at end of file
+}
@@ -10,8 +10,6 @@
 class Config
 {
 	public:
-	
-		Config();
 		
 		// Read the configuration from a file.
 		// 
@@ -23,14 +21,24 @@ class Config
 		
 		// Accessors.
 		
-		char const* GetInputDeviceName() const
+		std::vector<InputDeviceConfig> const& GetInputDeviceConfigs() const
 		{
-			return m_inputDeviceName;
+			return m_inputDeviceConfigs;
 		}
-		
-		std::vector<InputBinding> const& GetInputBindings() const
+
+		InputGestureTimings const& GetInputGestureTimings() const
+		{
+			return m_inputGestureTimings;
+		}
+
+		bool GetInputLatencyReportsEnabled() const
 		{
-			return m_inputBindings;
+			return m_inputLatencyReportsEnabled;
+		}
+
+		bool GetMQTTThreadEnabled() const
+		{
+			return m_mqttThreadEnabled;
 		}
 		
 		unsigned int GetControlMaxMovingDurationMS() const
@@ -42,6 +50,21 @@ class Config
 		{
 			return m_controlCoolDownDurationMS;
 		}
+
+		bool GetControlActuationThreadEnabled() const
+		{
+			return m_controlActuationThreadEnabled;
+		}
+
+		int GetControlActuationThreadPriority() const
+		{
+			return m_controlActuationThreadPriority;
+		}
+
+		bool GetControlImmediateActuationEnabled() const
+		{
+			return m_controlImmediateActuationEnabled;
+		}
 		
 		std::vector<ControlConfig> const& GetControlConfigs() const
 		{
@@ -66,20 +89,41 @@ class Config
 		//
 		bool ReadInputSettingsFromJSON(rapidjson::Value const& object);
 
-		// Constants.
-		static constexpr unsigned int kInputDeviceNameCapacity{ 64u };
-		
-		// The name of the input device.
-		char m_inputDeviceName[kInputDeviceNameCapacity];
-							
-		// The list of input bindings.
-		std::vector<InputBinding> m_inputBindings;
+		// Read MQTT settings from JSON. 
+		//
+		// object:	The JSON object representing the MQTT settings.
+		//
+		// Returns:		True if the settings were read successfully, false otherwise.
+		//
+		bool ReadMQTTSettingsFromJSON(rapidjson::Value const& object);
+
+		// The list of input device configs.
+		std::vector<InputDeviceConfig> m_inputDeviceConfigs;
+
+		// How the input gestures are timed.
+		InputGestureTimings m_inputGestureTimings;
+
+		// Whether the time from each key event to the pins changing is written into the reports.
+		bool m_inputLatencyReportsEnabled = false;
+
+		// Whether the MQTT client runs on its own thread, rather than in the main loop.
+		bool m_mqttThreadEnabled = false;
 		
 		// The maximum duration a control can move for (in milliseconds).
 		unsigned int m_controlMaxMovingDurationMS = 100'000;
 				
 		// The duration a control will be on cooldown (in milliseconds).
 		unsigned int m_controlCoolDownDurationMS = 50'000;
+
+		// Whether the controls are processed on their own real-time thread.
+		bool m_controlActuationThreadEnabled = false;
+
+		// The SCHED_FIFO priority of that thread.
+		int m_controlActuationThreadPriority = 50;
+
+		// Whether requests change the pins right away, rather than the next time the controls are
+		// processed.
+		bool m_controlImmediateActuationEnabled = false;
 		
 		// The list of control configs.
 		std::vector<ControlConfig> m_controlConfigs;
@@ -1,13 +1,29 @@
 #include "control.h"
 
+#include <array>
+#include <atomic>
+#include <cerrno>
 #include <cstdio>
 #include <cstring>
-#include <map>
+#include <optional>
+#include <thread>
 #include <vector>
 
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "common/ring_buffer.h"
 #include "gpio.h"
 #include "logger.h"
 #include "notification.h"
+#include "reactor.h"
+#include "reports.h"
+#include "scheduler.h"
+#include "stats.h"
 #include "timer.h"
 #include "command.h"
 
@@ -21,6 +37,9 @@
 // Maximum duration of the cool down state.
 #define MAX_COOL_DOWN_STATE_DURATION_MS	(50 * 1000) // 50 sec.
 
+// The most controls that can be created. They are kept in a fixed array so that they never move.
+static constexpr unsigned int kMaxControlCount{ 16u };
+
 // Time between commands.
 //#define COMMAND_INTERVAL_MS				(2 * 1000) // 2 sec.
 
@@ -57,23 +76,194 @@ static constexpr char const* const kControlStateNotificationNames[] =
 	"stop",			// kStateCoolDown
 };
 
+// The maximum number of requests or transitions that can be waiting to be handed between threads.
+static constexpr std::size_t kControlQueueCapacity{ 64u };
+
+// The scheduler entry, after those of the controls, for trying pin changes that failed again.
+static constexpr unsigned int kPinRetryID{ kMaxControlCount };
+
+// How long to wait before trying pin changes that failed again.
+static constexpr auto kPinRetryDelay{ std::chrono::milliseconds(10) };
+
+// Types
+//
+
+// A request for a control to change its desired action, handed to the actuation thread.
+struct ControlRequest
+{
+	// The index of the control.
+	unsigned int m_controlIndex;
+
+	// The desired action, its mode and how long moving should last.
+	Control::Actions m_action;
+	Control::Modes m_mode;
+	unsigned int m_movingDurationMS;
+
+	// When the request was made.
+	Time m_requestTime;
+
+	// Where to record the time until the pins change.
+	StatsLatencyID m_latencyID;
+};
+
+// A state transition made by whichever thread processes the controls, so that it can be announced
+// (logged, spoken and measured) from the main thread.
+struct ControlTransition
+{
+	// The index of the control.
+	unsigned int m_controlIndex;
+
+	// The states before and after the transition.
+	Control::State m_oldState;
+	Control::State m_newState;
+
+	// The mode the control was in.
+	Control::Modes m_mode;
+
+	// When the pins were changed.
+	Time m_transitionTime;
+
+	// When the request that caused the transition was made, if there was one.
+	bool m_hasRequestTime;
+	Time m_requestTime;
+
+	// Where to record the time from the request to the transition.
+	StatsLatencyID m_latencyID;
+};
+
+// Holds back pin changes like GPIOPinBatch does, and also holds back announcing the transitions
+// they cause until the pins have actually changed, so that announcing never delays the pins. Batches
+// may be nested, in which case everything happens when the outermost one is destroyed. They must
+// only be used on the thread that processes the controls.
+class ControlPinBatch
+{
+	public:
+
+		// Start holding back pin changes and transitions.
+		//
+		ControlPinBatch();
+
+		// Make the pin changes that were held back, then hand over the transitions.
+		//
+		~ControlPinBatch();
+
+		ControlPinBatch(ControlPinBatch const&) = delete;
+		ControlPinBatch& operator=(ControlPinBatch const&) = delete;
+
+	private:
+
+		// The pin changes being held back. It's ended before the transitions are handed over.
+		std::optional<GPIOPinBatch> m_pinBatch;
+};
+
 // Locals
 //
 
-// A list of registered controls.
-static std::vector<Control> s_controls;
+// The registered controls, indexed by their handles. Only the first s_controlCount are in use.
+static std::array<Control, kMaxControlCount> s_controls;
+static unsigned int s_controlCount = 0u;
+
+// The next time each control needs to be processed, keyed by control index, plus kPinRetryID while
+// pin changes that failed are waiting to be tried again. It belongs to whichever thread processes
+// the controls.
+static Scheduler s_controlScheduler;
+
+// Whether the controls are being processed on the actuation thread rather than the main thread.
+// This only changes while the actuation thread isn't running.
+static bool s_actuationThreadRunning = false;
+
+// The thread that processes the controls, when it's enabled.
+static std::thread s_actuationThread;
+
+// Tells the actuation thread to exit.
+static std::atomic<bool> s_actuationThreadQuit{ false };
+
+// An event file descriptor used to wake up the actuation thread.
+static int s_actuationWakeFileDescriptor = -1;
+
+// Requests going to the actuation thread.
+static Common::RingBuffer<ControlRequest, kControlQueueCapacity> s_requestQueue;
 
-// A mapping of control name to control index.
-static std::map<std::string, unsigned int> s_controlNameToIndexMap;
+// Transitions coming back from the actuation thread.
+static Common::RingBuffer<ControlTransition, kControlQueueCapacity> s_transitionQueue;
+
+// The number of transitions that couldn't be announced because the main thread fell behind, or
+// because too many piled up while the pins couldn't be set.
+static std::atomic<unsigned int> s_droppedTransitionCount{ 0u };
+
+// Whether measured latencies are written into the reports.
+static bool s_latencyReportsEnabled = false;
+
+// How many control pin batches are open, and the transitions waiting on them or on pin changes
+// that failed. These belong to whichever thread processes the controls.
+static unsigned int s_pinBatchDepth = 0u;
+static std::array<ControlTransition, kControlQueueCapacity> s_heldTransitions;
+static unsigned int s_heldTransitionCount = 0u;
 
 // Control members
 
 unsigned int Control::ms_maxMovingDurationMS = MAX_MOVING_STATE_DURATION_MS;
 unsigned int Control::ms_coolDownDurationMS = MAX_COOL_DOWN_STATE_DURATION_MS;
+bool Control::ms_immediateActuation = false;
 
 // Functions
 //
 
+static void ControlsAnnounceTransition(ControlTransition const& transition);
+static void ControlsHandOverTransition(ControlTransition const& transition);
+static void ControlsSubmitRequest(ControlRequest const& request);
+
+// ControlPinBatch members
+
+// Start holding back pin changes and transitions.
+//
+ControlPinBatch::ControlPinBatch()
+{
+	m_pinBatch.emplace();
+	s_pinBatchDepth++;
+}
+
+// Make the pin changes that were held back, then hand over the transitions. If the pins couldn't be
+// set, the transitions keep waiting and the pin changes are tried again shortly.
+//
+ControlPinBatch::~ControlPinBatch()
+{
+	s_pinBatchDepth--;
+
+	// The pins change here, unless an outer batch is still holding them back.
+	m_pinBatch.reset();
+
+	if (s_pinBatchDepth > 0u)
+	{
+		return;
+	}
+
+	// Nothing has happened until the pins have changed, so there's nothing to announce yet.
+	if (GPIOArePinChangesPending() == true)
+	{
+		s_controlScheduler.Schedule(kPinRetryID, TimerClock::now() + kPinRetryDelay);
+		return;
+	}
+
+	s_controlScheduler.Cancel(kPinRetryID);
+
+	auto const heldTransitionCount = s_heldTransitionCount;
+	s_heldTransitionCount = 0u;
+
+	// The transitions really happened just now, when the pins were written, so that's what their
+	// latencies are measured to.
+	auto const pinChangeTime = TimerClock::now();
+
+	for (unsigned int transitionIndex = 0u; transitionIndex < heldTransitionCount;
+		  transitionIndex++)
+	{
+		auto& transition = s_heldTransitions[transitionIndex];
+		transition.m_transitionTime = pinChangeTime;
+
+		ControlsHandOverTransition(transition);
+	}
+}
+
 // ControlConfig members
 
 // Read a control config from JSON. 
@@ -162,27 +352,24 @@ bool ControlConfig::ReadFromJSON(rapidjson::Value const& object)
 // Handle initialization.
 //
 // config:	Configuration parameters for the control.
+// index:	The index of the control.
 //
-void Control::Initialize(ControlConfig const& config)
+void Control::Initialize(ControlConfig const& config, unsigned int index)
 {
+	m_index = index;
+
 	// Copy the name.
 	strncpy(m_name, config.m_name, kNameCapacity - 1);
 	m_name[kNameCapacity - 1] = '\0';
 	
 	m_state = kStateIdle;
-	TimerGetCurrent(m_stateStartTime);
+	m_stateStartTime = TimerClock::now();
 	m_desiredAction = kActionStopped;
 
-	// Setup the pins and set them to off.
+	// The pins were acquired, and set to off, along with everyone else's.
 	m_upGPIOPin = config.m_upGPIOPin;
 	m_downGPIOPin = config.m_downGPIOPin;
 	
-	GPIOAcquireOutputPin(m_upGPIOPin);
-	GPIOAcquireOutputPin(m_downGPIOPin);
-	
-	GPIOSetPinOff(m_upGPIOPin);
-	GPIOSetPinOff(m_downGPIOPin);
-	
 	// Set the individual control moving duration.
 	m_standardMovingDurationMS = config.m_movingDurationMS;
 
@@ -195,9 +382,7 @@ void Control::Initialize(ControlConfig const& config)
 //
 void Control::Uninitialize()
 {
-	// Release pins.
-	GPIOReleasePin(m_upGPIOPin);
-	GPIOReleasePin(m_downGPIOPin);
+	s_controlScheduler.Cancel(m_index);
 }
 
 // Process a tick.
@@ -229,27 +414,19 @@ void Control::Process()
 				// Set the pin to on.
 				GPIOSetPinOn(m_downGPIOPin);
 			}
-			
-			// Play the notification.
-			PlayNotification();
 
 			// Record when the state transition timer began.
-			TimerGetCurrent(m_stateStartTime);
+			m_stateStartTime = TimerClock::now();
 
-			Logger::WriteLine("Control \"", m_name, "\": State transition from \"",
-									kControlStateNames[kStateIdle], "\" to \"", kControlStateNames[m_state],
-									"\" triggered.");
+			AnnounceTransition(kStateIdle, m_stateStartTime);
 		}
 		break;
 
 		case kStateMovingUp:	// Fall through...
 		case kStateMovingDown:
 		{
-			// Get elapsed time since state start.
-			Time currentTime;
-			TimerGetCurrent(currentTime);
-
-			auto const elapsedTimeMS = TimerGetElapsedMilliseconds(m_stateStartTime, currentTime);
+			// Get the time at which moving should stop.
+			auto const stopTime = m_stateStartTime + std::chrono::milliseconds(m_movingDurationMS);
 
 			// Get the action corresponding to this state, as well as the one for the opposite state.
 			auto const matchingAction = (m_state == kStateMovingUp) ? kActionMovingUp : 
@@ -258,7 +435,7 @@ void Control::Process()
 				kActionMovingUp;
 			
 			// Wait until the desired action no longer matches or the time limit has run out.
-			if ((m_desiredAction == matchingAction) && (elapsedTimeMS < m_movingDurationMS))
+			if ((m_desiredAction == matchingAction) && (TimerClock::now() < stopTime))
 			{
 				break;
 			}
@@ -290,16 +467,11 @@ void Control::Process()
 				GPIOSetPinOff(m_upGPIOPin);
 				GPIOSetPinOff(m_downGPIOPin);
 			}
-			
-			// Play the notification.
-			PlayNotification();
-			
+
 			// Record when the state transition timer began.
-			TimerGetCurrent(m_stateStartTime);
+			m_stateStartTime = TimerClock::now();
 
-			Logger::WriteLine("Control \"", m_name, "\": State transition from \"",
-									kControlStateNames[oldState], "\" to \"", kControlStateNames[m_state],
-									"\" triggered.");
+			AnnounceTransition(oldState, m_stateStartTime);
 		}
 		break;
 
@@ -308,14 +480,11 @@ void Control::Process()
 			// Clear the desired action.
 			m_desiredAction = kActionStopped;
 
-			// Get elapsed time since state start.
-			Time currentTime;
-			TimerGetCurrent(currentTime);
-
-			auto const elapsedTimeMS = TimerGetElapsedMilliseconds(m_stateStartTime, currentTime);
+			// Get the time at which cooling down should end.
+			auto const endTime = m_stateStartTime + std::chrono::milliseconds(ms_coolDownDurationMS);
 
 			// Wait until the time limit has run out.
-			if (elapsedTimeMS < ms_coolDownDurationMS)
+			if (TimerClock::now() < endTime)
 			{
 				break;
 			}
@@ -327,9 +496,7 @@ void Control::Process()
 			GPIOSetPinOff(m_upGPIOPin);
 			GPIOSetPinOff(m_downGPIOPin);
 
-			Logger::WriteLine("Control \"", m_name, "\": State transition from \"",
-									kControlStateNames[kStateCoolDown], "\" to \"",
-									kControlStateNames[m_state], "\" triggered.");
+			AnnounceTransition(kStateCoolDown, TimerClock::now());
 		}
 		break;
 
@@ -340,6 +507,79 @@ void Control::Process()
 		}
 		break;
 	}
+
+	// Any request has been dealt with now, whether it caused a transition or not.
+	m_hasPendingRequest = false;
+}
+
+// Get the next time that the control needs to be processed, if any.
+//
+// deadline:	(Output) The time by which the control needs to be processed.
+//
+// Returns:	True if the control needs to be processed again, false if it's idle.
+//
+bool Control::GetNextDeadline(Time& deadline) const
+{
+	switch (m_state)
+	{
+		case kStateIdle:
+		{
+			// Only a desired action will get us moving, and it should happen right away.
+			if (m_desiredAction == kActionStopped)
+			{
+				return false;
+			}
+
+			deadline = TimerClock::now();
+		}
+		return true;
+
+		case kStateMovingUp:	// Fall through...
+		case kStateMovingDown:
+		{
+			auto const matchingAction = (m_state == kStateMovingUp) ? kActionMovingUp :
+				kActionMovingDown;
+
+			// A change in the desired action should be handled right away.
+			if (m_desiredAction != matchingAction)
+			{
+				deadline = TimerClock::now();
+				return true;
+			}
+
+			deadline = m_stateStartTime + std::chrono::milliseconds(m_movingDurationMS);
+		}
+		return true;
+
+		case kStateCoolDown:
+		{
+			deadline = m_stateStartTime + std::chrono::milliseconds(ms_coolDownDurationMS);
+		}
+		return true;
+
+		default:
+		{
+		}
+		break;
+	}
+
+	return false;
+}
+
+// Register the next time that the control needs to be processed with the scheduler, or remove it
+// from the scheduler if it doesn't need to be processed.
+//
+void Control::Schedule() const
+{
+	Time deadline;
+	if (GetNextDeadline(deadline) == true)
+	{
+		s_controlScheduler.Schedule(m_index, deadline);
+	}
+	else
+	{
+		s_controlScheduler.Cancel(m_index);
+	}
 }
 
 // Set the desired action.
@@ -349,6 +589,21 @@ void Control::Process()
 // durationPercent:	(Optional) The percent of the normal duration to perform the action for.
 //
 void Control::SetDesiredAction(Actions desiredAction, Modes mode, unsigned int durationPercent)
+{
+	SetDesiredAction(desiredAction, mode, durationPercent, TimerClock::now(), kStatsNoLatency);
+}
+
+// Set the desired action on behalf of something that happened earlier, like a key press, and
+// measure the time from then until the pins change.
+//
+// desiredAction:		The desired action.
+// mode:					The mode of the action.
+// durationPercent:	The percent of the normal duration to perform the action for.
+// requestTime:		When the thing that wants the action happened.
+// latencyID:			Where to record the time until the pins change, or kStatsNoLatency.
+//
+void Control::SetDesiredAction(Actions desiredAction, Modes mode, unsigned int durationPercent,
+										 Time const& requestTime, StatsLatencyID latencyID)
 {
 	static_assert(std::is_same_v<decltype(durationPercent), decltype(CommandToken::m_parameter)>,
 					  "Assert the type of `durationPercent` "
@@ -358,24 +613,76 @@ void Control::SetDesiredAction(Actions desiredAction, Modes mode, unsigned int d
 					  "so this assertion serves as a notification for if "
 					  "the types become unsynchronized.");
 
-	m_desiredAction = desiredAction;
-	m_mode = mode;
+	auto movingDurationMS = ms_maxMovingDurationMS;
 
-	if (m_mode == kModeTimed)
+	if (mode == kModeTimed)
 	{
 		// Set the current moving duration based on the requested percentage of the standard amount.
 		auto const durationFraction = std::min(durationPercent, 100u) / 100.0f;
-		m_movingDurationMS =
-			static_cast<unsigned int>(m_standardMovingDurationMS * durationFraction);
+		movingDurationMS = static_cast<unsigned int>(m_standardMovingDurationMS * durationFraction);
+	}
+
+	// Hand the request over before logging, so that logging doesn't delay it.
+	RequestDesiredAction(desiredAction, mode, movingDurationMS, requestTime, latencyID);
+
+	Logger::WriteLine("Control \"", m_name, "\": Setting desired action to \"",
+							kControlActionNames[desiredAction], "\" with mode \"",
+							kControlModeNames[mode], "\" and duration ", movingDurationMS, " ms.");
+}
+
+// Hand a desired action to whichever thread processes the controls, without logging it.
+//
+// desiredAction:		The desired action.
+// mode:					The mode of the action.
+// movingDurationMS:	How long moving should last (in milliseconds).
+// requestTime:		When the action was requested.
+// latencyID:			(Optional) Where to record the time until the pins change.
+//
+void Control::RequestDesiredAction(Actions desiredAction, Modes mode, unsigned int movingDurationMS,
+											  Time const& requestTime, StatsLatencyID latencyID)
+{
+	if (s_actuationThreadRunning == true)
+	{
+		ControlRequest const request{ m_index, desiredAction, mode, movingDurationMS, requestTime,
+												latencyID };
+		ControlsSubmitRequest(request);
 	}
 	else
 	{
-		m_movingDurationMS = ms_maxMovingDurationMS;
+		ApplyDesiredAction(desiredAction, mode, movingDurationMS, requestTime, latencyID);
 	}
+}
 
-	Logger::WriteLine("Control \"", m_name, "\": Setting desired action to \"",
-							kControlActionNames[desiredAction], "\" with mode \"",
-							kControlModeNames[mode], "\" and duration ", m_movingDurationMS, " ms.");
+// Apply a desired action right away. This must only be called from the thread that processes the
+// controls, so use SetDesiredAction otherwise.
+//
+// desiredAction:		The desired action.
+// mode:					The mode of the action.
+// movingDurationMS:	How long moving should last (in milliseconds).
+// requestTime:		When the action was requested.
+// latencyID:			Where to record the time until the pins change, or kStatsNoLatency.
+//
+void Control::ApplyDesiredAction(Actions desiredAction, Modes mode, unsigned int movingDurationMS,
+											Time const& requestTime, StatsLatencyID latencyID)
+{
+	m_desiredAction = desiredAction;
+	m_mode = mode;
+	m_movingDurationMS = movingDurationMS;
+
+	m_hasPendingRequest = true;
+	m_requestTime = requestTime;
+	m_latencyID = latencyID;
+
+	// Act upon the new desire now, if asked to. Processing enforces the same rules that it would
+	// later, so a control that is cooling down still won't move.
+	if (ms_immediateActuation == true)
+	{
+		ControlPinBatch const pinBatch;
+		Process();
+	}
+
+	// Make sure the new desire gets acted upon, or whatever comes next does.
+	Schedule();
 }
 
 // Enable or disable all controls.
@@ -408,41 +715,107 @@ void Control::SetDurations(unsigned int movingDurationMS, unsigned int coolDownD
 							coolDownDurationMS, " ms.");
 }
 
+// Set whether requests are acted upon right away, changing the pins before the request returns,
+// rather than the next time the controls are processed.
+//
+// immediate:	Whether to act upon requests right away.
+//
+void Control::SetImmediateActuation(bool immediate)
+{
+	ms_immediateActuation = immediate;
+
+	Logger::WriteLine("Control immediate actuation ", (immediate == true) ? "enabled" : "disabled",
+							".");
+}
+
 // Look up a control by its name.
 //
 // name:	The name of the control.
 //
 // Returns:		The control, or null if one with the name could not be found.
 //
-Control* Control::GetByName(std::string const& name)
+Control* Control::GetByName(std::string_view name)
+{
+	return GetByHandle(GetHandleByName(name));
+}
+
+// Look up the handle of a control by its name. This searches, so it's meant to be done once, when
+// whatever refers to the control is loaded.
+//
+// name:	The name of the control.
+//
+// Returns:		The handle of the control, or kInvalidControlHandle if one with the name could not
+//					be found.
+//
+ControlHandle Control::GetHandleByName(std::string_view name)
+{
+	// There are only ever a few controls, so a scan beats anything fancier.
+	for (ControlHandle handle = 0u; handle < s_controlCount; handle++)
+	{
+		if (name == s_controls[handle].m_name)
+		{
+			return handle;
+		}
+	}
+
+	return kInvalidControlHandle;
+}
+
+// Get a control from its handle.
+//
+// handle:	The handle of the control.
+//
+// Returns:		The control, or null if the handle doesn't refer to one.
+//
+Control* Control::GetByHandle(ControlHandle handle)
 {
-	auto controlIterator = s_controlNameToIndexMap.find(name);
-	if (controlIterator == s_controlNameToIndexMap.end())
+	if (handle >= s_controlCount)
 	{
 		return nullptr;
 	}
-	
-	auto const controlIndex = controlIterator->second;
-	return &s_controls[controlIndex];
+
+	return &s_controls[handle];
 }
 		
-// Play a notification for the state.
+// Have a state transition announced on the main thread, once the pins have changed.
+//
+// oldState:			The state before the transition.
+// transitionTime:	When the pins were changed.
 //
-void Control::PlayNotification()
+void Control::AnnounceTransition(State oldState, Time const& transitionTime)
 {
-	// Do not play a notification if the mode is manual.
-	if (m_mode == kModeManual)
+	ControlTransition transition;
+	transition.m_controlIndex = m_index;
+	transition.m_oldState = oldState;
+	transition.m_newState = m_state;
+	transition.m_mode = m_mode;
+	transition.m_transitionTime = transitionTime;
+	transition.m_hasRequestTime = m_hasPendingRequest;
+	transition.m_requestTime = m_requestTime;
+	transition.m_latencyID = (m_hasPendingRequest == true) ? m_latencyID : kStatsNoLatency;
+
+	// Only the first transition after a request is caused by it.
+	m_hasPendingRequest = false;
+
+	// Wait for the pins to actually change before doing anything else about it.
+	if (s_pinBatchDepth > 0u)
 	{
+		if (s_heldTransitionCount < s_heldTransitions.size())
+		{
+			s_heldTransitions[s_heldTransitionCount] = transition;
+			s_heldTransitionCount++;
+		}
+		else
+		{
+			// Only possible when the pins haven't been set for a long while, and then announcing
+			// it would be wrong.
+			s_droppedTransitionCount++;
+		}
+
 		return;
 	}
 
-	// Build the notification name.
-	static constexpr std::size_t kNotificationNameCapacity{ 128u };
-	char notificationName[kNotificationNameCapacity];
-	std::snprintf(notificationName, kNotificationNameCapacity, "%s_%s", m_name,
-		kControlStateNotificationNames[m_state]);
-
-	NotificationPlay(notificationName);
+	ControlsHandOverTransition(transition);
 }
 
 // ControlAction members
@@ -552,24 +925,215 @@ bool ControlAction::ReadFromJSON(rapidjson::Value const& object)
 	return true;
 }
 
-// Attempt to get the control corresponding to the control action.
+// Look up the control named by the control action and remember its handle. The controls must have
+// been created first.
+//
+// Returns:	True if the control was found, false otherwise.
+//
+bool ControlAction::Resolve()
+{
+	m_controlHandle = Control::GetHandleByName(m_controlName);
+	return m_controlHandle != kInvalidControlHandle;
+}
+
+// Attempt to get the control corresponding to the control action. It must have been resolved.
 //
 // Returns:	The control if successful, null otherwise.
 //
 Control* ControlAction::GetControl() const
 {
-	return Control::GetByName(m_controlName);
+	return Control::GetByHandle(m_controlHandle);
 }
 	
 // Functions
 //
 
+// Announce a state transition by logging it, playing a notification and recording how long it
+// took to act on the request that caused it. This must be called from the main thread.
+//
+// transition:	The transition to announce.
+//
+static void ControlsAnnounceTransition(ControlTransition const& transition)
+{
+	auto const& control = s_controls[transition.m_controlIndex];
+
+	// Play a notification for moving and stopping, but not for the manual mode.
+	if ((transition.m_newState != Control::kStateIdle) &&
+		 (transition.m_mode != Control::kModeManual))
+	{
+		static constexpr std::size_t kNotificationNameCapacity{ 128u };
+		char notificationName[kNotificationNameCapacity];
+		std::snprintf(notificationName, kNotificationNameCapacity, "%s_%s", control.GetName(),
+						  kControlStateNotificationNames[transition.m_newState]);
+
+		NotificationPlay(notificationName);
+	}
+
+	if (transition.m_hasRequestTime == true)
+	{
+		StatsRecord(kStatsSubsystemActuation, transition.m_requestTime, transition.m_transitionTime);
+	}
+
+	if (transition.m_latencyID != kStatsNoLatency)
+	{
+		StatsRecordLatency(transition.m_latencyID, transition.m_requestTime,
+								 transition.m_transitionTime);
+
+		if (s_latencyReportsEnabled == true)
+		{
+			auto const latency = std::chrono::duration_cast<std::chrono::microseconds>(
+				transition.m_transitionTime - transition.m_requestTime);
+
+			ReportsAddLatencyItem(StatsGetLatencyName(transition.m_latencyID), latency.count());
+		}
+	}
+
+	Logger::WriteLine("Control \"", control.GetName(), "\": State transition from \"",
+							kControlStateNames[transition.m_oldState], "\" to \"",
+							kControlStateNames[transition.m_newState], "\" triggered.");
+}
+
+// Have a state transition announced on the main thread, right away if that's where we are. This
+// must be called from whichever thread processes the controls.
+//
+// transition:	The transition to announce.
+//
+static void ControlsHandOverTransition(ControlTransition const& transition)
+{
+	if (s_actuationThreadRunning == false)
+	{
+		ControlsAnnounceTransition(transition);
+		return;
+	}
+
+	// Never wait on the main thread from here. If it has fallen that far behind, it will find out
+	// how many announcements it missed.
+	if (s_transitionQueue.TryPush(transition) == false)
+	{
+		s_droppedTransitionCount++;
+	}
+
+	ReactorWake();
+}
+
+// Hand a request to the actuation thread.
+//
+// request:	The request.
+//
+static void ControlsSubmitRequest(ControlRequest const& request)
+{
+	// The actuation thread drains the queue as soon as it wakes, so if it's full, keep nudging it
+	// until there's room. Dropping a request could mean dropping a stop.
+	while (s_requestQueue.TryPush(request) == false)
+	{
+		std::uint64_t const increment = 1;
+		[[maybe_unused]] auto const writeCount = write(s_actuationWakeFileDescriptor, &increment,
+																	  sizeof(increment));
+		std::this_thread::yield();
+	}
+
+	std::uint64_t const increment = 1;
+	[[maybe_unused]] auto const writeCount = write(s_actuationWakeFileDescriptor, &increment,
+																  sizeof(increment));
+}
+
+// Process the controls that are due, on whichever thread processes the controls.
+//
+static void ControlsProcessDue()
+{
+	auto const currentTime = TimerClock::now();
+
+	// Every pin that changes this time around changes at once.
+	ControlPinBatch const pinBatch;
+
+	// Only the controls that are due need attention. A control that is rescheduled for a time that
+	// has already passed will be handled again before we return.
+	unsigned int controlIndex;
+	while (s_controlScheduler.PopExpired(currentTime, controlIndex) == true)
+	{
+		// Pin changes that failed are tried again when the batch is done.
+		if (controlIndex == kPinRetryID)
+		{
+			continue;
+		}
+
+		auto& control = s_controls[controlIndex];
+
+		control.Process();
+		control.Schedule();
+	}
+}
+
+// The body of the actuation thread, which owns the controls and their pins while it runs.
+//
+static void ControlsActuationThreadMain()
+{
+	while (s_actuationThreadQuit.load(std::memory_order_acquire) == false)
+	{
+		{
+			// Requests that arrive together, like stopping everything, change their pins together.
+			ControlPinBatch const pinBatch;
+
+			// Apply requests before anything else, so that stops happen as soon as possible.
+			ControlRequest request;
+			while (s_requestQueue.TryPop(request) == true)
+			{
+				s_controls[request.m_controlIndex].ApplyDesiredAction(request.m_action, request.m_mode,
+																						request.m_movingDurationMS,
+																						request.m_requestTime,
+																						request.m_latencyID);
+			}
+
+			ControlsProcessDue();
+		}
+
+		// Sleep until a control is due or a request arrives.
+		timespec timeout = {};
+		timespec* timeoutPointer = nullptr;
+
+		Time deadline;
+		if (s_controlScheduler.GetNextDeadline(deadline) == true)
+		{
+			auto const remainingTime = std::max(deadline - TimerClock::now(),
+															TimerClock::duration::zero());
+			auto const remainingSeconds =
+				std::chrono::duration_cast<std::chrono::seconds>(remainingTime);
+
+			timeout.tv_sec = remainingSeconds.count();
+			timeout.tv_nsec = (remainingTime - remainingSeconds).count();
+			timeoutPointer = &timeout;
+		}
+
+		pollfd wakePollFileDescriptor = {};
+		wakePollFileDescriptor.fd = s_actuationWakeFileDescriptor;
+		wakePollFileDescriptor.events = POLLIN;
+
+		if (ppoll(&wakePollFileDescriptor, 1, timeoutPointer, nullptr) > 0)
+		{
+			std::uint64_t counter = 0;
+			[[maybe_unused]] auto const readCount = read(s_actuationWakeFileDescriptor, &counter,
+																		sizeof(counter));
+		}
+	}
+}
+
 // Initialize all of the controls.
 //
 // configs: Configuration parameters for the controls to add.
 //
 void ControlsInitialize(std::vector<ControlConfig> const& configs)
 {
+	// Acquire every pin at once, so that they can all be set at once.
+	std::vector<int> pins;
+
+	for (auto const& config : configs)
+	{
+		pins.push_back(config.m_upGPIOPin);
+		pins.push_back(config.m_downGPIOPin);
+	}
+
+	GPIOAcquireOutputPins(pins);
+
 	for (auto const& config : configs)
 	{
 		ControlsCreateControl(config);
@@ -580,28 +1144,163 @@ void ControlsInitialize(std::vector<ControlConfig> const& configs)
 //
 void ControlsUninitialize()
 {
-	s_controlNameToIndexMap.clear();
-	
-	for (auto& control : s_controls)
+	// Take the controls back from the actuation thread, if they were handed off.
+	ControlsStopActuationThread();
+
+	for (unsigned int controlIndex = 0u; controlIndex < s_controlCount; controlIndex++)
 	{
-		control.Uninitialize();
+		s_controls[controlIndex].Uninitialize();
 	}
 	
 	// Get rid of all of the controls.
-	s_controls.clear();
+	s_controlCount = 0u;
+	GPIOReleaseOutputPins();
+	s_controlScheduler.Clear();
+	s_heldTransitionCount = 0u;
 }
 
-// Process all of the controls.
+// Process the controls that are due. If the actuation thread is running, this just announces what
+// it has done.
 //
 void ControlsProcess()
 {
-	for (auto& control : s_controls)
+	if (s_actuationThreadRunning == false)
 	{
-		control.Process();
-	}	
+		ControlsProcessDue();
+	}
+	else
+	{
+		ControlTransition transition;
+		while (s_transitionQueue.TryPop(transition) == true)
+		{
+			ControlsAnnounceTransition(transition);
+		}
+	}
+
+	auto const droppedTransitionCount = s_droppedTransitionCount.exchange(0u);
+
+	if (droppedTransitionCount > 0u)
+	{
+		Logger::WriteLine(Shell::Yellow("Missed announcing "), droppedTransitionCount,
+								Shell::Yellow(" control state transitions."));
+	}
+}
+
+// Get the next time that any of the controls need to be processed, if any.
+//
+// deadline:	(Output) The time by which the controls need to be processed.
+//
+// Returns:	True if a control needs to be processed again, false if they are all idle.
+//
+bool ControlsGetNextDeadline(Time& deadline)
+{
+	// The actuation thread keeps its own time, and wakes us when there's something to announce.
+	if (s_actuationThreadRunning == true)
+	{
+		return false;
+	}
+
+	return s_controlScheduler.GetNextDeadline(deadline);
 }
 
-// Create a new control with the provided config. Control names must be unique.
+// Start processing the controls on a dedicated thread with real-time priority, so that the pins
+// change as soon as they should regardless of what the main thread is doing. The controls should
+// all be created first.
+//
+// priority:	The SCHED_FIFO priority for the thread.
+//
+// Returns:	True if the thread was started, false otherwise.
+//
+bool ControlsStartActuationThread(int priority)
+{
+	if (s_actuationThreadRunning == true)
+	{
+		return true;
+	}
+
+	Logger::WriteLine("Starting the actuation thread...");
+
+	s_actuationWakeFileDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if (s_actuationWakeFileDescriptor < 0)
+	{
+		Logger::WriteLine('\t', Shell::Red("failed to create wake event"));
+		return false;
+	}
+
+	// Keep page faults out of the actuation path. This is best effort, because it needs privileges.
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+	{
+		Logger::WriteLine('\t', Shell::Yellow("failed to lock memory: "), std::strerror(errno));
+	}
+
+	s_actuationThreadQuit = false;
+	s_actuationThreadRunning = true;
+
+	s_actuationThread = std::thread(ControlsActuationThreadMain);
+
+	sched_param schedulingParameters = {};
+	schedulingParameters.sched_priority = priority;
+
+	auto const result = pthread_setschedparam(s_actuationThread.native_handle(), SCHED_FIFO,
+															&schedulingParameters);
+
+	// The thread still works without real-time priority, but nothing bounds how late it runs.
+	if (result != 0)
+	{
+		Logger::WriteLine('\t', Shell::Yellow("failed to set real-time priority "), priority,
+								Shell::Yellow(": "), std::strerror(result));
+		Logger::WriteLine('\t', Shell::Yellow("running without real-time priority"));
+		Logger::WriteLine();
+		return true;
+	}
+
+	Logger::WriteLine('\t', Shell::Green("succeeded"));
+	Logger::WriteLine();
+	return true;
+}
+
+// Stop processing the controls on the dedicated thread, if they were, and go back to processing them
+// on the main thread.
+//
+void ControlsStopActuationThread()
+{
+	if (s_actuationThreadRunning == false)
+	{
+		return;
+	}
+
+	s_actuationThreadQuit.store(true, std::memory_order_release);
+
+	std::uint64_t const increment = 1;
+	[[maybe_unused]] auto const writeCount = write(s_actuationWakeFileDescriptor, &increment,
+																  sizeof(increment));
+
+	s_actuationThread.join();
+
+	// Announce whatever is left.
+	ControlsProcess();
+
+	s_actuationThreadRunning = false;
+
+	// Anything that was requested but not yet applied still should be.
+	ControlRequest request;
+	while (s_requestQueue.TryPop(request) == true)
+	{
+		s_controls[request.m_controlIndex].ApplyDesiredAction(request.m_action, request.m_mode,
+																				request.m_movingDurationMS,
+																				request.m_requestTime,
+																				request.m_latencyID);
+	}
+
+	close(s_actuationWakeFileDescriptor);
+	s_actuationWakeFileDescriptor = -1;
+
+	munlockall();
+}
+
+// Create a new control with the provided config. Control names must be unique, and its pins must
+// already have been acquired, which ControlsInitialize takes care of.
 //
 // config:	Configuration parameters for the control.
 //
@@ -610,21 +1309,26 @@ void ControlsProcess()
 bool ControlsCreateControl(ControlConfig const& config)
 {
 	// Check to see whether a control with this name already exists.
-	if (s_controlNameToIndexMap.find(config.m_name) != s_controlNameToIndexMap.end())
+	if (Control::GetHandleByName(config.m_name) != kInvalidControlHandle)
 	{
 		Logger::WriteLine("Control with name \"", config.m_name, "\" already exists.");
 		return false;
 	}
+
+	if (s_controlCount >= kMaxControlCount)
+	{
+		Logger::WriteLine("Control with name \"", config.m_name, "\" can't be created, because there ",
+								"are already ", kMaxControlCount, " controls.");
+		return false;
+	}
 	
-	// Add a new control.
-	s_controls.emplace_back(Control());
-	
+	// Add a new control, which the handle refers to from here on.
+	ControlHandle const controlIndex = s_controlCount;
+	s_controls[controlIndex] = Control();
+	s_controlCount++;
+
 	// Then, initialize it.
-	unsigned int const controlIndex = s_controls.size() - 1;
-	s_controls[controlIndex].Initialize(config);
-	
-	// And add it to the map.
-	s_controlNameToIndexMap.insert({config.m_name, controlIndex});
+	s_controls[controlIndex].Initialize(config, controlIndex);
 
 	return true;
 }
@@ -633,8 +1337,40 @@ bool ControlsCreateControl(ControlConfig const& config)
 //
 void ControlsStopAll()
 {
-	for (auto& control : s_controls)
+	auto const requestTime = TimerClock::now();
+
+	// Hand over every stop before logging anything, so that the last control stops as soon as the
+	// first. Stopping doesn't use the moving duration.
+	auto const RequestStops = [requestTime]()
+	{
+		for (unsigned int controlIndex = 0u; controlIndex < s_controlCount; controlIndex++)
+		{
+			s_controls[controlIndex].RequestDesiredAction(Control::kActionStopped,
+																		 Control::kModeManual, 0u, requestTime);
+		}
+	};
+
+	if (s_actuationThreadRunning == true)
+	{
+		// The actuation thread batches the stops itself.
+		RequestStops();
+	}
+	else
 	{
-		control.SetDesiredAction(Control::kActionStopped, Control::kModeManual);
+		// Any pins that change, change at once.
+		ControlPinBatch const pinBatch;
+		RequestStops();
 	}
+
+	Logger::WriteLine("Stopping all controls.");
+}
+
+// Set whether measured latencies, like the time from a key press to the pins changing, are written
+// into the reports as they happen. They're always available in the stats either way.
+//
+// enable:	Whether to write latencies into the reports.
+//
+void ControlsSetLatencyReportsEnabled(bool enable)
+{
+	s_latencyReportsEnabled = enable;
 }
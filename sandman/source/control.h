@@ -1,14 +1,23 @@
 #pragma once
 
+#include <string_view>
 #include <vector>
 
 #include "rapidjson/document.h"
 
+#include "stats.h"
 #include "timer.h"
 
 // Types
 //
 
+// A small integer that identifies a control. Names are resolved to handles once, when whatever
+// refers to the control is loaded, so that acting on a control never has to search for it.
+using ControlHandle = unsigned int;
+
+// A handle that doesn't refer to any control.
+static constexpr ControlHandle kInvalidControlHandle{ ~0u };
+
 // Configuration parameters to initialize a control.
 struct ControlConfig
 {
@@ -68,8 +77,9 @@ class Control
 		// Handle initialization.
 		//
 		// config:	Configuration parameters for the control.
+		// index:	The index of the control.
 		//
-		void Initialize(ControlConfig const& config);
+		void Initialize(ControlConfig const& config, unsigned int index);
 
 		// Handle uninitialization.
 		//
@@ -79,6 +89,19 @@ class Control
 		//
 		void Process();
 
+		// Get the next time that the control needs to be processed, if any.
+		//
+		// deadline:	(Output) The time by which the control needs to be processed.
+		//
+		// Returns:	True if the control needs to be processed again, false if it's idle.
+		//
+		bool GetNextDeadline(Time& deadline) const;
+
+		// Register the next time that the control needs to be processed with the scheduler, or
+		// remove it from the scheduler if it doesn't need to be processed.
+		//
+		void Schedule() const;
+
 		// Set the desired action.
 		//
 		// desiredAction:		The desired action.
@@ -88,6 +111,41 @@ class Control
 		//
 		void SetDesiredAction(Actions desiredAction, Modes mode, unsigned int durationPercent = 100);
 
+		// Set the desired action on behalf of something that happened earlier, like a key press, and
+		// measure the time from then until the pins change.
+		//
+		// desiredAction:		The desired action.
+		// mode:					The mode of the action.
+		// durationPercent:	The percent of the normal duration to perform the action for.
+		// requestTime:		When the thing that wants the action happened.
+		// latencyID:			Where to record the time until the pins change, or kStatsNoLatency.
+		//
+		void SetDesiredAction(Actions desiredAction, Modes mode, unsigned int durationPercent,
+									 Time const& requestTime, StatsLatencyID latencyID);
+
+		// Hand a desired action to whichever thread processes the controls, without logging it.
+		//
+		// desiredAction:		The desired action.
+		// mode:					The mode of the action.
+		// movingDurationMS:	How long moving should last (in milliseconds).
+		// requestTime:		When the action was requested.
+		// latencyID:			(Optional) Where to record the time until the pins change.
+		//
+		void RequestDesiredAction(Actions desiredAction, Modes mode, unsigned int movingDurationMS,
+										  Time const& requestTime, StatsLatencyID latencyID = kStatsNoLatency);
+
+		// Apply a desired action right away. This must only be called from the thread that
+		// processes the controls, so use SetDesiredAction otherwise.
+		//
+		// desiredAction:		The desired action.
+		// mode:					The mode of the action.
+		// movingDurationMS:	How long moving should last (in milliseconds).
+		// requestTime:		When the action was requested.
+		// latencyID:			Where to record the time until the pins change, or kStatsNoLatency.
+		//
+		void ApplyDesiredAction(Actions desiredAction, Modes mode, unsigned int movingDurationMS,
+										Time const& requestTime, StatsLatencyID latencyID);
+
 		// Get the name.
 		//
 		char const* GetName() const
@@ -95,7 +153,7 @@ class Control
 			return m_name;
 		}
 
-		// Get the state.
+		// Get the state. This is only meaningful on the thread that processes the controls.
 		//
 		State GetState() const
 		{
@@ -114,6 +172,14 @@ class Control
 		// coolDownDurationMS:	Duration of the cool down state (in milliseconds).
 		//
 		static void SetDurations(unsigned int movingDurationMS, unsigned int coolDownDurationMS);
+
+		// Set whether requests are acted upon right away, changing the pins before the request
+		// returns, rather than the next time the controls are processed. The cool down and
+		// direction change rules apply either way.
+		//
+		// immediate:	Whether to act upon requests right away.
+		//
+		static void SetImmediateActuation(bool immediate);
 		
 		// Look up a control by its name.
 		//
@@ -121,19 +187,43 @@ class Control
 		//
 		// Returns:		The control, or null if one with the name could not be found.
 		//
-		static Control* GetByName(std::string const& name);
+		static Control* GetByName(std::string_view name);
+
+		// Look up the handle of a control by its name. This searches, so it's meant to be done once,
+		// when whatever refers to the control is loaded.
+		//
+		// name:	The name of the control.
+		//
+		// Returns:		The handle of the control, or kInvalidControlHandle if one with the name could
+		//					not be found.
+		//
+		static ControlHandle GetHandleByName(std::string_view name);
+
+		// Get a control from its handle.
+		//
+		// handle:	The handle of the control.
+		//
+		// Returns:		The control, or null if the handle doesn't refer to one.
+		//
+		static Control* GetByHandle(ControlHandle handle);
 		
 	private:
 
 		// Constants.
 		static constexpr unsigned int kNameCapacity = 32u;
 
-		// Play a notification for the state.
+		// Have a state transition announced on the main thread, once the pins have changed.
+		//
+		// oldState:			The state before the transition.
+		// transitionTime:	When the pins were changed.
 		//
-		void PlayNotification();
+		void AnnounceTransition(State oldState, Time const& transitionTime);
 		
 		// The name of the control.
 		char m_name[kNameCapacity];
+
+		// The index of the control, which also identifies it to the scheduler.
+		unsigned int m_index;
 		
 		// The control state.
 		State m_state;
@@ -141,6 +231,13 @@ class Control
 		// A record of when the state transition timer began.
 		Time m_stateStartTime;
 
+		// Whether an action was requested since the control was last processed, and when.
+		bool m_hasPendingRequest = false;
+		Time m_requestTime;
+
+		// Where to record the time from the request until the pins change.
+		StatsLatencyID m_latencyID = kStatsNoLatency;
+
 		// The desired action.
 		Actions m_desiredAction;
 
@@ -162,6 +259,9 @@ class Control
 		
 		// Maximum duration of the cool down state (in milliseconds).
 		static unsigned int ms_coolDownDurationMS;	
+
+		// Whether requests are acted upon right away.
+		static bool ms_immediateActuation;
 };
 
 // Enough information to trigger a specific control action.
@@ -181,7 +281,14 @@ struct ControlAction
 	//
 	bool ReadFromJSON(rapidjson::Value const& object);
 
-	// Attempt to get the control corresponding to the control action.
+	// Look up the control named by the control action and remember its handle. The controls must
+	// have been created first.
+	//
+	// Returns:	True if the control was found, false otherwise.
+	//
+	bool Resolve();
+
+	// Attempt to get the control corresponding to the control action. It must have been resolved.
 	//
 	// Returns:	The control if successful, null otherwise.
 	//
@@ -195,6 +302,9 @@ struct ControlAction
 	
 	// The action for the control.
 	Control::Actions m_action;
+
+	// The control to manipulate, once the control action has been resolved.
+	ControlHandle m_controlHandle = kInvalidControlHandle;
 };
 
 
@@ -211,11 +321,20 @@ void ControlsInitialize(std::vector<ControlConfig> const& configs);
 //
 void ControlsUninitialize();
 
-// Process all of the controls.
+// Process the controls that are due.
 //
 void ControlsProcess();
 
-// Create a new control with the provided config. Control names must be unique.
+// Get the next time that any of the controls need to be processed, if any.
+//
+// deadline:	(Output) The time by which the controls need to be processed.
+//
+// Returns:	True if a control needs to be processed again, false if they are all idle.
+//
+bool ControlsGetNextDeadline(Time& deadline);
+
+// Create a new control with the provided config. Control names must be unique, and its pins must
+// already have been acquired, which ControlsInitialize takes care of.
 //
 // config:	Configuration parameters for the control.
 //
@@ -226,3 +345,25 @@ bool ControlsCreateControl(ControlConfig const& config);
 // Stop all of the controls.
 //
 void ControlsStopAll();
+
+// Set whether measured latencies, like the time from a key press to the pins changing, are written
+// into the reports as they happen. They're always available in the stats either way.
+//
+// enable:	Whether to write latencies into the reports.
+//
+void ControlsSetLatencyReportsEnabled(bool enable);
+
+// Start processing the controls on a dedicated thread with real-time priority, so that the pins
+// change as soon as they should regardless of what the main thread is doing. The controls should
+// all be created first.
+//
+// priority:	The SCHED_FIFO priority for the thread.
+//
+// Returns:	True if the thread was started, false otherwise.
+//
+bool ControlsStartActuationThread(int priority);
+
+// Stop processing the controls on the dedicated thread, if they were, and go back to processing them
+// on the main thread.
+//
+void ControlsStopActuationThread();
@@ -1,11 +1,9 @@
 #include "gpio.h"
 
-#include <map>
-
-#if defined ENABLE_GPIO
-	#include <gpiod.h>
-#endif // defined ENABLE_GPIO
+#include <array>
+#include <memory>
 
+#include "gpio_driver.h"
 #include "logger.h"
 
 // Constants
@@ -15,192 +13,220 @@
 static constexpr int kPinOnValue = 0;
 static constexpr int kPinOffValue = 1;
 
+// Pins are numbered below this. It's far more than any Raspberry Pi has.
+static constexpr int kMaxPinCount{ 64 };
+
+// Marks a pin that hasn't been acquired in the pin to line index table.
+static constexpr unsigned int kInvalidLineIndex{ ~0u };
+
 // Locals
 //
 
-#if defined ENABLE_GPIO
+// What drives the pins, or null if GPIO support couldn't be initialized.
+static std::unique_ptr<GPIODriver> s_driver;
 
-	// Whether controls can use GPIO or not.
-	static bool s_enableGPIO = true;
+// The number of pins that we have acquired, which were requested together so that they can be set
+// together.
+static unsigned int s_lineCount = 0u;
 
-	// The interface with the pins through the chip they are controlled by.
-	static gpiod_chip* s_chip = nullptr;
+// The index into the acquired lines of each pin, or kInvalidLineIndex if it hasn't been acquired.
+static std::array<unsigned int, kMaxPinCount> s_pinToLineIndex;
 
-	// A mapping of all of the pins that we have acquired.
-	static std::map<int, gpiod_line*> s_pinToLineMap;
+// The value of each acquired line, in the same order as the lines. Setting the lines always sets
+// all of them, so these have to be kept up to date.
+static std::array<int, kMaxPinCount> s_lineValues;
 
-#endif // defined ENABLE_GPIO
+// Whether the line values have changed since they were last set.
+static bool s_lineValuesChanged = false;
+
+// Whether the last attempt to set the lines failed, so that a run of failures is only logged once.
+static bool s_lineValuesFailed = false;
+
+// How many pin batches are holding back pin changes.
+static unsigned int s_pinBatchDepth = 0u;
 
 // Functions
 //
 
-// Initialize GPIO support.
+// Initialize GPIO support. Without it, the pins are only recorded.
 //
 // enableGPIO: Whether to turn on GPIO or not.
 //
 void GPIOInitialize(bool const enableGPIO)
 {
+	s_driver.reset();
+
 	#if defined ENABLE_GPIO
-	
-		s_enableGPIO = enableGPIO;
 
-		if (s_enableGPIO == true)
+		if (enableGPIO == true)
 		{
-			Logger::WriteLine("Initializing GPIO support...");
-	
-			// RPI5 attempt.
-			s_chip = gpiod_chip_open_by_name("gpiochip4");
-
-			if (s_chip == nullptr)
-			{
-				s_chip = gpiod_chip_open_by_name("gpiochip0");
-			}
-
-			if (s_chip == nullptr)
-			{
-				Logger::WriteLine('\t', Shell::Red("failed"));
-				return;
-			}
-
-			Logger::WriteLine('\t', Shell::Green("succeeded"));
+			s_driver = GPIODriverCreateHardware();
 		}
-		else
-		{
-			Logger::WriteLine("GPIO support not enabled, initialization skipped.");
-		}
-		
-		Logger::WriteLine();
+
+	#else
+
+		static_cast<void>(enableGPIO);
 
 	#endif // defined ENABLE_GPIO
-}
 
-// Uninitialize GPIO support.
-// 
-void GPIOUninitialize()
-{
-	#if defined ENABLE_GPIO
-	
-		if (s_enableGPIO == false)
-		{
-			return;
-		}
+	// Without hardware, keep track of what the pins would have been set to.
+	if (s_driver == nullptr)
+	{
+		s_driver = std::make_unique<GPIORecordingDriver>();
+	}
 
-		if (s_chip == nullptr)
-		{
-			return;
-		}
+	Logger::WriteLine("Initializing GPIO support (", s_driver->GetName(), ")...");
 
-		// Release all of the pins.
-		for (auto& pair : s_pinToLineMap)
-		{
-			gpiod_line_release(pair.second);
-		}
-		s_pinToLineMap.clear();
+	if (s_driver->Open() == false)
+	{
+		s_driver.reset();
+		Logger::WriteLine('\t', Shell::Red("failed"));
+		return;
+	}
 
-		gpiod_chip_close(s_chip);
-		s_chip = nullptr;
-	
-	#endif // defined ENABLE_GPIO
+	Logger::WriteLine('\t', Shell::Green("succeeded"));
+	Logger::WriteLine();
 }
 
-// Acquire a GPIO pin as output.
+// Uninitialize GPIO support.
 //
-// pin:	The GPIO pin to acquire as output.
-// 
-void GPIOAcquireOutputPin(int pin)
+void GPIOUninitialize()
 {
-	#if defined ENABLE_GPIO
-	
-		if (s_enableGPIO == false)
-		{
-			Logger::WriteLine("Would have acquired GPIO ", pin, 
-									" pin for output, but it's not enabled.");
-			return;
-		}
+	if (s_driver == nullptr)
+	{
+		return;
+	}
 
-		if (s_chip == nullptr)
-		{
-			Logger::WriteLine(Shell::Red("No chip when attempting to acquire GPIO "), pin, 
-									Shell::Red(" pin for output."));
-			return;
-		}
+	GPIOReleaseOutputPins();
 
-		if (s_pinToLineMap.find(pin) != s_pinToLineMap.end())
-		{
-			Logger::WriteLine(Shell::Yellow("Attempted to acquire GPIO "), pin, 
-									Shell::Yellow(" pin for output, but it's already been acquired."));
-			return;
-		}
+	s_driver->Close();
+	s_driver.reset();
+}
 
-		auto* line = gpiod_chip_get_line(s_chip, pin);
+// Get the driver for the pins.
+//
+// Returns:	The driver, or null if GPIO support isn't initialized.
+//
+GPIODriver* GPIOGetDriver()
+{
+	return s_driver.get();
+}
 
-		if (line == nullptr)
+// Acquire GPIO pins as outputs, all together, and set them to the "off" value. Every pin that will
+// be used has to be acquired at once, and they stay acquired until they are released.
+//
+// pins:	The GPIO pins to acquire as outputs.
+//
+void GPIOAcquireOutputPins(std::vector<int> const& pins)
+{
+	if (s_driver == nullptr)
+	{
+		Logger::WriteLine(Shell::Red("No chip when attempting to acquire GPIO pins for output."));
+		return;
+	}
+
+	if (s_lineCount > 0u)
+	{
+		Logger::WriteLine(Shell::Yellow("Attempted to acquire GPIO pins for output, but some have "
+												  "already been acquired."));
+		return;
+	}
+
+	// Build the table of which line each pin is.
+	s_pinToLineIndex.fill(kInvalidLineIndex);
+
+	std::array<unsigned int, kMaxPinCount> lineOffsets;
+	unsigned int lineCount = 0u;
+
+	for (auto const pin : pins)
+	{
+		if ((pin < 0) || (pin >= kMaxPinCount))
 		{
-			Logger::WriteLine(Shell::Red("Failed to get line when attempting to acquire GPIO "), pin,
-									Shell::Red(" pin for output."));
-			return;
+			Logger::WriteLine(Shell::Red("Can't acquire GPIO "), pin,
+									Shell::Red(" pin for output, because it's out of range."));
+			continue;
 		}
 
-		if (gpiod_line_request_output(line, "sandman", 0) < 0)
+		// Controls may share pins, but a line can only be requested once.
+		if (s_pinToLineIndex[pin] != kInvalidLineIndex)
 		{
-			Logger::WriteLine(Shell::Red("Failed to set pin to output when trying to acquire GPIO "),
-									pin, Shell::Red(" pin for output."));
-			gpiod_line_release(line);
-			return;
+			continue;
 		}
 
-		// Add a record.
-		s_pinToLineMap.insert({pin, line});
-
-	#else
-
-		Logger::WriteLine("A Raspberry Pi would have tried to acquire GPIO ", pin, 
-								" pin for output.");
+		s_pinToLineIndex[pin] = lineCount;
+		lineOffsets[lineCount] = static_cast<unsigned int>(pin);
+		s_lineValues[lineCount] = kPinOffValue;
+		lineCount++;
+	}
+
+	if (lineCount == 0u)
+	{
+		return;
+	}
+
+	if (s_driver->RequestOutputLines(lineOffsets.data(), s_lineValues.data(), lineCount) == false)
+	{
+		Logger::WriteLine(Shell::Red("Failed to acquire "), lineCount,
+								Shell::Red(" GPIO pins for output."));
+		s_pinToLineIndex.fill(kInvalidLineIndex);
+		return;
+	}
+
+	s_lineCount = lineCount;
+	s_lineValuesChanged = false;
+	s_lineValuesFailed = false;
+}
 
-	#endif // defined ENABLE_GPIO
+// Release all of the GPIO pins that were acquired.
+//
+void GPIOReleaseOutputPins()
+{
+	if ((s_driver == nullptr) || (s_lineCount == 0u))
+	{
+		return;
+	}
+
+	s_driver->ReleaseLines();
+
+	// Forget the lines, along with any changes that never made it to them.
+	s_lineCount = 0u;
+	s_pinToLineIndex.fill(kInvalidLineIndex);
+	s_lineValuesChanged = false;
+	s_lineValuesFailed = false;
 }
 
-// Release a GPIO pin.
+// Set all of the acquired lines to the values they should have, if any have changed.
 //
-// pin:  The GPIO pin to release.
+// Returns:	True if the lines have the values they should have, false if setting them failed.
 //
-void GPIOReleasePin(int pin)
+static bool GPIOFlushLineValues()
 {
-	#if defined ENABLE_GPIO
-
-		if (s_enableGPIO == false)
-		{
-			Logger::WriteLine("Would have released GPIO ", pin, " pin, but it's not enabled.");
-			return;
-		}
-
-		if (s_chip == nullptr)
+	if (s_lineValuesChanged == false)
+	{
+		return true;
+	}
+
+	// If this fails, the changes stay pending, so the next flush tries them again.
+	if (s_driver->SetLineValues(s_lineValues.data()) == false)
+	{
+		if (s_lineValuesFailed == false)
 		{
-			Logger::WriteLine(Shell::Red("No chip when attempting to release GPIO "), pin, 
-									Shell::Red(" pin."));
-			return;
+			Logger::WriteLine(Shell::Red("Attempted to set "), s_lineCount,
+									Shell::Red(" GPIO pins, but there was an error."));
+			s_lineValuesFailed = true;
 		}
 
-		// See if we have acquired the pin.
-		auto pinIterator = s_pinToLineMap.find(pin);
-		if (pinIterator == s_pinToLineMap.end())
-		{
-			Logger::WriteLine(Shell::Yellow("Attempted to release GPIO "), pin, 
-									Shell::Yellow(" pin, but hasn't been acquired."));
-			return;
-		}
-
-		auto* line = pinIterator->second;
-		gpiod_line_release(line);
-
-		// Erase our record.
-		s_pinToLineMap.erase(pinIterator);
-
-	#else
+		return false;
+	}
 
-		Logger::WriteLine("A Raspberry Pi would have tried to release GPIO ", pin, " pin.");
+	if (s_lineValuesFailed == true)
+	{
+		Logger::WriteLine("Set ", s_lineCount, " GPIO pins after an earlier error.");
+		s_lineValuesFailed = false;
+	}
 
-	#endif // defined ENABLE_GPIO
+	s_lineValuesChanged = false;
+	return true;
 }
 
 // Set the given GPIO pin to a specific value.
@@ -212,45 +238,36 @@ static void GPIOSetPinValue(int pin, int value)
 {
 	const char* valueString = (value == kPinOffValue) ? "off" : "on";
 
-	#if defined ENABLE_GPIO
-
-		if (s_enableGPIO == false)
-		{
-			Logger::WriteLine("Would have set GPIO ", pin, " to ", valueString, 
-									", but it's not enabled.");
-			return;
-		}
-
-		if (s_chip == nullptr)
-		{
-			Logger::WriteLine(Shell::Red("No chip when attempting to set GPIO "), pin, 
-									Shell::Red(" pin to "), valueString, Shell::Red("."));
-			return;
-		}
-
-		// See if we have acquired the pin.
-		auto pinIterator = s_pinToLineMap.find(pin);
-		if (pinIterator == s_pinToLineMap.end())
-		{
-			Logger::WriteLine(Shell::Yellow("Attempted to set GPIO "), pin, 
-									Shell::Yellow(" pin to "), valueString, 
-									Shell::Yellow(", but hasn't been acquired."));
-			return;
-		}
-
-		auto* line = pinIterator->second;
-		if (gpiod_line_set_value(line, value) < 0)
-		{
-			Logger::WriteLine(Shell::Red("Attempted to set GPIO "), pin, 
-									Shell::Red(" pin to "), valueString, 
-									Shell::Red(", but there was an error."));
-		}
-
-	#else
-
-		Logger::WriteLine("A Raspberry Pi would have set GPIO ", pin, " to ", valueString, ".");
-
-	#endif // defined ENABLE_GPIO
+	if (s_driver == nullptr)
+	{
+		Logger::WriteLine(Shell::Red("No chip when attempting to set GPIO "), pin,
+								Shell::Red(" pin to "), valueString, Shell::Red("."));
+		return;
+	}
+
+	// See if we have acquired the pin.
+	auto const lineIndex = ((pin >= 0) && (pin < kMaxPinCount)) ? s_pinToLineIndex[pin] :
+		kInvalidLineIndex;
+
+	if (lineIndex >= s_lineCount)
+	{
+		Logger::WriteLine(Shell::Yellow("Attempted to set GPIO "), pin,
+								Shell::Yellow(" pin to "), valueString,
+								Shell::Yellow(", but hasn't been acquired."));
+		return;
+	}
+
+	if (s_lineValues[lineIndex] != value)
+	{
+		s_lineValues[lineIndex] = value;
+		s_lineValuesChanged = true;
+	}
+
+	// A batch sets everything at once when it's done.
+	if (s_pinBatchDepth == 0u)
+	{
+		GPIOFlushLineValues();
+	}
 }
 
 // Set the given GPIO pin to the "on" value.
@@ -271,3 +288,33 @@ void GPIOSetPinOff(int pin)
 	GPIOSetPinValue(pin, kPinOffValue);
 }
 
+// Find out whether there are pin changes that haven't been made yet, because setting the pins
+// failed or a batch is still holding them back.
+//
+// Returns:	True if there are pin changes waiting, false otherwise.
+//
+bool GPIOArePinChangesPending()
+{
+	return (s_driver != nullptr) && (s_lineValuesChanged == true);
+}
+
+// GPIOPinBatch members
+
+// Start holding back pin changes.
+//
+GPIOPinBatch::GPIOPinBatch()
+{
+	s_pinBatchDepth++;
+}
+
+// Make the pin changes that were held back.
+//
+GPIOPinBatch::~GPIOPinBatch()
+{
+	s_pinBatchDepth--;
+
+	if ((s_pinBatchDepth == 0u) && (s_driver != nullptr))
+	{
+		GPIOFlushLineValues();
+	}
+}
@@ -1,30 +1,60 @@
 #pragma once
 
+#include <vector>
+
+class GPIODriver;
+
+// Types
+//
+
+// Holds back pin changes from the time it's constructed until it's destroyed, then makes them all
+// at once. Every pin that changes in between changes at the same instant, with one system call.
+// Batches may be nested, in which case the changes are made when the outermost one is destroyed.
+class GPIOPinBatch
+{
+	public:
+
+		// Start holding back pin changes.
+		//
+		GPIOPinBatch();
+
+		// Make the pin changes that were held back.
+		//
+		~GPIOPinBatch();
+
+		GPIOPinBatch(GPIOPinBatch const&) = delete;
+		GPIOPinBatch& operator=(GPIOPinBatch const&) = delete;
+};
 
 // Functions
 //
 
-// Initialize GPIO support.
+// Initialize GPIO support. Without it, the pins are only recorded.
 //
 // enableGPIO: Whether to turn on GPIO or not.
 //
 void GPIOInitialize(bool const enableGPIO);
 
 // Uninitialize GPIO support.
-// 
+//
 void GPIOUninitialize();
 
-// Acquire a GPIO pin as output.
+// Get the driver for the pins.
 //
-// pin:	The GPIO pin to acquire as output.
+// Returns:	The driver, or null if GPIO support isn't initialized.
 //
-void GPIOAcquireOutputPin(int pin);
+GPIODriver* GPIOGetDriver();
 
-// Release a GPIO pin.
+// Acquire GPIO pins as outputs, all together, and set them to the "off" value. Every pin that will
+// be used has to be acquired at once, and they stay acquired until they are released.
+//
+// pins:	The GPIO pins to acquire as outputs.
 //
-// pin:  The GPIO pin to release.
+void GPIOAcquireOutputPins(std::vector<int> const& pins);
+
+// Release all of the GPIO pins that were acquired.
 //
-void GPIOReleasePin(int pin);
+void GPIOReleaseOutputPins();
 
 // Set the given GPIO pin to the "on" value.
 //
@@ -38,3 +68,9 @@ void GPIOSetPinOn(int pin);
 //
 void GPIOSetPinOff(int pin);
 
+// Find out whether there are pin changes that haven't been made yet, because setting the pins
+// failed or a batch is still holding them back. The next batch to finish tries them again.
+//
+// Returns:	True if there are pin changes waiting, false otherwise.
+//
+bool GPIOArePinChangesPending();
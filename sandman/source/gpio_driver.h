@@ -0,0 +1,125 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+// Types
+//
+
+// The interface to whatever actually drives the GPIO lines. Lines are requested all together and
+// always set all together, in the order they were requested, which is what the kernel's line
+// requests are best at.
+class GPIODriver
+{
+	public:
+
+		virtual ~GPIODriver() = default;
+
+		// Get the name of the driver, for logging.
+		//
+		virtual char const* GetName() const = 0;
+
+		// Open the GPIO chip.
+		//
+		// Returns:	True on success, false on failure.
+		//
+		virtual bool Open() = 0;
+
+		// Close the GPIO chip, releasing the lines if they were requested.
+		//
+		virtual void Close() = 0;
+
+		// Request lines as outputs, all together.
+		//
+		// offsets:		The offsets of the lines on the chip.
+		// values:		The value each line should start with.
+		// lineCount:	The number of lines.
+		//
+		// Returns:	True on success, false on failure.
+		//
+		virtual bool RequestOutputLines(unsigned int const* offsets, int const* values,
+												  unsigned int lineCount) = 0;
+
+		// Release the lines that were requested.
+		//
+		virtual void ReleaseLines() = 0;
+
+		// Set every requested line at once.
+		//
+		// values:	The value for each line, in the order they were requested.
+		//
+		// Returns:	True on success, false on failure.
+		//
+		virtual bool SetLineValues(int const* values) = 0;
+};
+
+// A driver for when there's no GPIO hardware to use. It keeps track of what the lines would have
+// been set to, so that they can be checked, and logs the changes.
+class GPIORecordingDriver : public GPIODriver
+{
+	public:
+
+		char const* GetName() const override
+		{
+			return "recording";
+		}
+
+		bool Open() override;
+
+		void Close() override;
+
+		bool RequestOutputLines(unsigned int const* offsets, int const* values,
+										unsigned int lineCount) override;
+
+		void ReleaseLines() override;
+
+		bool SetLineValues(int const* values) override;
+
+		// Get the value that a line was last set to.
+		//
+		// offset:	The offset of the line.
+		// value:	(Output) The value of the line.
+		//
+		// Returns:	True if the line was requested, false otherwise.
+		//
+		bool GetLineValue(unsigned int offset, int& value) const;
+
+		// Get the number of times the lines have been set, not counting when they were requested.
+		//
+		unsigned int GetSetCount() const
+		{
+			return m_setCount;
+		}
+
+		// Make setting the lines fail, as if the hardware had refused, or work again.
+		//
+		// failing:	Whether setting the lines should fail.
+		//
+		void SetFailing(bool failing)
+		{
+			m_failing = failing;
+		}
+
+	private:
+
+		// The offsets of the requested lines.
+		std::vector<unsigned int> m_offsets;
+
+		// The value of each requested line, in the same order.
+		std::vector<int> m_values;
+
+		// The number of times the lines have been set.
+		unsigned int m_setCount = 0u;
+
+		// Whether setting the lines fails.
+		bool m_failing = false;
+};
+
+// Functions
+//
+
+// Create a driver for the GPIO hardware, using whichever version of libgpiod we were built with.
+//
+// Returns:	The driver.
+//
+std::unique_ptr<GPIODriver> GPIODriverCreateHardware();
@@ -0,0 +1,110 @@
+#include "gpio_driver.h"
+
+#include "logger.h"
+
+// GPIORecordingDriver members
+
+// Open the GPIO chip.
+//
+// Returns:	True on success, false on failure.
+//
+bool GPIORecordingDriver::Open()
+{
+	return true;
+}
+
+// Close the GPIO chip, releasing the lines if they were requested.
+//
+void GPIORecordingDriver::Close()
+{
+	ReleaseLines();
+}
+
+// Request lines as outputs, all together.
+//
+// offsets:		The offsets of the lines on the chip.
+// values:		The value each line should start with.
+// lineCount:	The number of lines.
+//
+// Returns:	True on success, false on failure.
+//
+bool GPIORecordingDriver::RequestOutputLines(unsigned int const* offsets, int const* values,
+															unsigned int lineCount)
+{
+	m_offsets.assign(offsets, offsets + lineCount);
+	m_values.assign(values, values + lineCount);
+	m_setCount = 0u;
+
+	for (auto const offset : m_offsets)
+	{
+		Logger::WriteLine("Would have acquired GPIO ", offset, " pin for output.");
+	}
+
+	return true;
+}
+
+// Release the lines that were requested.
+//
+void GPIORecordingDriver::ReleaseLines()
+{
+	if (m_offsets.empty() == true)
+	{
+		return;
+	}
+
+	Logger::WriteLine("Would have released ", m_offsets.size(), " GPIO pins.");
+
+	m_offsets.clear();
+	m_values.clear();
+}
+
+// Set every requested line at once.
+//
+// values:	The value for each line, in the order they were requested.
+//
+// Returns:	True on success, false on failure.
+//
+bool GPIORecordingDriver::SetLineValues(int const* values)
+{
+	if (m_failing == true)
+	{
+		return false;
+	}
+
+	for (std::size_t lineIndex = 0u; lineIndex < m_values.size(); lineIndex++)
+	{
+		if (m_values[lineIndex] == values[lineIndex])
+		{
+			continue;
+		}
+
+		m_values[lineIndex] = values[lineIndex];
+
+		Logger::WriteLine("Would have set GPIO ", m_offsets[lineIndex], " to ", values[lineIndex],
+								".");
+	}
+
+	m_setCount++;
+	return true;
+}
+
+// Get the value that a line was last set to.
+//
+// offset:	The offset of the line.
+// value:	(Output) The value of the line.
+//
+// Returns:	True if the line was requested, false otherwise.
+//
+bool GPIORecordingDriver::GetLineValue(unsigned int offset, int& value) const
+{
+	for (std::size_t lineIndex = 0u; lineIndex < m_offsets.size(); lineIndex++)
+	{
+		if (m_offsets[lineIndex] == offset)
+		{
+			value = m_values[lineIndex];
+			return true;
+		}
+	}
+
+	return false;
+}
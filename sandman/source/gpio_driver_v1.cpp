@@ -0,0 +1,161 @@
+// A GPIO driver for libgpiod 1.x, which is what older Raspberry Pi OS images ship.
+
+#include "gpio_driver.h"
+
+#include <gpiod.h>
+
+#include "logger.h"
+
+// Types
+//
+
+// Drives the lines through the libgpiod 1.x line bulk API.
+class GPIOV1Driver : public GPIODriver
+{
+	public:
+
+		~GPIOV1Driver() override
+		{
+			Close();
+		}
+
+		char const* GetName() const override
+		{
+			return "libgpiod v1";
+		}
+
+		bool Open() override;
+
+		void Close() override;
+
+		bool RequestOutputLines(unsigned int const* offsets, int const* values,
+										unsigned int lineCount) override;
+
+		void ReleaseLines() override;
+
+		bool SetLineValues(int const* values) override;
+
+	private:
+
+		// The chip the lines are on.
+		gpiod_chip* m_chip = nullptr;
+
+		// The requested lines.
+		gpiod_line_bulk m_lines;
+		bool m_linesRequested = false;
+};
+
+// GPIOV1Driver members
+
+// Open the GPIO chip.
+//
+// Returns:	True on success, false on failure.
+//
+bool GPIOV1Driver::Open()
+{
+	// RPI5 attempt.
+	m_chip = gpiod_chip_open_by_name("gpiochip4");
+
+	if (m_chip == nullptr)
+	{
+		m_chip = gpiod_chip_open_by_name("gpiochip0");
+	}
+
+	return m_chip != nullptr;
+}
+
+// Close the GPIO chip, releasing the lines if they were requested.
+//
+void GPIOV1Driver::Close()
+{
+	ReleaseLines();
+
+	if (m_chip != nullptr)
+	{
+		gpiod_chip_close(m_chip);
+		m_chip = nullptr;
+	}
+}
+
+// Request lines as outputs, all together.
+//
+// offsets:		The offsets of the lines on the chip.
+// values:		The value each line should start with.
+// lineCount:	The number of lines.
+//
+// Returns:	True on success, false on failure.
+//
+bool GPIOV1Driver::RequestOutputLines(unsigned int const* offsets, int const* values,
+												  unsigned int lineCount)
+{
+	if ((m_chip == nullptr) || (m_linesRequested == true))
+	{
+		return false;
+	}
+
+	if (lineCount > GPIOD_LINE_BULK_MAX_LINES)
+	{
+		Logger::WriteLine(Shell::Red("libgpiod can't request more than "), GPIOD_LINE_BULK_MAX_LINES,
+								Shell::Red(" lines at once."));
+		return false;
+	}
+
+	gpiod_line_bulk_init(&m_lines);
+
+	// The getter takes the offsets as non-const, but doesn't change them.
+	if (gpiod_chip_get_lines(m_chip, const_cast<unsigned int*>(offsets), lineCount, &m_lines) < 0)
+	{
+		Logger::WriteLine(Shell::Red("Failed to get GPIO lines."));
+		return false;
+	}
+
+	if (gpiod_line_request_bulk_output(&m_lines, "sandman", values) < 0)
+	{
+		Logger::WriteLine(Shell::Red("Failed to request GPIO lines for output."));
+		return false;
+	}
+
+	m_linesRequested = true;
+	return true;
+}
+
+// Release the lines that were requested.
+//
+void GPIOV1Driver::ReleaseLines()
+{
+	if (m_linesRequested == false)
+	{
+		return;
+	}
+
+	gpiod_line_release_bulk(&m_lines);
+	m_linesRequested = false;
+}
+
+// Set every requested line at once.
+//
+// values:	The value for each line, in the order they were requested.
+//
+// Returns:	True on success, false on failure.
+//
+bool GPIOV1Driver::SetLineValues(int const* values)
+{
+	if (m_linesRequested == false)
+	{
+		return false;
+	}
+
+	return gpiod_line_set_value_bulk(&m_lines, values) == 0;
+}
+
+// Functions
+//
+
+// Create a driver for the GPIO hardware, using whichever version of libgpiod we were built with.
+//
+// Returns:	The driver.
+//
+std::unique_ptr<GPIODriver> GPIODriverCreateHardware()
+{
+	return std::make_unique<GPIOV1Driver>();
+}
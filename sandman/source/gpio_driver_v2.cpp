@@ -0,0 +1,213 @@
+// A GPIO driver for libgpiod 2.x, which is what current Raspberry Pi OS images ship.
+
+#include "gpio_driver.h"
+
+#include <array>
+
+#include <gpiod.h>
+
+#include "logger.h"
+
+// Constants
+//
+
+// The most lines that can be requested at once. It's far more than any Raspberry Pi has.
+static constexpr unsigned int kMaxLineCount{ 64u };
+
+// Types
+//
+
+// Drives the lines through a single libgpiod 2.x line request.
+class GPIOV2Driver : public GPIODriver
+{
+	public:
+
+		~GPIOV2Driver() override
+		{
+			Close();
+		}
+
+		char const* GetName() const override
+		{
+			return "libgpiod v2";
+		}
+
+		bool Open() override;
+
+		void Close() override;
+
+		bool RequestOutputLines(unsigned int const* offsets, int const* values,
+										unsigned int lineCount) override;
+
+		void ReleaseLines() override;
+
+		bool SetLineValues(int const* values) override;
+
+	private:
+
+		// The chip the lines are on.
+		gpiod_chip* m_chip = nullptr;
+
+		// The request for all of the lines.
+		gpiod_line_request* m_request = nullptr;
+
+		// The number of requested lines.
+		unsigned int m_lineCount = 0u;
+
+		// Where the values are converted to what libgpiod takes.
+		std::array<gpiod_line_value, kMaxLineCount> m_lineValues;
+};
+
+// GPIOV2Driver members
+
+// Open the GPIO chip.
+//
+// Returns:	True on success, false on failure.
+//
+bool GPIOV2Driver::Open()
+{
+	// RPI5 attempt.
+	m_chip = gpiod_chip_open("/dev/gpiochip4");
+
+	if (m_chip == nullptr)
+	{
+		m_chip = gpiod_chip_open("/dev/gpiochip0");
+	}
+
+	return m_chip != nullptr;
+}
+
+// Close the GPIO chip, releasing the lines if they were requested.
+//
+void GPIOV2Driver::Close()
+{
+	ReleaseLines();
+
+	if (m_chip != nullptr)
+	{
+		gpiod_chip_close(m_chip);
+		m_chip = nullptr;
+	}
+}
+
+// Request lines as outputs, all together.
+//
+// offsets:		The offsets of the lines on the chip.
+// values:		The value each line should start with.
+// lineCount:	The number of lines.
+//
+// Returns:	True on success, false on failure.
+//
+bool GPIOV2Driver::RequestOutputLines(unsigned int const* offsets, int const* values,
+												  unsigned int lineCount)
+{
+	if ((m_chip == nullptr) || (m_request != nullptr))
+	{
+		return false;
+	}
+
+	if (lineCount > kMaxLineCount)
+	{
+		Logger::WriteLine(Shell::Red("Can't request more than "), kMaxLineCount,
+								Shell::Red(" GPIO lines at once."));
+		return false;
+	}
+
+	auto* const settings = gpiod_line_settings_new();
+	auto* const lineConfig = gpiod_line_config_new();
+	auto* const requestConfig = gpiod_request_config_new();
+
+	auto succeeded = (settings != nullptr) && (lineConfig != nullptr) && (requestConfig != nullptr);
+
+	if (succeeded == true)
+	{
+		gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_OUTPUT);
+		gpiod_request_config_set_consumer(requestConfig, "sandman");
+
+		// Each line gets its own settings, because they may start with different values.
+		for (unsigned int lineIndex = 0u; lineIndex < lineCount; lineIndex++)
+		{
+			auto const value = (values[lineIndex] == 0) ? GPIOD_LINE_VALUE_INACTIVE :
+				GPIOD_LINE_VALUE_ACTIVE;
+
+			if ((gpiod_line_settings_set_output_value(settings, value) < 0) ||
+				 (gpiod_line_config_add_line_settings(lineConfig, &offsets[lineIndex], 1u,
+																  settings) < 0))
+			{
+				succeeded = false;
+				break;
+			}
+		}
+	}
+
+	if (succeeded == true)
+	{
+		m_request = gpiod_chip_request_lines(m_chip, requestConfig, lineConfig);
+		succeeded = (m_request != nullptr);
+	}
+
+	if (succeeded == false)
+	{
+		Logger::WriteLine(Shell::Red("Failed to request GPIO lines for output."));
+	}
+	else
+	{
+		m_lineCount = lineCount;
+	}
+
+	// Freeing null is allowed.
+	gpiod_request_config_free(requestConfig);
+	gpiod_line_config_free(lineConfig);
+	gpiod_line_settings_free(settings);
+
+	return succeeded;
+}
+
+// Release the lines that were requested.
+//
+void GPIOV2Driver::ReleaseLines()
+{
+	if (m_request == nullptr)
+	{
+		return;
+	}
+
+	gpiod_line_request_release(m_request);
+	m_request = nullptr;
+	m_lineCount = 0u;
+}
+
+// Set every requested line at once.
+//
+// values:	The value for each line, in the order they were requested.
+//
+// Returns:	True on success, false on failure.
+//
+bool GPIOV2Driver::SetLineValues(int const* values)
+{
+	if (m_request == nullptr)
+	{
+		return false;
+	}
+
+	for (unsigned int lineIndex = 0u; lineIndex < m_lineCount; lineIndex++)
+	{
+		m_lineValues[lineIndex] = (values[lineIndex] == 0) ? GPIOD_LINE_VALUE_INACTIVE :
+			GPIOD_LINE_VALUE_ACTIVE;
+	}
+
+	// The values are in the same order as the lines were added to the request.
+	return gpiod_line_request_set_values(m_request, m_lineValues.data()) == 0;
+}
+
+// Functions
+//
+
+// Create a driver for the GPIO hardware, using whichever version of libgpiod we were built with.
+//
+// Returns:	The driver.
+//
+std::unique_ptr<GPIODriver> GPIODriverCreateHardware()
+{
+	return std::make_unique<GPIOV2Driver>();
+}
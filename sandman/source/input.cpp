@@ -1,13 +1,19 @@
 #include "input.h"
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
+#include <ctime>
+#include <iterator>
+#include <memory>
 #include <sstream>
 
 #include <cerrno>
 #include <fcntl.h>
 #include <linux/input.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -15,6 +21,10 @@
 
 #include "logger.h"
 #include "notification.h"
+#include "reactor.h"
+#include "reports.h"
+#include "routines.h"
+#include "stats.h"
 #include "timer.h"
 
 #define DATADIR		AM_DATADIR
@@ -22,6 +32,45 @@
 // Constants
 //
 
+// Used to detect when a file descriptor is invalid.
+static constexpr int kInvalidFileDescriptor{ -1 };
+
+// The changes to a device directory that may mean a device can now be opened. Permissions are often
+// fixed up after the device node is created, so those changes count too.
+static constexpr std::uint32_t kHotplugWatchMask{ IN_CREATE | IN_MOVED_TO | IN_ATTRIB };
+
+// The names of the kinds of gestures, as they appear in the config.
+static constexpr char const* const kGestureTypeNames[] =
+{
+	"chord",			// kTypeChord
+	"longPress",	// kTypeLongPress
+	"doubleTap",	// kTypeDoubleTap
+};
+
+static_assert(std::size(kGestureTypeNames) == InputGesture::kNumTypes,
+				  "Every kind of gesture needs a name.");
+
+// What each kind of gesture does, unless the config says otherwise.
+static constexpr InputGesture::Actions kGestureDefaultActions[] =
+{
+	InputGesture::kActionStopAll,			// kTypeChord
+	InputGesture::kActionStartRoutine,	// kTypeLongPress
+	InputGesture::kActionMoveControl,	// kTypeDoubleTap
+};
+
+static_assert(std::size(kGestureDefaultActions) == InputGesture::kNumTypes,
+				  "Every kind of gesture needs a default action.");
+
+// The names of what gestures do, as they appear in the config.
+static constexpr char const* const kGestureActionNames[] =
+{
+	"stopAll",			// kActionStopAll
+	"startRoutine",	// kActionStartRoutine
+	"moveControl",		// kActionMoveControl
+};
+
+static_assert(std::size(kGestureActionNames) == InputGesture::kNumActions,
+				  "Every gesture action needs a name.");
 
 // Types
 //
@@ -30,10 +79,67 @@
 // Locals
 //
 
+// The input devices. They're registered with the reactor, so they must never move.
+static std::vector<std::unique_ptr<Input>> s_inputs;
+
+// Tells us when devices appear in the directories the input devices are in.
+static int s_hotplugFileDescriptor = kInvalidFileDescriptor;
 
 // Functions
 //
 
+// Start watching the directory that a device is in, so that we're told when the device appears.
+//
+// deviceName:	The path of the device.
+//
+// Returns:	True if the directory is being watched, false otherwise.
+//
+static bool InputWatchDeviceDirectory(char const* deviceName)
+{
+	if (s_hotplugFileDescriptor == kInvalidFileDescriptor)
+	{
+		return false;
+	}
+
+	std::string_view const devicePath(deviceName);
+	auto const separatorIndex = devicePath.rfind('/');
+
+	if ((separatorIndex == std::string_view::npos) || (separatorIndex == 0u))
+	{
+		return false;
+	}
+
+	// Watching the same directory again is harmless.
+	std::string const directoryName(devicePath.substr(0u, separatorIndex));
+	return inotify_add_watch(s_hotplugFileDescriptor, directoryName.c_str(), kHotplugWatchMask) >= 0;
+}
+
+// Handle devices appearing, by trying to open any input devices that aren't connected.
+//
+static void InputHandleHotplug()
+{
+	StatsTimer const timer(kStatsSubsystemInput);
+
+	// Drain the notifications. Which device appeared doesn't matter, since the missing devices are
+	// few and each only takes a single open to check.
+	alignas(inotify_event) char readBuffer[4'096];
+	auto anyAppeared = false;
+
+	while (read(s_hotplugFileDescriptor, readBuffer, sizeof(readBuffer)) > 0)
+	{
+		anyAppeared = true;
+	}
+
+	if (anyAppeared == false)
+	{
+		return;
+	}
+
+	for (auto& input : s_inputs)
+	{
+		input->HandleDeviceAppeared();
+	}
+}
 
 // InputBinding members
 
@@ -85,242 +191,1322 @@ bool InputBinding::ReadFromJSON(rapidjson::Value const& object)
 	return true;
 }
 
-// Input members
+// InputGesture members
 
-// Handle initialization.
+// Read an input gesture from JSON.
 //
-// deviceName:	The name of the input device that this will manage.
-// bindings:		A list of input bindings.
+// object:	The JSON object representing a gesture.
 //
-void Input::Initialize(char const* deviceName, std::vector<InputBinding> const& bindings)
+// Returns:		True if the gesture was read successfully, false otherwise.
+//
+bool InputGesture::ReadFromJSON(rapidjson::Value const& object)
 {
-	// Copy the device name.
-	strncpy(m_deviceName, deviceName, kDeviceNameCapacity - 1);
-	m_deviceName[kDeviceNameCapacity - 1] = '\0';
-	
-	// Populate the input bindings.
-	m_bindings = bindings;
-	
-	// Use the bindings to populate the input to action mapping.
-	for (const auto& binding : m_bindings) 
+	if (object.IsObject() == false)
 	{
-		// Blindly insert. If the same key is bound more than once, the mapping will get overwritten 
-		// with the last occurrence.
-		m_inputToActionMap[binding.m_keyCode] = binding.m_controlAction;
+		return false;
 	}
-	
-	// Display what we initialized.
-	Logger::WriteLine("Initialized input device \'", m_deviceName, "\' with input bindings:");
 
-	for (auto const& binding : m_bindings) 
+	// There must be a kind of gesture.
+	auto const gestureIterator = object.FindMember("gesture");
+
+	if ((gestureIterator == object.MemberEnd()) || (gestureIterator->value.IsString() == false))
 	{
-		auto* const actionText = 
-			(binding.m_controlAction.m_action == Control::Actions::kActionMovingUp) ? "up" : "down";
+		Logger::WriteLine("Input gesture is missing the kind of gesture.");
+		return false;
+	}
 
-		Logger::WriteLine("\tCode ", binding.m_keyCode, " -> ", binding.m_controlAction.m_controlName,
-								", ", actionText);
+	auto typeIndex = 0u;
+
+	while ((typeIndex < kNumTypes) &&
+			 (std::strcmp(gestureIterator->value.GetString(), kGestureTypeNames[typeIndex]) != 0))
+	{
+		typeIndex++;
 	}
-	
-	Logger::WriteLine();
-}
 
-// Handle uninitialization.
-//
-void Input::Uninitialize()
-{
-	// Make sure the device file is closed.
-	CloseDevice(false, "");
-}
+	if (typeIndex >= kNumTypes)
+	{
+		Logger::WriteLine("Input gesture has an unrecognized kind of gesture.");
+		return false;
+	}
 
-// Process a tick.
-//
-void Input::Process()
-{
-	// See if we need to open the device.
-	if (m_deviceFileHandle == kInvalidFileHandle) {
-		
-		// If we have failed before, see whether we have waited long enough before trying to open 
-		// again.
-		if (m_deviceOpenHasFailed == true)
-		{		
-			// Get elapsed time since the last failure.
-			Time currentTime;
-			TimerGetCurrent(currentTime);
-
-			auto const elapsedTimeMS = TimerGetElapsedMilliseconds(m_lastDeviceOpenFailTime, 
-				currentTime);
-			
-			if (elapsedTimeMS < kDeviceOpenRetryDelayMS)
+	m_type = static_cast<Types>(typeIndex);
+
+	// Chords have two keys, everything else has one.
+	if (m_type == kTypeChord)
+	{
+		auto const keyCodesIterator = object.FindMember("keyCodes");
+
+		if ((keyCodesIterator == object.MemberEnd()) || (keyCodesIterator->value.IsArray() == false) ||
+			 (keyCodesIterator->value.Size() != m_keyCodes.size()))
+		{
+			Logger::WriteLine("Input chord gesture needs an array of two key codes.");
+			return false;
+		}
+
+		for (unsigned int keyIndex = 0u; keyIndex < m_keyCodes.size(); keyIndex++)
+		{
+			auto const& keyCodeValue = keyCodesIterator->value[keyIndex];
+
+			if (keyCodeValue.IsInt() == false)
 			{
-				return;
+				Logger::WriteLine("Input chord gesture has a key code, but it is not an integer.");
+				return false;
 			}
+
+			m_keyCodes[keyIndex] = keyCodeValue.GetInt();
 		}
 
-		// We open in nonblocking mode so that we don't hang waiting for input.
-		m_deviceFileHandle = open(m_deviceName, O_RDONLY | O_NONBLOCK);
+		if (m_keyCodes[0] == m_keyCodes[1])
+		{
+			Logger::WriteLine("Input chord gesture needs two different keys.");
+			return false;
+		}
+	}
+	else
+	{
+		auto const keyCodeIterator = object.FindMember("keyCode");
 
-		if (m_deviceFileHandle < 0)
+		if ((keyCodeIterator == object.MemberEnd()) || (keyCodeIterator->value.IsInt() == false))
 		{
-			// Record the time of the last open failure.
-			TimerGetCurrent(m_lastDeviceOpenFailTime);
+			Logger::WriteLine("Input gesture is missing a key code.");
+			return false;
+		}
 
-			std::string const errorMessage(
-				(std::ostringstream() << "Failed to open input device \'" << m_deviceName << "\'")
-					.str());
+		m_keyCodes[0] = keyCodeIterator->value.GetInt();
+	}
 
-			CloseDevice(true, errorMessage);
+	// What the gesture does can be given, but each kind of gesture has its own default.
+	m_action = kGestureDefaultActions[m_type];
 
-			return;
-		}
+	auto const actionIterator = object.FindMember("action");
 
-		// Try to get the name.
-		char name[256];
-		if (ioctl(m_deviceFileHandle, EVIOCGNAME(sizeof(name)), name) < 0)
-		{	
-			// Record the time of the last open failure.
-			TimerGetCurrent(m_lastDeviceOpenFailTime);
+	if (actionIterator != object.MemberEnd())
+	{
+		if (actionIterator->value.IsString() == false)
+		{
+			Logger::WriteLine("Input gesture has an action, but it is not a string.");
+			return false;
+		}
 
-			std::string const errorMessage((std::ostringstream()
-													  << "Failed to get name for input device \'" << m_deviceName
-													  << "\'")
-														 .str());
+		auto actionIndex = 0u;
 
-			CloseDevice(true, errorMessage);
+		while ((actionIndex < kNumActions) &&
+				 (std::strcmp(actionIterator->value.GetString(), kGestureActionNames[actionIndex]) != 0))
+		{
+			actionIndex++;
 		}
 
-		Logger::WriteLine("Input device \'", m_deviceName, "\' is a \'", name, "\'");
+		if (actionIndex >= kNumActions)
+		{
+			Logger::WriteLine("Input gesture has an unrecognized action.");
+			return false;
+		}
 
-		// More device information.
-		unsigned short deviceID[4];
-		ioctl(m_deviceFileHandle, EVIOCGID, deviceID);
+		m_action = static_cast<Actions>(actionIndex);
+	}
 
-		Logger::WriteLine(/* Use hexadecimal and show base of number (`0x`). */
-								std::hex, std::showbase,
-								
-								"Input device bus ", deviceID[ID_BUS    ],
-								", vendor "        , deviceID[ID_VENDOR ],
-								", product "       , deviceID[ID_PRODUCT],
-								", version "       , deviceID[ID_VERSION], ".",
+	// Moving a control needs to know which control, and which way.
+	if (m_action == kActionMoveControl)
+	{
+		auto const controlActionIterator = object.FindMember("controlAction");
 
-								/* Restore to using decimal and not showing base of number. */
-								std::dec, std::noshowbase);
+		if (controlActionIterator == object.MemberEnd())
+		{
+			Logger::WriteLine("Input gesture moves a control, but is missing a control action.");
+			return false;
+		}
 
-		// Play controller connected notification.
-		NotificationPlay("control_connected");
-			
-		m_deviceOpenHasFailed = false;
+		if (m_controlAction.ReadFromJSON(controlActionIterator->value) == false)
+		{
+			Logger::WriteLine("Input gesture has a control action, but it could not be parsed.");
+			return false;
+		}
 	}
 
-	// Read up to 64 input events at a time.
-	static constexpr std::size_t kEventsToReadCount{64};
-	input_event events[kEventsToReadCount];
-	static constexpr std::size_t kEventSize{sizeof(input_event)};
-	static constexpr std::size_t kEventBufferSize{kEventsToReadCount * kEventSize};
+	return true;
+}
 
-	static_assert(kEventBufferSize <= SSIZE_MAX,
-					  "In `man 'read(2)'`, DESCRIPTION: "
-					  "\"According to POSIX.1, if count is greater than SSIZE_MAX, "
-					  "the result is implementation-defined; see NOTES for the upper limit on Linux.\"");
-	auto const readCount = read(m_deviceFileHandle, events, kEventBufferSize);
+// InputGestureRecognizer members
+
+// Set the gestures to recognize.
+//
+// gestures:	The gestures to recognize.
+// timings:		How the gestures are timed.
+//
+void InputGestureRecognizer::Initialize(std::vector<InputGesture> const& gestures,
+													 InputGestureTimings const& timings)
+{
+	m_gestures = gestures;
+	m_timings = timings;
+
+	Reset();
+}
+
+// Forget about the keys that are held and the taps that have been made.
+//
+void InputGestureRecognizer::Reset()
+{
+	m_gestureStates.assign(m_gestures.size(), GestureState());
+}
+
+// Handle a key being pressed.
+//
+// keyCode:	The code of the key.
+// time:		When the key was pressed.
+//
+// Returns:	The index of the gesture that was made, or kNoGesture.
+//
+unsigned int InputGestureRecognizer::HandleKeyPressed(unsigned short keyCode, InputEventTime time)
+{
+	auto madeGestureIndex = kNoGesture;
 
-	// I think maybe this would happen if the device got disconnected?
-	if (readCount < 0)
+	for (unsigned int gestureIndex = 0u; gestureIndex < m_gestures.size(); gestureIndex++)
 	{
-		// When we are in nonblocking mode, this "error" means that there was no data and 
-		// we need to check the device again.
-		if (errno == EAGAIN)
+		auto const& gesture = m_gestures[gestureIndex];
+		auto& state = m_gestureStates[gestureIndex];
+
+		for (unsigned int keyIndex = 0u; keyIndex < gesture.GetKeyCount(); keyIndex++)
 		{
-			return;
+			if (gesture.m_keyCodes[keyIndex] != keyCode)
+			{
+				continue;
+			}
+
+			auto const previousPressTime = state.m_keyPressTimes[keyIndex];
+
+			state.m_keysHeld[keyIndex] = true;
+			state.m_keyPressTimes[keyIndex] = time;
+
+			auto made = false;
+
+			switch (gesture.m_type)
+			{
+				case InputGesture::kTypeChord:
+				{
+					// Both keys have to be held, and have been pressed close enough together.
+					auto const otherKeyIndex = 1u - keyIndex;
+					auto const chordWindow = std::chrono::milliseconds(m_timings.m_chordWindowMS);
+
+					made = (state.m_made == false) && (state.m_keysHeld[otherKeyIndex] == true) &&
+						(time - state.m_keyPressTimes[otherKeyIndex] <= chordWindow);
+				}
+				break;
+
+				case InputGesture::kTypeLongPress:
+				{
+					// Long presses are made by time passing.
+					state.m_made = false;
+				}
+				break;
+
+				case InputGesture::kTypeDoubleTap:
+				{
+					auto const doubleTapWindow = std::chrono::milliseconds(m_timings.m_doubleTapWindowMS);
+
+					made = (state.m_tapPending == true) && (time - previousPressTime <= doubleTapWindow);
+
+					// A third tap starts over rather than making another double tap.
+					state.m_tapPending = (made == false);
+				}
+				break;
+
+				default:
+				break;
+			}
+
+			if (made == true)
+			{
+				state.m_made = true;
+
+				// If several gestures are made at once, the first one in the config wins.
+				if (madeGestureIndex == kNoGesture)
+				{
+					madeGestureIndex = gestureIndex;
+				}
+			}
 		}
+	}
 
-		std::string const errorMessage(
-			(std::ostringstream() << "Failed to read from input device \'" << m_deviceName << "\'")
-				.str());
+	return madeGestureIndex;
+}
 
-		CloseDevice(true, errorMessage);
+// Handle a key being released.
+//
+// keyCode:	The code of the key.
+//
+void InputGestureRecognizer::HandleKeyReleased(unsigned short keyCode)
+{
+	for (unsigned int gestureIndex = 0u; gestureIndex < m_gestures.size(); gestureIndex++)
+	{
+		auto const& gesture = m_gestures[gestureIndex];
+		auto& state = m_gestureStates[gestureIndex];
 
-		return;
+		for (unsigned int keyIndex = 0u; keyIndex < gesture.GetKeyCount(); keyIndex++)
+		{
+			if (gesture.m_keyCodes[keyIndex] != keyCode)
+			{
+				continue;
+			}
+
+			state.m_keysHeld[keyIndex] = false;
+
+			// The gesture can be made again once all of its keys have been let go.
+			if ((state.m_keysHeld[0] == false) && (state.m_keysHeld[1] == false))
+			{
+				state.m_made = false;
+			}
+		}
 	}
-	
-	// Process each of the input events.
-	auto const eventCount = readCount / kEventSize;
-	for (unsigned int eventIndex = 0; eventIndex < eventCount; eventIndex++)
+}
+
+// Handle time passing, which is what makes a long press.
+//
+// time:	The current time.
+//
+// Returns:	The index of the gesture that was made, or kNoGesture.
+//
+unsigned int InputGestureRecognizer::HandleTime(InputEventTime time)
+{
+	auto const longPressDuration = std::chrono::milliseconds(m_timings.m_longPressDurationMS);
+
+	for (unsigned int gestureIndex = 0u; gestureIndex < m_gestures.size(); gestureIndex++)
 	{
-		auto const& event = events[eventIndex];
-		
-		// We are only handling keys/buttons for now.
-		if (event.type != EV_KEY)
+		auto& state = m_gestureStates[gestureIndex];
+
+		if ((m_gestures[gestureIndex].m_type != InputGesture::kTypeLongPress) ||
+			 (state.m_keysHeld[0] == false) || (state.m_made == true))
 		{
 			continue;
 		}
 
-		// Try to find a control action corresponding to this input.
-		auto result = m_inputToActionMap.find(event.code);
-		
-		if (result == m_inputToActionMap.end())
+		if (time - state.m_keyPressTimes[0] >= longPressDuration)
 		{
-			continue;
+			state.m_made = true;
+			return gestureIndex;
 		}
-		
-		// The action is the second member of the pair.
-		auto& controlAction = result->second;
-	
-		// Try to find the corresponding control.
-		auto* control = controlAction.GetControl();
+	}
 
-		if (control == nullptr)
+	return kNoGesture;
+}
+
+// Get the next time that a long press will be made, if the keys stay held.
+//
+// time:	(Output) The time that the next long press will be made.
+//
+// Returns:	True if a long press is pending, false otherwise.
+//
+bool InputGestureRecognizer::GetNextLongPressTime(InputEventTime& time) const
+{
+	auto const longPressDuration = std::chrono::milliseconds(m_timings.m_longPressDurationMS);
+	auto pending = false;
+
+	for (unsigned int gestureIndex = 0u; gestureIndex < m_gestures.size(); gestureIndex++)
+	{
+		auto const& state = m_gestureStates[gestureIndex];
+
+		if ((m_gestures[gestureIndex].m_type != InputGesture::kTypeLongPress) ||
+			 (state.m_keysHeld[0] == false) || (state.m_made == true))
 		{
-			Logger::WriteLine("Couldn't find control \'", controlAction.m_controlName,
-									"\' mapped to key code ", event.code, ".");
 			continue;
 		}
 
-		// Translate whether the key was pressed or not into the appropriate action.
-		auto const action = (event.value == 1) ? controlAction.m_action : 
-			Control::Actions::kActionStopped;
+		auto const longPressTime = state.m_keyPressTimes[0] + longPressDuration;
+
+		if ((pending == false) || (longPressTime < time))
+		{
+			time = longPressTime;
+			pending = true;
+		}
+	}
 
-		// Manipulate the control.
-		control->SetDesiredAction(action, Control::Modes::kModeManual);
-	}	
+	return pending;
 }
 
-// Determine whether the input device is connected.
+// InputKeyTracker members
+
+// Forget about all of the bindings and the keys that are held.
 //
-bool Input::IsConnected() const
+void InputKeyTracker::Clear()
 {
-	return (m_deviceFileHandle != kInvalidFileHandle);
+	m_keyCodeToAction.clear();
+	m_controlKeyStates.clear();
 }
 
-// Close the input device.
+// Bind a key to a control action. Binding a key again replaces what it was bound to.
 //
-// wasFailure:	Whether the device is being closed due to a failure or not.
-// message: message that may be logged
+// keyCode:			The code of the key.
+// controlHandle:	The control to manipulate.
+// action:			The action for the control.
+// latencyID:		Where to record the time from the key being pressed or released until the pins
+//						change.
 //
-void Input::CloseDevice(bool const wasFailure, std::string_view const message)
+void InputKeyTracker::Bind(unsigned short keyCode, ControlHandle controlHandle,
+									Control::Actions action, StatsLatencyID latencyID)
 {
-	// Close the device.
-	if (m_deviceFileHandle != kInvalidFileHandle)
+	if (keyCode >= m_keyCodeToAction.size())
 	{
-		close(m_deviceFileHandle);
-		m_deviceFileHandle = kInvalidFileHandle;
+		m_keyCodeToAction.resize(keyCode + 1u);
 	}
-			
-	// Only log a message/play sound on failure.
-	if (wasFailure == false) {
+
+	auto& keyAction = m_keyCodeToAction[keyCode];
+	keyAction.m_controlHandle = controlHandle;
+	keyAction.m_action = action;
+	keyAction.m_latencyID = latencyID;
+
+	GetControlKeyState(controlHandle);
+}
+
+// Handle a key being pressed, held, or released.
+//
+// keyCode:		The code of the key.
+// value:		1 if the key was pressed, 2 if it's being held (autorepeat), 0 if it was released.
+// eventTime:	When the key event happened.
+//
+void InputKeyTracker::HandleKeyEvent(unsigned short keyCode, int value, Time const& eventTime)
+{
+	if (keyCode >= m_keyCodeToAction.size())
+	{
 		return;
 	}
-	
-	// And only if it was the first failure.
-	if (m_deviceOpenHasFailed == true)
+
+	auto& keyAction = m_keyCodeToAction[keyCode];
+
+	if (keyAction.m_controlHandle == kInvalidControlHandle)
 	{
 		return;
 	}
-	
-	m_deviceOpenHasFailed = true;	
-	
-	// Log the message.
-	Logger::WriteLine(Shell::Red(message));
 
-	// Play controller disconnected notification.
-	NotificationPlay("control_disconnected");
+	auto& controlKeyState = m_controlKeyStates[keyAction.m_controlHandle];
+
+	switch (value)
+	{
+		// Released.
+		case 0:
+		{
+			if (keyAction.m_pressed == false)
+			{
+				return;
+			}
+
+			keyAction.m_pressed = false;
+
+			// Only stop if this key is what's moving the control. Another key for the same control may
+			// have been pressed since.
+			if (controlKeyState.m_wantedAction == keyAction.m_action)
+			{
+				controlKeyState.m_wantedAction = Control::kActionStopped;
+				controlKeyState.m_wantedTime = eventTime;
+				controlKeyState.m_wantedLatencyID = keyAction.m_latencyID;
+			}
+		}
+		break;
+
+		// Pressed.
+		case 1:
+		{
+			keyAction.m_pressed = true;
+			controlKeyState.m_wantedAction = keyAction.m_action;
+			controlKeyState.m_wantedTime = eventTime;
+			controlKeyState.m_wantedLatencyID = keyAction.m_latencyID;
+		}
+		break;
+
+		// Autorepeat just means the key is still held, which we already know.
+		default:
+		break;
+	}
+}
+
+// Release a key without it doing anything more, because it made a gesture.
+//
+// keyCode:	The code of the key.
+// time:		When the gesture was made.
+//
+void InputKeyTracker::ConsumeKey(unsigned short keyCode, Time const& time)
+{
+	if (keyCode >= m_keyCodeToAction.size())
+	{
+		return;
+	}
+
+	auto& keyAction = m_keyCodeToAction[keyCode];
+
+	if ((keyAction.m_pressed == false) || (keyAction.m_controlHandle == kInvalidControlHandle))
+	{
+		return;
+	}
+
+	// Letting go of the key later is ignored, since it no longer counts as pressed.
+	keyAction.m_pressed = false;
+
+	auto& controlKeyState = m_controlKeyStates[keyAction.m_controlHandle];
+
+	// The gesture stops the control rather than a key event, so there's no latency to measure.
+	if (controlKeyState.m_wantedAction == keyAction.m_action)
+	{
+		controlKeyState.m_wantedAction = Control::kActionStopped;
+		controlKeyState.m_wantedTime = time;
+		controlKeyState.m_wantedLatencyID = kStatsNoLatency;
+	}
+}
+
+// Release every key that is being held down, like when the device goes away.
+//
+// time:	When the keys were let go.
+//
+void InputKeyTracker::ReleaseAllKeys(Time const& time)
+{
+	for (auto& keyAction : m_keyCodeToAction)
+	{
+		keyAction.m_pressed = false;
+	}
+
+	// Nothing was pressed or released, so there's no latency to measure.
+	for (auto& controlKeyState : m_controlKeyStates)
+	{
+		controlKeyState.m_wantedAction = Control::kActionStopped;
+		controlKeyState.m_wantedTime = time;
+		controlKeyState.m_wantedLatencyID = kStatsNoLatency;
+	}
+}
+
+// Note that something else has already given a control an action, so the keys have nothing to
+// change until they are pressed or released again.
+//
+// controlHandle:	The control.
+// action:			The action the control was given.
+//
+void InputKeyTracker::SetControlAction(ControlHandle controlHandle, Control::Actions action)
+{
+	auto& controlKeyState = GetControlKeyState(controlHandle);
+	controlKeyState.m_wantedAction = action;
+	controlKeyState.m_appliedAction = action;
+}
+
+// Note that every control has been stopped, and that none of the held keys should start anything
+// up again.
+//
+void InputKeyTracker::StopAll()
+{
+	for (auto& keyAction : m_keyCodeToAction)
+	{
+		keyAction.m_pressed = false;
+	}
+
+	for (auto& controlKeyState : m_controlKeyStates)
+	{
+		controlKeyState.m_wantedAction = Control::kActionStopped;
+		controlKeyState.m_appliedAction = Control::kActionStopped;
+	}
+}
+
+// Make room to track a control.
+//
+// controlHandle:	The control.
+//
+// Returns:	What the keys want the control to do.
+//
+InputKeyTracker::ControlKeyState& InputKeyTracker::GetControlKeyState(ControlHandle controlHandle)
+{
+	if (controlHandle >= m_controlKeyStates.size())
+	{
+		m_controlKeyStates.resize(controlHandle + 1u);
+	}
+
+	return m_controlKeyStates[controlHandle];
+}
+
+// InputDeviceConfig members
+
+// Read an input device config from JSON.
+//
+// object:	The JSON object representing an input device config.
+//
+// Returns:		True if the config was read successfully, false otherwise.
+//
+bool InputDeviceConfig::ReadFromJSON(rapidjson::Value const& object)
+{
+	if (object.IsObject() == false)
+	{
+		Logger::WriteLine(Shell::Red("Config has an input device that is not an object."));
+		return false;
+	}
+
+	// We must have a device name.
+	auto const deviceIterator = object.FindMember("device");
+
+	if (deviceIterator == object.MemberEnd())
+	{
+		Logger::WriteLine(Shell::Red("Config input device is missing the device name."));
+		return false;
+	}
+
+	if (deviceIterator->value.IsString() == false)
+	{
+		Logger::WriteLine(Shell::Red("Config input device name is not a string."));
+		return false;
+	}
+	
+	// Copy no more than the amount of text the buffer can hold.
+	strncpy(m_deviceName, deviceIterator->value.GetString(), sizeof(m_deviceName) - 1);
+	m_deviceName[sizeof(m_deviceName) - 1] = '\0';
+
+	// The device may optionally be grabbed.
+	auto const exclusiveIterator = object.FindMember("exclusive");
+
+	if (exclusiveIterator != object.MemberEnd())
+	{
+		if (exclusiveIterator->value.IsBool() == false)
+		{
+			Logger::WriteLine(Shell::Red("Config input device exclusive is not a boolean."));
+			return false;
+		}
+
+		m_exclusive = exclusiveIterator->value.GetBool();
+	}
+
+	// We must have a bindings array, but it can be empty.
+	m_bindings.clear();
+
+	auto const bindingsIterator = object.FindMember("bindings");
+
+	if (bindingsIterator == object.MemberEnd())
+	{
+		Logger::WriteLine(Shell::Red("Config input device is missing a bindings array."));
+		return false;
+	}
+
+	if (bindingsIterator->value.IsArray() == false)
+	{
+		Logger::WriteLine(Shell::Red("Config input device bindings exists, but it is not an array."));
+		return false;
+	}
+
+	for (auto const& bindingObject : bindingsIterator->value.GetArray())
+	{
+		// Try to read the binding.
+		InputBinding binding;
+		if (binding.ReadFromJSON(bindingObject) == false)
+		{
+			continue;
+		}
+
+		// If we successfully read a binding, add it to the list.
+		m_bindings.push_back(binding);
+	}
+
+	// Gestures are optional.
+	m_gestures.clear();
+
+	auto const gesturesIterator = object.FindMember("gestures");
+
+	if (gesturesIterator != object.MemberEnd())
+	{
+		if (gesturesIterator->value.IsArray() == false)
+		{
+			Logger::WriteLine(Shell::Red("Config input device gestures exists, but it is not an array."));
+			return false;
+		}
+
+		for (auto const& gestureObject : gesturesIterator->value.GetArray())
+		{
+			InputGesture gesture;
+			if (gesture.ReadFromJSON(gestureObject) == false)
+			{
+				continue;
+			}
+
+			m_gestures.push_back(gesture);
+		}
+	}
+
+	return true;
+}
+
+// Input members
+
+// Handle initialization.
+//
+// config:				Configuration parameters for the input device that this will manage.
+// gestureTimings:	How the gestures are timed.
+//
+void Input::Initialize(InputDeviceConfig const& config, InputGestureTimings const& gestureTimings)
+{
+	// Copy the device name.
+	strncpy(m_deviceName, config.m_deviceName, kDeviceNameCapacity - 1);
+	m_deviceName[kDeviceNameCapacity - 1] = '\0';
+	
+	// Populate the input bindings.
+	m_bindings = config.m_bindings;
+	m_exclusive = config.m_exclusive;
+	
+	// Use the bindings to populate the table of what each key does, so that a key press is handled
+	// with a single lookup.
+	m_keyTracker.Clear();
+
+	for (const auto& binding : m_bindings) 
+	{
+		if (binding.m_keyCode >= KEY_CNT)
+		{
+			Logger::WriteLine(Shell::Red("Key code "), binding.m_keyCode,
+									Shell::Red(" is out of range. The binding will be ignored."));
+			continue;
+		}
+
+		// Find the control now, so that a key press doesn't have to.
+		auto controlAction = binding.m_controlAction;
+
+		if (controlAction.Resolve() == false)
+		{
+			Logger::WriteLine(Shell::Red("Couldn't find control \'"), controlAction.m_controlName,
+									Shell::Red("\' mapped to key code "), binding.m_keyCode,
+									Shell::Red(". The binding will be ignored."));
+			continue;
+		}
+
+		// Measure each binding separately, from the key event until the pins change.
+		auto const latencyID = StatsAddLatency((std::ostringstream() << m_deviceName << ':' <<
+															 binding.m_keyCode).str());
+
+		// Blindly insert. If the same key is bound more than once, the mapping will get overwritten 
+		// with the last occurrence.
+		m_keyTracker.Bind(binding.m_keyCode, controlAction.m_controlHandle, controlAction.m_action,
+								latencyID);
+	}
+
+	// Only keep the gestures that can be made and that do something.
+	std::vector<InputGesture> gestures;
+
+	for (auto gesture : config.m_gestures)
+	{
+		if ((gesture.m_keyCodes[0] >= KEY_CNT) || (gesture.m_keyCodes[1] >= KEY_CNT))
+		{
+			Logger::WriteLine(Shell::Red("A "), kGestureTypeNames[gesture.m_type],
+									Shell::Red(" gesture has a key code that is out of range. The gesture will be "
+												  "ignored."));
+			continue;
+		}
+
+		if (gesture.m_action == InputGesture::kActionMoveControl)
+		{
+			if (gesture.m_controlAction.Resolve() == false)
+			{
+				Logger::WriteLine(Shell::Red("Couldn't find control \'"),
+										gesture.m_controlAction.m_controlName, Shell::Red("\' for a "),
+										kGestureTypeNames[gesture.m_type],
+										Shell::Red(" gesture. The gesture will be ignored."));
+				continue;
+			}
+		}
+
+		gestures.push_back(gesture);
+	}
+
+	m_gestureRecognizer.Initialize(gestures, gestureTimings);
+	
+	// Display what we initialized.
+	Logger::WriteLine("Initialized input device \'", m_deviceName, "\' with input bindings:");
+
+	for (auto const& binding : m_bindings) 
+	{
+		auto* const actionText = 
+			(binding.m_controlAction.m_action == Control::Actions::kActionMovingUp) ? "up" : "down";
+
+		Logger::WriteLine("\tCode ", binding.m_keyCode, " -> ", binding.m_controlAction.m_controlName,
+								", ", actionText);
+	}
+
+	for (auto const& gesture : gestures)
+	{
+		if (gesture.m_type == InputGesture::kTypeChord)
+		{
+			Logger::WriteLine("\tChord ", gesture.m_keyCodes[0], " + ", gesture.m_keyCodes[1], " -> ",
+									kGestureActionNames[gesture.m_action]);
+		}
+		else
+		{
+			Logger::WriteLine("\t", (gesture.m_type == InputGesture::kTypeLongPress) ? "Long press " :
+									"Double tap ", gesture.m_keyCodes[0], " -> ",
+									kGestureActionNames[gesture.m_action]);
+		}
+	}
+
+	// Find out when the device appears rather than checking for it over and over.
+	m_watchingForHotplug = InputWatchDeviceDirectory(m_deviceName);
+
+	if (m_watchingForHotplug == false)
+	{
+		Logger::WriteLine(Shell::Yellow("Can't watch for input device \'"), m_deviceName,
+								Shell::Yellow("\' to appear, so it will be checked for periodically."));
+	}
+	
+	Logger::WriteLine();
+}
+
+// Handle uninitialization.
+//
+void Input::Uninitialize()
+{
+	// Make sure the device file is closed.
+	CloseDevice(false, "");
+}
+
+// Process a tick.
+//
+void Input::Process()
+{
+	// Once the device is open, only held keys need time to pass.
+	if (m_deviceFileHandle != kInvalidFileHandle)
+	{
+		ProcessLongPresses();
+		return;
+	}
+
+	if (m_deviceOpenHasFailed == true)
+	{
+		// We'll be told when it appears.
+		if (m_watchingForHotplug == true)
+		{
+			return;
+		}
+
+		// Otherwise, see whether we have waited long enough before trying to open again.
+		if (TimerClock::now() < m_lastDeviceOpenFailTime + kDeviceOpenRetryDelay)
+		{
+			return;
+		}
+	}
+
+	OpenDevice();
+}
+
+// Handle a device appearing in the directory that the input device is in, which may be the input
+// device coming back.
+//
+void Input::HandleDeviceAppeared()
+{
+	if (m_deviceFileHandle != kInvalidFileHandle)
+	{
+		return;
+	}
+
+	OpenDevice();
+}
+
+// Try to open the input device.
+//
+void Input::OpenDevice()
+{
+	// We open in nonblocking mode so that we don't hang waiting for input.
+	m_deviceFileHandle = open(m_deviceName, O_RDONLY | O_NONBLOCK);
+
+	if (m_deviceFileHandle < 0)
+	{
+		// Record the time of the last open failure.
+		m_lastDeviceOpenFailTime = TimerClock::now();
+
+		std::string const errorMessage(
+			(std::ostringstream() << "Failed to open input device \'" << m_deviceName << "\'")
+				.str());
+
+		CloseDevice(true, errorMessage);
+
+		return;
+	}
+
+	// Try to get the name.
+	char name[256];
+	if (ioctl(m_deviceFileHandle, EVIOCGNAME(sizeof(name)), name) < 0)
+	{	
+		// Record the time of the last open failure.
+		m_lastDeviceOpenFailTime = TimerClock::now();
+
+		std::string const errorMessage((std::ostringstream()
+												  << "Failed to get name for input device \'" << m_deviceName
+												  << "\'")
+													 .str());
+
+		CloseDevice(true, errorMessage);
+		return;
+	}
+
+	Logger::WriteLine("Input device \'", m_deviceName, "\' is a \'", name, "\'");
+
+	// More device information.
+	unsigned short deviceID[4];
+	ioctl(m_deviceFileHandle, EVIOCGID, deviceID);
+
+	Logger::WriteLine(/* Use hexadecimal and show base of number (`0x`). */
+							std::hex, std::showbase,
+							
+							"Input device bus ", deviceID[ID_BUS    ],
+							", vendor "        , deviceID[ID_VENDOR ],
+							", product "       , deviceID[ID_PRODUCT],
+							", version "       , deviceID[ID_VERSION], ".",
+
+							/* Restore to using decimal and not showing base of number. */
+							std::dec, std::noshowbase);
+
+	// Have the events timestamped with the same kind of clock that we schedule with, so that we can
+	// tell when a key has been held long enough.
+	clockid_t eventClockID = CLOCK_MONOTONIC;
+
+	m_eventClockID = (ioctl(m_deviceFileHandle, EVIOCSCLOCKID, &eventClockID) < 0) ? CLOCK_REALTIME :
+		CLOCK_MONOTONIC;
+
+	// Keep everything else from getting the device's events, if asked to.
+	if ((m_exclusive == true) && (ioctl(m_deviceFileHandle, EVIOCGRAB, 1) < 0))
+	{
+		Logger::WriteLine(Shell::Yellow("Failed to grab input device \'"), m_deviceName,
+								Shell::Yellow("\', so others will get its events too."));
+	}
+
+	// Play controller connected notification.
+	NotificationPlay("control_connected");
+		
+	m_deviceOpenHasFailed = false;
+
+	// Events are handled as soon as the device has any.
+	ReactorAddFileDescriptor(m_deviceFileHandle, EPOLLIN, [this](std::uint32_t /* events */)
+	{
+		StatsTimer const timer(kStatsSubsystemInput);
+		ReadEvents();
+	});
+
+	// There may already be some.
+	ReadEvents();
+}
+
+// Get the next time that the input needs to be processed, if any.
+//
+// deadline:	(Output) The time by which the input needs to be processed.
+//
+// Returns:	True if the input needs to be processed again, false otherwise.
+//
+bool Input::GetNextDeadline(Time& deadline) const
+{
+	// Once the device is open, we only need to process events as they arrive, unless a key is being
+	// held long enough to make a long press.
+	if (m_deviceFileHandle != kInvalidFileHandle)
+	{
+		if (m_hasLongPressDeadline == false)
+		{
+			return false;
+		}
+
+		deadline = m_longPressDeadline;
+		return true;
+	}
+
+	// We need to attempt to open the device, right away unless we have failed before.
+	if (m_deviceOpenHasFailed == false)
+	{
+		deadline = TimerClock::now();
+		return true;
+	}
+
+	// We'll be told when it appears.
+	if (m_watchingForHotplug == true)
+	{
+		return false;
+	}
+
+	deadline = m_lastDeviceOpenFailTime + kDeviceOpenRetryDelay;
+	return true;
+}
+
+// Read and handle all of the input events that are available from the device.
+//
+void Input::ReadEvents()
+{
+	// Read up to 64 input events at a time.
+	static constexpr std::size_t kEventsToReadCount{64};
+	input_event events[kEventsToReadCount];
+	static constexpr std::size_t kEventSize{sizeof(input_event)};
+	static constexpr std::size_t kEventBufferSize{kEventsToReadCount * kEventSize};
+
+	static_assert(kEventBufferSize <= SSIZE_MAX,
+					  "In `man 'read(2)'`, DESCRIPTION: "
+					  "\"According to POSIX.1, if count is greater than SSIZE_MAX, "
+					  "the result is implementation-defined; see NOTES for the upper limit on Linux.\"");
+
+	// Keep reading until there's nothing left, so that a burst of events is handled all at once
+	// instead of backing up.
+	while (true)
+	{
+		auto const readCount = read(m_deviceFileHandle, events, kEventBufferSize);
+
+		// I think maybe this would happen if the device got disconnected?
+		if (readCount < 0)
+		{
+			// When we are in nonblocking mode, this "error" means that there was no data and 
+			// we need to check the device again.
+			if (errno == EAGAIN)
+			{
+				break;
+			}
+
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			std::string const errorMessage(
+				(std::ostringstream() << "Failed to read from input device \'" << m_deviceName << "\'")
+					.str());
+
+			// This releases the keys that were held.
+			CloseDevice(true, errorMessage);
+
+			return;
+		}
+
+		if (readCount == 0)
+		{
+			break;
+		}
+		
+		// The events are timestamped by the kernel on the event clock. Note where that clock is
+		// relative to ours, so that the timestamps can be translated.
+		auto const readTime = TimerClock::now();
+		auto const eventClockNow = GetEventClockNow();
+		
+		// Process each of the input events.
+		auto const eventCount = static_cast<std::size_t>(readCount) / kEventSize;
+		for (std::size_t eventIndex = 0; eventIndex < eventCount; eventIndex++)
+		{
+			auto const& event = events[eventIndex];
+			
+			// We are only handling keys/buttons for now.
+			if (event.type != EV_KEY)
+			{
+				continue;
+			}
+
+			// Gestures and latencies are timed by when the events happened, not by when we got
+			// around to reading them.
+			auto const eventClockTime = InputEventTime(std::chrono::seconds(event.input_event_sec) +
+																	 std::chrono::microseconds(event.input_event_usec));
+			auto const eventTime = readTime - std::max(eventClockNow - eventClockTime, InputEventTime(0));
+
+			m_keyTracker.HandleKeyEvent(event.code, event.value, eventTime);
+
+			if (event.value == 1)
+			{
+				auto const gestureIndex = m_gestureRecognizer.HandleKeyPressed(event.code,
+																									eventClockTime);
+
+				if (gestureIndex != InputGestureRecognizer::kNoGesture)
+				{
+					MakeGesture(gestureIndex);
+				}
+			}
+			else if (event.value == 0)
+			{
+				m_gestureRecognizer.HandleKeyReleased(event.code);
+			}
+		}
+	}
+
+	// Only now that everything has been read do the controls change, and only the ones that need to.
+	ApplyKeyActions();
+
+	UpdateLongPressDeadline();
+}
+
+// Give each control the action that the keys want, if it has changed.
+//
+void Input::ApplyKeyActions()
+{
+	m_keyTracker.ApplyChanges([](ControlHandle controlHandle, Control::Actions action,
+										  Time const& time, StatsLatencyID latencyID)
+	{
+		auto* const control = Control::GetByHandle(controlHandle);
+
+		if (control == nullptr)
+		{
+			return;
+		}
+
+		// Manipulate the control, measuring from when the key was pressed or released.
+		static constexpr unsigned int kDurationPercent{ 100u };
+		control->SetDesiredAction(action, Control::Modes::kModeManual, kDurationPercent, time,
+										  latencyID);
+	});
+}
+
+// Do what a gesture does.
+//
+// gestureIndex:	The index of the gesture that was made.
+//
+void Input::MakeGesture(unsigned int gestureIndex)
+{
+	auto const& gesture = m_gestureRecognizer.GetGesture(gestureIndex);
+
+	Logger::WriteLine("Input device \'", m_deviceName, "\': ", kGestureTypeNames[gesture.m_type],
+							" gesture -> ", kGestureActionNames[gesture.m_action], ".");
+
+	// The keys that made the gesture shouldn't also keep doing what they're bound to.
+	for (unsigned int keyIndex = 0u; keyIndex < gesture.GetKeyCount(); keyIndex++)
+	{
+		m_keyTracker.ConsumeKey(gesture.m_keyCodes[keyIndex], TimerClock::now());
+	}
+
+	switch (gesture.m_action)
+	{
+		case InputGesture::kActionStopAll:
+		{
+			ControlsStopAll();
+
+			// Everything is stopped, so none of the held keys should start anything up again.
+			m_keyTracker.StopAll();
+
+			ReportsAddControlItem("all", Control::kActionStopped, "gesture");
+		}
+		break;
+
+		case InputGesture::kActionStartRoutine:
+		{
+			RoutineStart();
+		}
+		break;
+
+		case InputGesture::kActionMoveControl:
+		{
+			auto const& controlAction = gesture.m_controlAction;
+			auto* const control = controlAction.GetControl();
+
+			if (control == nullptr)
+			{
+				break;
+			}
+
+			control->SetDesiredAction(controlAction.m_action, Control::kModeTimed);
+
+			// The control is already doing what it was told, so the keys have nothing to change.
+			m_keyTracker.SetControlAction(controlAction.m_controlHandle, controlAction.m_action);
+
+			ReportsAddControlItem(control->GetName(), controlAction.m_action, "gesture");
+		}
+		break;
+
+		default:
+		break;
+	}
+}
+
+// Make the long presses that are due, and figure out when the next one will be.
+//
+void Input::ProcessLongPresses()
+{
+	if ((m_hasLongPressDeadline == false) || (TimerClock::now() < m_longPressDeadline))
+	{
+		return;
+	}
+
+	auto const eventClockNow = GetEventClockNow();
+
+	while (true)
+	{
+		auto const gestureIndex = m_gestureRecognizer.HandleTime(eventClockNow);
+
+		if (gestureIndex == InputGestureRecognizer::kNoGesture)
+		{
+			break;
+		}
+
+		MakeGesture(gestureIndex);
+	}
+
+	ApplyKeyActions();
+
+	UpdateLongPressDeadline();
+}
+
+// Figure out when the next long press will be, if there is one pending.
+//
+void Input::UpdateLongPressDeadline()
+{
+	InputEventTime longPressTime;
+	m_hasLongPressDeadline = m_gestureRecognizer.GetNextLongPressTime(longPressTime);
+
+	if (m_hasLongPressDeadline == false)
+	{
+		return;
+	}
+
+	// The long press is timed on the event clock, so translate it to the clock we schedule with.
+	auto const timeUntilLongPress = std::max(longPressTime - GetEventClockNow(), InputEventTime(0));
+	m_longPressDeadline = TimerClock::now() + timeUntilLongPress;
+}
+
+// Get the current time on the clock that the input events are timestamped with.
+//
+InputEventTime Input::GetEventClockNow() const
+{
+	timespec now;
+	clock_gettime(m_eventClockID, &now);
+
+	return std::chrono::duration_cast<InputEventTime>(std::chrono::seconds(now.tv_sec) +
+																	  std::chrono::nanoseconds(now.tv_nsec));
+}
+
+// Determine whether the input device is connected.
+//
+bool Input::IsConnected() const
+{
+	return (m_deviceFileHandle != kInvalidFileHandle);
+}
+
+// Close the input device.
+//
+// wasFailure:	Whether the device is being closed due to a failure or not.
+// message: message that may be logged
+//
+void Input::CloseDevice(bool const wasFailure, std::string_view const message)
+{
+	// Close the device.
+	if (m_deviceFileHandle != kInvalidFileHandle)
+	{
+		ReactorRemoveFileDescriptor(m_deviceFileHandle);
+		close(m_deviceFileHandle);
+		m_deviceFileHandle = kInvalidFileHandle;
+
+		// We won't hear about the held keys being released, so don't leave their controls moving.
+		m_keyTracker.ReleaseAllKeys(TimerClock::now());
+		ApplyKeyActions();
+
+		m_gestureRecognizer.Reset();
+		m_hasLongPressDeadline = false;
+	}
+			
+	// Only log a message/play sound on failure.
+	if (wasFailure == false) {
+		return;
+	}
+	
+	// And only if it was the first failure.
+	if (m_deviceOpenHasFailed == true)
+	{
+		return;
+	}
+	
+	m_deviceOpenHasFailed = true;	
+	
+	// Log the message.
+	Logger::WriteLine(Shell::Red(message));
+
+	// Play controller disconnected notification.
+	NotificationPlay("control_disconnected");
+}
+
+// Functions
+//
+
+// Initialize all of the input devices. Each one is read as soon as it has events, so adding devices
+// doesn't add work when nothing is happening.
+//
+// configs:				Configuration parameters for the input devices.
+// gestureTimings:	How the gestures are timed.
+//
+void InputsInitialize(std::vector<InputDeviceConfig> const& configs,
+							 InputGestureTimings const& gestureTimings)
+{
+	// Devices appearing are noticed with inotify. Without it, missing devices are checked for
+	// periodically instead.
+	s_hotplugFileDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if ((s_hotplugFileDescriptor >= 0) &&
+		 (ReactorAddFileDescriptor(s_hotplugFileDescriptor, EPOLLIN,
+											[](std::uint32_t /* events */) { InputHandleHotplug(); }) == false))
+	{
+		close(s_hotplugFileDescriptor);
+		s_hotplugFileDescriptor = kInvalidFileDescriptor;
+	}
+
+	if (s_hotplugFileDescriptor < 0)
+	{
+		s_hotplugFileDescriptor = kInvalidFileDescriptor;
+		Logger::WriteLine(Shell::Yellow("Failed to start watching for input devices to appear."));
+	}
+
+	for (auto const& config : configs)
+	{
+		s_inputs.push_back(std::make_unique<Input>());
+		s_inputs.back()->Initialize(config, gestureTimings);
+	}
+}
+
+// Uninitialize all of the input devices.
+//
+void InputsUninitialize()
+{
+	for (auto& input : s_inputs)
+	{
+		input->Uninitialize();
+	}
+
+	s_inputs.clear();
+
+	if (s_hotplugFileDescriptor != kInvalidFileDescriptor)
+	{
+		ReactorRemoveFileDescriptor(s_hotplugFileDescriptor);
+		close(s_hotplugFileDescriptor);
+		s_hotplugFileDescriptor = kInvalidFileDescriptor;
+	}
+}
+
+// Process the input devices.
+//
+void InputsProcess()
+{
+	for (auto& input : s_inputs)
+	{
+		input->Process();
+	}
+}
+
+// Get the next time that any of the input devices need to be processed, if any.
+//
+// deadline:	(Output) The time by which the input devices need to be processed.
+//
+// Returns:	True if an input device needs to be processed again, false otherwise.
+//
+bool InputsGetNextDeadline(Time& deadline)
+{
+	auto hasDeadline = false;
+
+	for (auto const& input : s_inputs)
+	{
+		Time inputDeadline;
+		if (input->GetNextDeadline(inputDeadline) == false)
+		{
+			continue;
+		}
+
+		if ((hasDeadline == false) || (inputDeadline < deadline))
+		{
+			deadline = inputDeadline;
+			hasDeadline = true;
+		}
+	}
+
+	return hasDeadline;
+}
+
+// Get the number of input devices that are connected.
+//
+unsigned int InputsGetConnectedCount()
+{
+	unsigned int connectedCount = 0u;
+
+	for (auto const& input : s_inputs)
+	{
+		if (input->IsConnected() == true)
+		{
+			connectedCount++;
+		}
+	}
+
+	return connectedCount;
 }
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <map>
+#include <array>
 #include <vector>
 
 #include "control.h"
@@ -37,6 +37,322 @@ struct InputBinding
 	ControlAction		m_controlAction;
 };
 
+// A gesture made with one or two keys, and what it does. Gestures let a single motion do what would
+// otherwise take several timed presses.
+struct InputGesture
+{
+	// Types.
+
+	// The kinds of gestures.
+	enum Types
+	{
+		kTypeChord = 0,	// Two keys pressed at (nearly) the same time.
+		kTypeLongPress,	// A key held down for a while.
+		kTypeDoubleTap,	// A key pressed twice in quick succession.
+		kNumTypes,
+	};
+
+	// What a gesture does.
+	enum Actions
+	{
+		kActionStopAll = 0,		// Stop all of the controls.
+		kActionStartRoutine,	// Start the routine.
+		kActionMoveControl,		// Move a control for its full moving duration.
+		kNumActions,
+	};
+
+	// Read an input gesture from JSON.
+	//
+	// object:	The JSON object representing a gesture.
+	//
+	// Returns:		True if the gesture was read successfully, false otherwise.
+	//
+	bool ReadFromJSON(rapidjson::Value const& object);
+
+	// Get the number of keys that make the gesture.
+	//
+	unsigned int GetKeyCount() const
+	{
+		return (m_type == kTypeChord) ? 2u : 1u;
+	}
+
+	// The kind of gesture.
+	Types m_type = kTypeChord;
+
+	// The numeric codes of the keys that make the gesture. Only chords use the second one.
+	std::array<unsigned short, 2> m_keyCodes = {};
+
+	// What the gesture does.
+	Actions m_action = kActionStopAll;
+
+	// The control action, when the gesture moves a control.
+	ControlAction m_controlAction;
+};
+
+// How close together keys have to be pressed, or how long they have to be held, to make gestures.
+struct InputGestureTimings
+{
+	// The most time between the presses of the two keys of a chord (in milliseconds).
+	unsigned int m_chordWindowMS = 150;
+
+	// How long a key has to be held to make a long press (in milliseconds).
+	unsigned int m_longPressDurationMS = 1'000;
+
+	// The most time between the two presses of a double tap (in milliseconds).
+	unsigned int m_doubleTapWindowMS = 400;
+};
+
+// The time of an input event, on the clock of the device that it came from.
+using InputEventTime = std::chrono::microseconds;
+
+// Recognizes gestures from key presses and releases. It only knows about the times it's given, so it
+// can be driven by the timestamps of the input events.
+class InputGestureRecognizer
+{
+	public:
+
+		// Constants.
+
+		// Returned when no gesture was made.
+		static constexpr unsigned int kNoGesture{ ~0u };
+
+		// Set the gestures to recognize.
+		//
+		// gestures:	The gestures to recognize.
+		// timings:		How the gestures are timed.
+		//
+		void Initialize(std::vector<InputGesture> const& gestures, InputGestureTimings const& timings);
+
+		// Forget about the keys that are held and the taps that have been made.
+		//
+		void Reset();
+
+		// Handle a key being pressed.
+		//
+		// keyCode:	The code of the key.
+		// time:		When the key was pressed.
+		//
+		// Returns:	The index of the gesture that was made, or kNoGesture.
+		//
+		unsigned int HandleKeyPressed(unsigned short keyCode, InputEventTime time);
+
+		// Handle a key being released.
+		//
+		// keyCode:	The code of the key.
+		//
+		void HandleKeyReleased(unsigned short keyCode);
+
+		// Handle time passing, which is what makes a long press.
+		//
+		// time:	The current time.
+		//
+		// Returns:	The index of the gesture that was made, or kNoGesture.
+		//
+		unsigned int HandleTime(InputEventTime time);
+
+		// Get the next time that a long press will be made, if the keys stay held.
+		//
+		// time:	(Output) The time that the next long press will be made.
+		//
+		// Returns:	True if a long press is pending, false otherwise.
+		//
+		bool GetNextLongPressTime(InputEventTime& time) const;
+
+		// Get a gesture that is being recognized.
+		//
+		// gestureIndex:	The index of the gesture.
+		//
+		InputGesture const& GetGesture(unsigned int gestureIndex) const
+		{
+			return m_gestures[gestureIndex];
+		}
+
+	private:
+
+		// Where a gesture is at in being made.
+		struct GestureState
+		{
+			// Whether each of the gesture's keys is being held.
+			std::array<bool, 2> m_keysHeld = {};
+
+			// When each of the gesture's keys was last pressed.
+			std::array<InputEventTime, 2> m_keyPressTimes = {};
+
+			// Whether the gesture has been made with the keys that are being held.
+			bool m_made = false;
+
+			// Whether the first tap of a double tap has been made.
+			bool m_tapPending = false;
+		};
+
+		// The gestures to recognize.
+		std::vector<InputGesture> m_gestures;
+
+		// Where each of the gestures is at.
+		std::vector<GestureState> m_gestureStates;
+
+		// How the gestures are timed.
+		InputGestureTimings m_timings;
+};
+
+// Tracks which of the bound keys are held and what they want each control to do. Any number of key
+// events can be handled before the changes are applied, so that each control changes at most once
+// for all of them. It only knows about the times it's given, so it can be driven by the timestamps
+// of the input events.
+class InputKeyTracker
+{
+	public:
+
+		// Forget about all of the bindings and the keys that are held.
+		//
+		void Clear();
+
+		// Bind a key to a control action. Binding a key again replaces what it was bound to.
+		//
+		// keyCode:			The code of the key.
+		// controlHandle:	The control to manipulate.
+		// action:			The action for the control.
+		// latencyID:		Where to record the time from the key being pressed or released until the
+		//						pins change.
+		//
+		void Bind(unsigned short keyCode, ControlHandle controlHandle, Control::Actions action,
+					 StatsLatencyID latencyID);
+
+		// Handle a key being pressed, held, or released.
+		//
+		// keyCode:		The code of the key.
+		// value:		1 if the key was pressed, 2 if it's being held (autorepeat), 0 if it was
+		//					released.
+		// eventTime:	When the key event happened.
+		//
+		void HandleKeyEvent(unsigned short keyCode, int value, Time const& eventTime);
+
+		// Release a key without it doing anything more, because it made a gesture.
+		//
+		// keyCode:	The code of the key.
+		// time:		When the gesture was made.
+		//
+		void ConsumeKey(unsigned short keyCode, Time const& time);
+
+		// Release every key that is being held down, like when the device goes away.
+		//
+		// time:	When the keys were let go.
+		//
+		void ReleaseAllKeys(Time const& time);
+
+		// Note that something else has already given a control an action, so the keys have nothing to
+		// change until they are pressed or released again.
+		//
+		// controlHandle:	The control.
+		// action:			The action the control was given.
+		//
+		void SetControlAction(ControlHandle controlHandle, Control::Actions action);
+
+		// Note that every control has been stopped, and that none of the held keys should start
+		// anything up again.
+		//
+		void StopAll();
+
+		// Call a function for each control whose action the keys have changed since the last time.
+		//
+		// apply:	Called with the control handle, the action the keys want, when the key that
+		//				decided that was pressed or released, and where to record the latency.
+		//
+		template <typename ApplyType>
+		void ApplyChanges(ApplyType const& apply)
+		{
+			for (ControlHandle controlHandle = 0u; controlHandle < m_controlKeyStates.size();
+				  controlHandle++)
+			{
+				auto& controlKeyState = m_controlKeyStates[controlHandle];
+
+				if (controlKeyState.m_wantedAction == controlKeyState.m_appliedAction)
+				{
+					continue;
+				}
+
+				controlKeyState.m_appliedAction = controlKeyState.m_wantedAction;
+				apply(controlHandle, controlKeyState.m_wantedAction, controlKeyState.m_wantedTime,
+						controlKeyState.m_wantedLatencyID);
+			}
+		}
+
+	private:
+
+		// What a key does, already resolved so that handling a key press doesn't have to search.
+		struct KeyAction
+		{
+			// The control to manipulate, or kInvalidControlHandle if the key isn't bound.
+			ControlHandle m_controlHandle = kInvalidControlHandle;
+
+			// The action for the control.
+			Control::Actions m_action = Control::kActionStopped;
+
+			// Whether the key is being held down.
+			bool m_pressed = false;
+
+			// Where to record the time from the key being pressed or released until the pins change.
+			StatsLatencyID m_latencyID = kStatsNoLatency;
+		};
+
+		// What the keys want a control to do, so that all of the events read at once only change
+		// the control once.
+		struct ControlKeyState
+		{
+			// The action that the held keys want.
+			Control::Actions m_wantedAction = Control::kActionStopped;
+
+			// The action that was last given to the control.
+			Control::Actions m_appliedAction = Control::kActionStopped;
+
+			// When the key that decided the wanted action was pressed or released, and where to record
+			// the time from then until the pins change.
+			Time m_wantedTime;
+			StatsLatencyID m_wantedLatencyID = kStatsNoLatency;
+		};
+
+		// Make room to track a control.
+		//
+		// controlHandle:	The control.
+		//
+		// Returns:	What the keys want the control to do.
+		//
+		ControlKeyState& GetControlKeyState(ControlHandle controlHandle);
+
+		// What each key does, indexed by key code.
+		std::vector<KeyAction> m_keyCodeToAction;
+
+		// What the keys want each control to do, indexed by control handle.
+		std::vector<ControlKeyState> m_controlKeyStates;
+};
+
+// Configuration parameters for an input device.
+struct InputDeviceConfig
+{
+	// Read an input device config from JSON.
+	//
+	// object:	The JSON object representing an input device config.
+	//
+	// Returns:		True if the config was read successfully, false otherwise.
+	//
+	bool ReadFromJSON(rapidjson::Value const& object);
+
+	// Constants.
+	static constexpr unsigned int kDeviceNameCapacity{ 64u };
+
+	// The name of the device, like "/dev/input/event0".
+	char m_deviceName[kDeviceNameCapacity];
+
+	// The input bindings for the device.
+	std::vector<InputBinding> m_bindings;
+
+	// The gestures for the device.
+	std::vector<InputGesture> m_gestures;
+
+	// Whether to grab the device, so that nothing else (like the console) gets its events.
+	bool m_exclusive = false;
+};
+
 // Handles dealing with an input device.
 //
 class Input
@@ -45,10 +361,10 @@ class Input
 		
 		// Handle initialization.
 		//
-		// deviceName:	The name of the input device that this will manage.
-		// bindings:		A list of input bindings.
+		// config:				Configuration parameters for the input device that this will manage.
+		// gestureTimings:	How the gestures are timed.
 		//
-		void Initialize(char const* deviceName, std::vector<InputBinding> const& bindings);
+		void Initialize(InputDeviceConfig const& config, InputGestureTimings const& gestureTimings);
 
 		// Handle uninitialization.
 		//
@@ -57,10 +373,23 @@ class Input
 		// Process a tick.
 		//
 		void Process();
+
+		// Get the next time that the input needs to be processed, if any.
+		//
+		// deadline:	(Output) The time by which the input needs to be processed.
+		//
+		// Returns:	True if the input needs to be processed again, false otherwise.
+		//
+		bool GetNextDeadline(Time& deadline) const;
 		
 		// Determine whether the input device is connected.
 		//
 		bool IsConnected() const;
+
+		// Handle a device appearing in the directory that the input device is in, which may be the
+		// input device coming back.
+		//
+		void HandleDeviceAppeared();
 		
 	private:
 
@@ -72,8 +401,39 @@ class Input
 		// Used to detect when a file handle is invalid.
 		static constexpr int	kInvalidFileHandle{ -1 };
 
-		// The amount of time to wait between failing to open the device.
-		static constexpr unsigned int kDeviceOpenRetryDelayMS{ 1'000u };
+		// The amount of time to wait between failing to open the device, when we can't be told that
+		// it has appeared.
+		static constexpr std::chrono::milliseconds kDeviceOpenRetryDelay{ 1'000 };
+
+		// Try to open the input device.
+		//
+		void OpenDevice();
+
+		// Read and handle all of the input events that are available from the device.
+		//
+		void ReadEvents();
+
+		// Give each control the action that the keys want, if it has changed.
+		//
+		void ApplyKeyActions();
+
+		// Do what a gesture does.
+		//
+		// gestureIndex:	The index of the gesture that was made.
+		//
+		void MakeGesture(unsigned int gestureIndex);
+
+		// Make the long presses that are due, and figure out when the next one will be.
+		//
+		void ProcessLongPresses();
+
+		// Figure out when the next long press will be, if there is one pending.
+		//
+		void UpdateLongPressDeadline();
+
+		// Get the current time on the clock that the input events are timestamped with.
+		//
+		InputEventTime GetEventClockNow() const;
 
 		// Close the input device.
 		//
@@ -93,10 +453,60 @@ class Input
 		
 		// A time, so we can tell how long to wait before trying to open the device again.
 		Time m_lastDeviceOpenFailTime;
+
+		// Whether we are told when devices appear in the device's directory, so that we don't have to
+		// keep trying to open it.
+		bool m_watchingForHotplug = false;
 				
 		// The list of input bindings.
 		std::vector<InputBinding> m_bindings;
+
+		// Whether to grab the device, so that nothing else gets its events.
+		bool m_exclusive = false;
 		
-		// A mapping from input to action.
-		std::map<unsigned short, ControlAction> m_inputToActionMap;
+		// Tracks the bound keys and what they want the controls to do.
+		InputKeyTracker m_keyTracker;
+
+		// Recognizes the gestures made with the keys.
+		InputGestureRecognizer m_gestureRecognizer;
+
+		// The clock that the input events are timestamped with.
+		clockid_t m_eventClockID = CLOCK_REALTIME;
+
+		// When the next long press will be made, if the key stays held.
+		bool m_hasLongPressDeadline = false;
+		Time m_longPressDeadline;
 };
+
+// Functions
+//
+
+// Initialize all of the input devices. Each one is read as soon as it has events, so adding devices
+// doesn't add work when nothing is happening. Devices that go missing are reopened as soon as they
+// reappear. The reactor should already be initialized.
+//
+// configs:				Configuration parameters for the input devices.
+// gestureTimings:	How the gestures are timed.
+//
+void InputsInitialize(std::vector<InputDeviceConfig> const& configs,
+							 InputGestureTimings const& gestureTimings);
+
+// Uninitialize all of the input devices.
+//
+void InputsUninitialize();
+
+// Process the input devices.
+//
+void InputsProcess();
+
+// Get the next time that any of the input devices need to be processed, if any.
+//
+// deadline:	(Output) The time by which the input devices need to be processed.
+//
+// Returns:	True if an input device needs to be processed again, false otherwise.
+//
+bool InputsGetNextDeadline(Time& deadline);
+
+// Get the number of input devices that are connected.
+//
+unsigned int InputsGetConnectedCount();
@@ -0,0 +1,337 @@
+#include "intent.h"
+
+#include "rapidjson/reader.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+// Types
+//
+
+// The object or array below the top level of the payload that the reader is inside of.
+enum IntentSection
+{
+	kIntentSectionNone = 0,
+	kIntentSectionIntent,			// "intent"
+	kIntentSectionTermination,		// "termination"
+	kIntentSectionSlots,				// "slots"
+};
+
+// Receives the events from the rapidjson reader and keeps just the fields we care about.
+class IntentReaderHandler :
+	public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, IntentReaderHandler>
+{
+	public:
+
+		// Handle construction.
+		//
+		// message:				(Output) Where to keep the fields that are found.
+		// requestedFields:	The fields to look for, as a combination of IntentField values.
+		//
+		IntentReaderHandler(IntentMessage& message, unsigned int requestedFields) :
+			m_message(message),
+			m_requestedFields(requestedFields)
+		{
+		}
+
+		// Get whether all of the requested fields have been found.
+		//
+		bool IsDone() const
+		{
+			return (m_foundFields & m_requestedFields) == m_requestedFields;
+		}
+
+		// The reader events that matter to us. Returning false stops the reader.
+
+		bool Key(char const* string, rapidjson::SizeType length, bool /* copy */)
+		{
+			// Keys are read in place too, but are only needed until the value that follows them.
+			m_key = std::string_view(string, length);
+			return true;
+		}
+
+		bool String(char const* string, rapidjson::SizeType length, bool /* copy */)
+		{
+			// The payload is read in place, so the string lives as long as the payload does.
+			std::string_view const value(string, length);
+
+			if (m_depth == 1u)
+			{
+				if (m_key == "sessionId")
+				{
+					m_message.m_sessionID = value;
+					m_foundFields |= kIntentFieldSessionID;
+				}
+			}
+			else if (m_depth == 2u)
+			{
+				if ((m_section == kIntentSectionIntent) && (m_key == "intentName"))
+				{
+					m_message.m_intentName = value;
+					m_foundFields |= kIntentFieldIntentName;
+				}
+				else if ((m_section == kIntentSectionTermination) && (m_key == "reason"))
+				{
+					m_message.m_terminationReason = value;
+				}
+			}
+			else if ((m_depth == 3u) && (m_section == kIntentSectionSlots) && (m_keepingSlot == true))
+			{
+				auto& slot = m_message.m_slots[m_message.m_slotCount - 1u];
+
+				if (m_key == "slotName")
+				{
+					slot.m_name = value;
+				}
+				else if (m_key == "rawValue")
+				{
+					slot.m_value = value;
+				}
+			}
+
+			return IsDone() == false;
+		}
+
+		bool StartObject()
+		{
+			m_depth++;
+
+			if (m_depth == 2u)
+			{
+				if (m_key == "intent")
+				{
+					m_section = kIntentSectionIntent;
+				}
+				else if (m_key == "termination")
+				{
+					m_section = kIntentSectionTermination;
+				}
+			}
+			else if ((m_depth == 3u) && (m_section == kIntentSectionSlots))
+			{
+				// Start a new slot, if there's room for it.
+				m_keepingSlot = (m_message.m_slotCount < IntentMessage::kMaxSlotCount);
+
+				if (m_keepingSlot == true)
+				{
+					m_message.m_slots[m_message.m_slotCount] = IntentMessage::Slot();
+					m_message.m_slotCount++;
+				}
+			}
+
+			return true;
+		}
+
+		bool EndObject(rapidjson::SizeType /* memberCount */)
+		{
+			if ((m_depth == 2u) && (m_section == kIntentSectionTermination))
+			{
+				m_foundFields |= kIntentFieldTermination;
+			}
+
+			return EndContainer();
+		}
+
+		bool StartArray()
+		{
+			m_depth++;
+
+			if ((m_depth == 2u) && (m_key == "slots"))
+			{
+				m_section = kIntentSectionSlots;
+			}
+
+			return true;
+		}
+
+		bool EndArray(rapidjson::SizeType /* elementCount */)
+		{
+			if ((m_depth == 2u) && (m_section == kIntentSectionSlots))
+			{
+				m_foundFields |= kIntentFieldSlots;
+			}
+
+			return EndContainer();
+		}
+
+	private:
+
+		// Handle leaving an object or array.
+		//
+		// Returns:	True to keep reading, false to stop.
+		//
+		bool EndContainer()
+		{
+			m_depth--;
+
+			if (m_depth <= 1u)
+			{
+				m_section = kIntentSectionNone;
+			}
+
+			return IsDone() == false;
+		}
+
+		// Where to keep the fields that are found.
+		IntentMessage& m_message;
+
+		// The fields to look for, and the ones found so far.
+		unsigned int m_requestedFields;
+		unsigned int m_foundFields = 0u;
+
+		// How many objects and arrays deep the reader is. The top level object is 1.
+		unsigned int m_depth = 0u;
+
+		// What the reader is inside of below the top level.
+		IntentSection m_section = kIntentSectionNone;
+
+		// The most recent key.
+		std::string_view m_key;
+
+		// Whether the slot being read is being kept.
+		bool m_keepingSlot = false;
+};
+
+// Locals
+//
+
+// Every payload we write is serialized here. The buffer keeps its capacity between payloads, so
+// once it has grown to fit the largest one, writing doesn't allocate.
+static rapidjson::StringBuffer s_payloadBuffer;
+static rapidjson::Writer<rapidjson::StringBuffer> s_payloadWriter(s_payloadBuffer);
+
+// Functions
+//
+
+// Start serializing a payload, discarding the last one.
+//
+// Returns:	The writer to serialize the payload with.
+//
+static rapidjson::Writer<rapidjson::StringBuffer>& IntentBeginPayload()
+{
+	s_payloadBuffer.Clear();
+	s_payloadWriter.Reset(s_payloadBuffer);
+	return s_payloadWriter;
+}
+
+// Write a string value into the payload being serialized, escaping it as needed.
+//
+// text:	The string.
+//
+static void IntentWriteString(std::string_view text)
+{
+	s_payloadWriter.String(text.data(), static_cast<rapidjson::SizeType>(text.size()));
+}
+
+// Get the payload that was just serialized.
+//
+// Returns:	The payload. It is only valid until the next payload is started.
+//
+static std::string_view IntentGetPayload()
+{
+	return std::string_view(s_payloadBuffer.GetString(), s_payloadBuffer.GetSize());
+}
+
+// Read the fields we need from a message payload without building a document. Reading stops as soon
+// as all of the requested fields have been found, so anything after them isn't even parsed.
+//
+// message:				(Output) The fields that were found. Those that weren't are left empty.
+// payload:				The JSON payload, which must be null terminated. It is modified in place,
+// 						and the strings in the message point into it.
+// requestedFields:	The fields to look for, as a combination of IntentField values.
+//
+// Returns:	True if the payload could be read, false if it isn't valid JSON.
+//
+bool IntentReadFromPayload(IntentMessage& message, char* payload, unsigned int requestedFields)
+{
+	message = IntentMessage();
+
+	IntentReaderHandler handler(message, requestedFields);
+
+	// Reading in place means strings don't need to be copied anywhere.
+	rapidjson::InsituStringStream payloadStream(payload);
+
+	rapidjson::Reader reader;
+	auto const result = reader.Parse<rapidjson::kParseInsituFlag>(payloadStream, handler);
+
+	// Stopping early shows up as an error, but it means we got everything we wanted.
+	if (handler.IsDone() == true)
+	{
+		return true;
+	}
+
+	return result.IsError() == false;
+}
+
+// Write the payload that continues or ends a dialogue session, speaking some text.
+//
+// sessionID:	The dialogue session ID.
+// text:			The text to speak, which may be empty.
+//
+// Returns:	The JSON payload. It is only valid until the next payload is written.
+//
+std::string_view IntentWriteSessionPayload(std::string_view sessionID, std::string_view text)
+{
+	auto& writer = IntentBeginPayload();
+
+	writer.StartObject();
+	writer.Key("sessionId");
+	IntentWriteString(sessionID);
+	writer.Key("text");
+	IntentWriteString(text);
+	writer.EndObject();
+
+	return IntentGetPayload();
+}
+
+// Write the payload that starts a dialogue session to speak a notification.
+//
+// text:	The notification text.
+//
+// Returns:	The JSON payload. It is only valid until the next payload is written.
+//
+std::string_view IntentWriteNotificationPayload(std::string_view text)
+{
+	auto& writer = IntentBeginPayload();
+
+	writer.StartObject();
+	writer.Key("init");
+	writer.StartObject();
+	writer.Key("type");
+	IntentWriteString("notification");
+	writer.Key("text");
+	IntentWriteString(text);
+	writer.EndObject();
+	writer.Key("siteId");
+	IntentWriteString("default");
+	writer.EndObject();
+
+	return IntentGetPayload();
+}
+
+// Write the payload that speaks some text outside of any dialogue session.
+//
+// text:	The text to speak.
+//
+// Returns:	The JSON payload. It is only valid until the next payload is written.
+//
+std::string_view IntentWriteTextToSpeechPayload(std::string_view text)
+{
+	auto& writer = IntentBeginPayload();
+
+	writer.StartObject();
+	writer.Key("text");
+	IntentWriteString(text);
+	writer.Key("siteId");
+	IntentWriteString("default");
+	writer.Key("lang");
+	writer.Null();
+	writer.Key("id");
+	IntentWriteString("");
+	writer.Key("sessionId");
+	IntentWriteString("");
+	writer.Key("volume");
+	writer.Double(1.0);
+	writer.EndObject();
+
+	return IntentGetPayload();
+}
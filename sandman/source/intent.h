@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+// Types
+//
+
+// The parts of a Rhasspy (Hermes protocol) message payload that we act on. The strings point into
+// the payload that was read, so they are only valid as long as it is.
+struct IntentMessage
+{
+	// Constants.
+
+	// The most slots that will be kept. Any more are ignored.
+	static constexpr unsigned int kMaxSlotCount{ 8u };
+
+	// A slot name/value pair.
+	struct Slot
+	{
+		std::string_view m_name;
+		std::string_view m_value;
+	};
+
+	// The dialogue session ID ("sessionId").
+	std::string_view m_sessionID;
+
+	// The name of the recognized intent ("intent.intentName").
+	std::string_view m_intentName;
+
+	// Why a dialogue session ended ("termination.reason").
+	std::string_view m_terminationReason;
+
+	// The slots of the intent ("slots[].slotName" and "slots[].rawValue").
+	std::array<Slot, kMaxSlotCount> m_slots;
+	unsigned int m_slotCount = 0u;
+};
+
+// The fields of an intent message that can be asked for.
+enum IntentField
+{
+	kIntentFieldSessionID = 1u << 0u,
+	kIntentFieldIntentName = 1u << 1u,
+	kIntentFieldTermination = 1u << 2u,
+	kIntentFieldSlots = 1u << 3u,
+};
+
+// Functions
+//
+
+// Read the fields we need from a message payload without building a document. Reading stops as soon
+// as all of the requested fields have been found, so anything after them isn't even parsed.
+//
+// message:				(Output) The fields that were found. Those that weren't are left empty.
+// payload:				The JSON payload, which must be null terminated. It is modified in place,
+// 						and the strings in the message point into it.
+// requestedFields:	The fields to look for, as a combination of IntentField values.
+//
+// Returns:	True if the payload could be read, false if it isn't valid JSON.
+//
+bool IntentReadFromPayload(IntentMessage& message, char* payload, unsigned int requestedFields);
+
+// Write the payload that continues or ends a dialogue session, speaking some text.
+//
+// sessionID:	The dialogue session ID.
+// text:			The text to speak, which may be empty.
+//
+// Returns:	The JSON payload. It is only valid until the next payload is written.
+//
+std::string_view IntentWriteSessionPayload(std::string_view sessionID, std::string_view text);
+
+// Write the payload that starts a dialogue session to speak a notification.
+//
+// text:	The notification text.
+//
+// Returns:	The JSON payload. It is only valid until the next payload is written.
+//
+std::string_view IntentWriteNotificationPayload(std::string_view text);
+
+// Write the payload that speaks some text outside of any dialogue session.
+//
+// text:	The text to speak.
+//
+// Returns:	The JSON payload. It is only valid until the next payload is written.
+//
+std::string_view IntentWriteTextToSpeechPayload(std::string_view text);
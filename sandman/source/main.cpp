@@ -6,6 +6,7 @@
 
 #include <fcntl.h>
 #include <pwd.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -21,8 +22,11 @@
 #include "mqtt.h"
 #include "shell.h"
 #include "notification.h"
+#include "reactor.h"
 #include "reports.h"
 #include "routines.h"
+#include "server.h"
+#include "stats.h"
 #include "timer.h"
 
 // Types
@@ -43,17 +47,14 @@ enum ProgramMode
 // Whether controls have been initialized.
 static bool s_controlsInitialized = false;
 
-// The input device.
-static Input s_input;
-
 // What mode the program is running in.
 static ProgramMode s_programMode = kProgramModeInteractive;
 
-// Used to listen for connections.
-static int s_listeningSocket = -1;
-
 static int s_exitCode = 0;
 
+// Whether the program should exit.
+static bool s_done = false;
+
 // The base directory for files we will be using.
 static std::string s_baseDirectory;
 
@@ -127,57 +128,62 @@ static bool InitializeDaemon()
 	open("dev/null", O_RDWR);
 	open("dev/null", O_RDWR);
 
-	// Now that we are a daemon, set up Unix domain sockets for communication.
+	return true;
+}
 
-	// Create a listening socket.
-	s_listeningSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+// Handle a message from a socket client.
+//
+// message:		The message.
+// response:	(Output) The text to send back.
+//
+static void ProcessSocketMessage(std::string const& message, std::string& response)
+{
+	Logger::WriteLine("Received \"", message, "\".");
 
-	if (s_listeningSocket < 0)
+	// Handle the message, if necessary.
+	if (message == "shutdown")
 	{
-		Logger::WriteLine(Shell::Red("Failed to create listening socket."));
-		s_exitCode = 1;
-		return false;
+		s_done = true;
+		response = "ok\n";
 	}
-
-	// Set to non-blocking.
-	if (fcntl(s_listeningSocket, F_SETFL, O_NONBLOCK) < 0)
+	else if (message == "stats")
 	{
-		Logger::WriteLine(Shell::Red("Failed to make listening socket non-blocking."));
-		s_exitCode = 1;
-		return false;
+		// Reply with the processing time statistics.
+		StatsGetSummary(response);
 	}
-
-	sockaddr_un listeningAddress;
+	else
 	{
-		std::string const socketFilename = s_baseDirectory + "sandman.sock";
+		// Parse a command.
 
-		listeningAddress.sun_family = AF_UNIX;
-		std::strncpy(listeningAddress.sun_path, socketFilename.c_str(),
-							sizeof(listeningAddress.sun_path) - 1);
-	}
+		// Tokenize the message.
+		CommandTokenList commandTokens;
+		CommandTokenizeString(commandTokens, message);
 
-	// Unlink the file if needed.
-	unlink(listeningAddress.sun_path);
+		// Parse command tokens.
+		char const* confirmationText = nullptr;
+		auto const result = CommandParseTokens(confirmationText, commandTokens);
 
-	// Bind the socket to the file.
-	if (bind(s_listeningSocket, reinterpret_cast<sockaddr*>(&listeningAddress),
-				sizeof(sockaddr_un)) < 0)
-	{
-		Logger::WriteLine(Shell::Red("Failed to bind listening socket."));
-		s_exitCode = 1;
-		return false;
-	}
+		switch (result)
+		{
+			case CommandParseTokensReturnTypes::kSuccess:
+			{
+				response = "ok\n";
+			}
+			break;
 
-	// Mark the socket for listening.
-	if (listen(s_listeningSocket, 5) < 0)
-	{
-		Logger::WriteLine(Shell::Red("Failed to mark listening socket to listen."));
-		s_exitCode = 1;
-		return false;
-	}
+			case CommandParseTokensReturnTypes::kMissingConfirmation:
+			{
+				response = std::string("confirm: ") + confirmationText + "\n";
+			}
+			break;
 
-	// Sockets setup!
-	return true;
+			default:
+			{
+				response = "error: invalid command\n";
+			}
+			break;
+		}
+	}
 }
 
 // Create directories and potentially files needed.
@@ -225,11 +231,6 @@ static bool SetupEnvironment()
 //
 static bool Initialize()
 {
-	if (SetupEnvironment() == false)
-	{
-		return false;
-	}
-
 	switch (s_programMode)
 	{
 		case kProgramModeDaemon:
@@ -273,6 +274,23 @@ static bool Initialize()
 		return false;
 	};
 
+	// Initialize the reactor before anything else might start another thread.
+	if (ReactorInitialize() == false)
+	{
+		s_exitCode = 1;
+		return false;
+	}
+
+	// Now that we are a daemon, set up Unix domain sockets for communication.
+	if (s_programMode == kProgramModeDaemon)
+	{
+		if (ServerInitialize(s_baseDirectory + "sandman.sock", ProcessSocketMessage) == false)
+		{
+			s_exitCode = 1;
+			return false;
+		}
+	}
+
 	Config config;
 
 	// Read the config.
@@ -282,13 +300,6 @@ static bool Initialize()
 		Logger::WriteLine(Shell::Yellow("Using default configuration."));
 	}
 
-	// Initialize MQTT.
-	if (MQTTInitialize() == false)
-	{
-		s_exitCode = 1;
-		return false;
-	}
-
 	// Initialize GPIO.
 	static constexpr bool kEnableGPIO = true;
 	GPIOInitialize(kEnableGPIO);
@@ -300,14 +311,32 @@ static bool Initialize()
 	Control::SetDurations(config.GetControlMaxMovingDurationMS(),
 								 config.GetControlCoolDownDurationMS());
 
+	// Choose whether requests change the pins right away.
+	Control::SetImmediateActuation(config.GetControlImmediateActuationEnabled());
+
 	// Enable all controls.
 	Control::Enable(true);
 
+	// Hand the controls to their own thread, if asked to. Everything about them has to be set up
+	// by now.
+	if (config.GetControlActuationThreadEnabled() == true)
+	{
+		ControlsStartActuationThread(config.GetControlActuationThreadPriority());
+	}
+
 	// Controls have been initialized.
 	s_controlsInitialized = true;
 
-	// Initialize the input device.
-	s_input.Initialize(config.GetInputDeviceName(), config.GetInputBindings());
+	// Initialize the input devices.
+	InputsInitialize(config.GetInputDeviceConfigs(), config.GetInputGestureTimings());
+	ControlsSetLatencyReportsEnabled(config.GetInputLatencyReportsEnabled());
+
+	// Initialize MQTT. Everything local is usable by now, and stays usable without it, so voice
+	// control is simply missing until it connects.
+	if (MQTTInitialize(config.GetMQTTThreadEnabled()) == false)
+	{
+		Logger::WriteLine(Shell::Yellow("Continuing without MQTT."));
+	}
 
 	// Initialize the routines.
 	RoutinesInitialize(s_baseDirectory);
@@ -316,7 +345,7 @@ static bool Initialize()
 	ReportsInitialize(s_baseDirectory);
 
 	// Initialize the commands.
-	CommandInitialize(s_input);
+	CommandInitialize();
 
 	NotificationPlay("initialized");
 
@@ -327,11 +356,8 @@ static bool Initialize()
 //
 static void Uninitialize()
 {
-	// Close the listening socket, if there was one.
-	if (s_listeningSocket >= 0)
-	{
-		close(s_listeningSocket);
-	}
+	// Disconnect the clients and close the listening socket, if there was one.
+	ServerUninitialize();
 
 	// Uninitialize the commands.
 	CommandUninitialize();
@@ -357,8 +383,11 @@ static void Uninitialize()
 	// Uninitialize GPIO.
 	GPIOUninitialize();
 
-	// Uninitialize the input.
-	s_input.Uninitialize();
+	// Uninitialize the input devices.
+	InputsUninitialize();
+
+	// Uninitialize the reactor.
+	ReactorUninitialize();
 
 	// Uninitialize logging.
 	Logger::Uninitialize();
@@ -369,79 +398,73 @@ static void Uninitialize()
 	}
 }
 
-// Process socket communication.
+// Process user input in the shell.
 //
-// returns:		True if the quit command was received, false otherwise.
-//
-static bool ProcessSocketCommunication()
+static void ProcessUserInput()
 {
-	// Attempt to accept an incoming connection.
-	auto const connectionSocket = accept(s_listeningSocket, nullptr, nullptr);
+	Shell::Lock const lock;
 
-	if (connectionSocket < 0)
+	// Handle all of the keys that are available.
+	while (true)
 	{
-		return false;
-	}
-
-	// Got a connection.
-	Logger::WriteLine("Got a new connection.");
+		auto const result = Shell::InputWindow::ProcessSingleUserKey();
 
-	// Try to read data.
-	static constexpr std::size_t kMessageBufferCapacity{ 100u };
-	char messageBuffer[kMessageBufferCapacity];
-
-	// Assert can subtract one from this without underflow.
-	static_assert(kMessageBufferCapacity >= 1u);
-
-	auto const numReceivedBytes = recv(connectionSocket, messageBuffer,
-												  kMessageBufferCapacity - 1u, 0);
-
-	if (numReceivedBytes <= 0)
-	{
-		Logger::WriteLine("Connection closed, error receiving.");
+		if (result == Shell::InputWindow::Result::kNoInput)
+		{
+			break;
+		}
 
-		// Close the connection.
-		close(connectionSocket);
-		return false;
+		if (result == Shell::InputWindow::Result::kRequestToQuit)
+		{
+			s_done = true;
+			break;
+		}
 	}
+}
 
-	// Terminate.
-	messageBuffer[numReceivedBytes] = '\0';
-
-	Logger::WriteLine("Received \"", messageBuffer, "\".");
-
-	// Handle the message, if necessary.
-	auto done = false;
+// Get the earliest time that any of the program components need to be processed, if any.
+//
+// deadline:	(Output) The earliest time by which something needs to be processed.
+//
+// Returns:	True if there is a deadline, false if we can wait for events indefinitely.
+//
+static bool GetNextDeadline(Time& deadline)
+{
+	auto hasDeadline = false;
 
-	if (std::strcmp(messageBuffer, "shutdown") == 0)
-	{
-		done = true;
-	}
-	else
+	// Keep the earliest deadline.
+	auto const ConsiderDeadline = [&](bool componentHasDeadline, Time const& componentDeadline)
 	{
-		// Parse a command.
-
-		// Tokenize the message.
-		std::vector<CommandToken> commandTokens;
-		CommandTokenizeString(commandTokens, messageBuffer);
+		if (componentHasDeadline == false)
+		{
+			return;
+		}
 
-		// Parse command tokens.
-		CommandParseTokens(commandTokens);
-	}
+		if ((hasDeadline == false) || (componentDeadline < deadline))
+		{
+			deadline = componentDeadline;
+			hasDeadline = true;
+		}
+	};
 
-	Logger::WriteLine("Connection closed.");
+	Time componentDeadline;
 
-	// Close the connection.
-	close(connectionSocket);
+	ConsiderDeadline(CommandGetNextDeadline(componentDeadline), componentDeadline);
+	ConsiderDeadline(InputsGetNextDeadline(componentDeadline), componentDeadline);
+	ConsiderDeadline(MQTTGetNextDeadline(componentDeadline), componentDeadline);
+	ConsiderDeadline(RoutinesGetNextDeadline(componentDeadline), componentDeadline);
+	ConsiderDeadline(ControlsGetNextDeadline(componentDeadline), componentDeadline);
+	ConsiderDeadline(ReportsGetNextDeadline(componentDeadline), componentDeadline);
 
-	return done;
+	return hasDeadline;
 }
 
 // Send a message to the daemon process.
 //
-// message:	The message to send.
+// message:			The message to send.
+// printResponse:	(Optional) Whether to wait for a response and print it.
 //
-static void SendMessageToDaemon(char const* message)
+static void SendMessageToDaemon(char const* message, bool printResponse = false)
 {
 	// Create a sending socket.
 	auto const sendingSocket = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -470,8 +493,10 @@ static void SendMessageToDaemon(char const* message)
 		return;
 	}
 
-	// Send the message.
-	if (send(sendingSocket, message, std::strlen(message), 0) < 0)
+	// Send the message, terminated so that the daemon knows where it ends.
+	auto const line = std::string(message) + '\n';
+
+	if (send(sendingSocket, line.c_str(), line.size(), MSG_NOSIGNAL) < 0)
 	{
 		std::printf("Failed to send \"%s\" message to the daemon.\n", message);
 		close(sendingSocket);
@@ -480,6 +505,28 @@ static void SendMessageToDaemon(char const* message)
 
 	std::printf("Sent \"%s\" message to the daemon.\n", message);
 
+	if (printResponse == true)
+	{
+		// Let the daemon know that there's nothing more coming, then print until it hangs up.
+		shutdown(sendingSocket, SHUT_WR);
+
+		static constexpr std::size_t kResponseBufferCapacity{ 512u };
+		char responseBuffer[kResponseBufferCapacity];
+
+		while (true)
+		{
+			auto const numReceivedBytes = recv(sendingSocket, responseBuffer,
+														  kResponseBufferCapacity, 0);
+
+			if (numReceivedBytes <= 0)
+			{
+				break;
+			}
+
+			std::fwrite(responseBuffer, 1, numReceivedBytes, stdout);
+		}
+	}
+
 	// Close the connection.
 	close(sendingSocket);
 }
@@ -514,6 +561,12 @@ static bool HandleCommandLine(char** arguments, unsigned int argumentCount)
 			SendMessageToDaemon("shutdown");
 			return true;
 		}
+		else if (std::strcmp(argument, "--stats") == 0)
+		{
+			static constexpr bool kPrintResponse = true;
+			SendMessageToDaemon("stats", kPrintResponse);
+			return true;
+		}
 		else
 		{
 			// We are going to see if there is a command to send to the daemon.
@@ -560,6 +613,12 @@ static bool HandleCommandLine(char** arguments, unsigned int argumentCount)
 
 int main(int argc, char** argv)
 {
+	// Find the base directory first, because messages to the daemon are sent through a socket in it.
+	if (SetupEnvironment() == false)
+	{
+		return 1;
+	}
+
 	// Deal with command line arguments.
 	if (HandleCommandLine(argv, argc) == true)
 	{
@@ -573,65 +632,76 @@ int main(int argc, char** argv)
 		return s_exitCode;
 	}
 
-	auto done = false;
-	while (done == false)
+	// Watch for the things that we respond to directly.
+	if (s_programMode == kProgramModeInteractive)
+	{
+		ReactorAddFileDescriptor(STDIN_FILENO, EPOLLIN, [](std::uint32_t /* events */)
+		{
+			StatsTimer const timer(kStatsSubsystemShell);
+			ProcessUserInput();
+		});
+	}
+
+	while (s_done == false)
 	{
-		// We're gonna track the framerate.
-		Time frameStartTime;
-		TimerGetCurrent(frameStartTime);
+		// Sleep until something happens or something needs to be processed.
+		Time deadline;
+		auto const hasDeadline = GetNextDeadline(deadline);
+
+		// Time everything that happens in response to waking up, starting with the handlers that the
+		// reactor calls.
+		Time wakeTime;
+
+		if (ReactorWait((hasDeadline == true) ? &deadline : nullptr, &wakeTime) == true)
+		{
+			s_done = true;
+		}
 
 		if (s_programMode == kProgramModeInteractive)
 		{
+			StatsTimer const timer(kStatsSubsystemShell);
+
 			Shell::Lock const lock;
-			Shell::InputWindow::Result const result{ Shell::InputWindow::ProcessSingleUserKey() };
-			done = (result == Shell::InputWindow::Result::kRequestToQuit);
 			Shell::CheckResize();
 		}
 
 		// Process command.
-		CommandProcess();
-
-		// Process controls.
-		ControlsProcess();
+		{
+			StatsTimer const timer(kStatsSubsystemCommand);
+			CommandProcess();
+		}
 
 		// Process the input.
-		s_input.Process();
+		{
+			StatsTimer const timer(kStatsSubsystemInput);
+			InputsProcess();
+		}
 
 		// Process MQTT.
-		MQTTProcess();
+		{
+			StatsTimer const timer(kStatsSubsystemMQTT);
+			MQTTProcess();
+		}
 
 		// Process the routines.
-		RoutinesProcess();
-
-		// Process the reports.
-		ReportsProcess();
-
-		if (s_programMode == kProgramModeDaemon)
 		{
-			// Process socket communication.
-			done = ProcessSocketCommunication();
+			StatsTimer const timer(kStatsSubsystemRoutines);
+			RoutinesProcess();
 		}
 
-		// Get the duration of the frame in nanoseconds.
-		Time frameEndTime;
-		TimerGetCurrent(frameEndTime);
-
-		float const frameDurationMS = TimerGetElapsedMilliseconds(frameStartTime, frameEndTime);
-		auto const frameDurationNS = static_cast<unsigned long>(frameDurationMS * 1.0e6f);
-
-		// If the frame is shorter than the duration corresponding to the desired framerate, sleep the
-		// difference off.
-		unsigned long const targetFrameDurationNS = 1'000'000'000ul / 60ul;
-
-		if (frameDurationNS < targetFrameDurationNS)
+		// Process controls. This happens after everything that might want to move them.
 		{
-			timespec sleepTime;
-			sleepTime.tv_sec = 0;
-			sleepTime.tv_nsec = targetFrameDurationNS - frameDurationNS;
+			StatsTimer const timer(kStatsSubsystemControls);
+			ControlsProcess();
+		}
 
-			timespec remainingTime;
-			nanosleep(&sleepTime, &remainingTime);
+		// Process the reports.
+		{
+			StatsTimer const timer(kStatsSubsystemReports);
+			ReportsProcess();
 		}
+
+		StatsRecord(kStatsSubsystemFrame, wakeTime, TimerClock::now());
 	}
 
 	Logger::WriteLine("Uninitializing.");
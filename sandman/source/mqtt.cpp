@@ -1,32 +1,86 @@
 #include "mqtt.h"
 
-#include <mutex>
-#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+#include <sys/epoll.h>
 
 #include <mosquitto.h> 
-#include "rapidjson/document.h"
+
+#include "common/slot_queue.h"
 
 #include "command.h"
+#include "intent.h"
 #include "logger.h"
+#include "reactor.h"
+#include "stats.h"
+#include "topic_router.h"
 
 #define DATADIR		AM_DATADIR
 
 // Constants
 //
 
+// How long to wait before reattempting the first notification.
+static constexpr std::chrono::seconds kFirstNotificationReattemptDuration{ 5 };
+
+// Used to detect when a file descriptor is invalid.
+static constexpr int kInvalidFileDescriptor{ -1 };
+
+// How often the client is given a chance to keep the connection alive when it runs in the main
+// loop. The keep alive is 60 seconds, so this leaves plenty of margin.
+static constexpr std::chrono::seconds kMaintenanceInterval{ 10 };
+
+// The port the MQTT host listens on.
+static constexpr int kPort{ 12183 };
+
+// How often the host expects to hear from us.
+static constexpr int kKeepAliveSeconds{ 60 };
+
+// How long to wait before trying to connect again. Each failure doubles the wait, up to the maximum.
+static constexpr std::chrono::seconds kMinReconnectDelay{ 1 };
+static constexpr std::chrono::seconds kMaxReconnectDelay{ 60 };
+
+// The most messages and notifications that are held while they can't be published. Once a list is
+// full, the oldest are dropped to make room, since they are the most out of date.
+static constexpr std::size_t kMaxPendingMessageCount{ 32u };
+static constexpr std::size_t kMaxPendingNotificationCount{ 4u };
+
+// The number of received messages that can be waiting for the main loop when the client runs on
+// its own thread. It must be a power of two.
+static constexpr std::size_t kReceivedMessageSlotCount{ 16u };
+
+// The longest topic and payload, including their terminators, that fit in a received message slot.
+// Intents carry plenty of recognizer output along with them, so the payload has room to spare.
+static constexpr std::size_t kReceivedTopicCapacity{ 256u };
+static constexpr std::size_t kReceivedPayloadCapacity{ 8192u };
+
 // Types
 //
 
-// A message that we received or need to send later.
+// A message that we need to send later.
 struct MessageInfo
 {
-	// The topic the message was or will be published to.
+	// The topic the message will be published to.
 	std::string	m_topic;
 
 	// The message payload.
 	std::string	m_payload;
 };
 
+// A message received on the client's thread, waiting for the main loop.
+struct ReceivedMessageSlot
+{
+	// The null terminated topic the message was published to.
+	char m_topic[kReceivedTopicCapacity];
+
+	// The null terminated message payload, which is read in place.
+	char m_payload[kReceivedPayloadCapacity];
+};
+
 // Locals
 //
 
@@ -34,7 +88,23 @@ struct MessageInfo
 static mosquitto* s_mosquittoClient = nullptr;
 
 // Track whether we are connected to the host.
-static bool s_connectedToHost = false;
+// It's written from the client's thread when that's enabled.
+static std::atomic<bool> s_connectedToHost{ false };
+
+// Whether the client runs on its own thread, rather than in the main loop.
+static bool s_threadEnabled = false;
+
+// The client's socket, while it is being watched in the main loop.
+static int s_socketFileDescriptor = kInvalidFileDescriptor;
+
+// The events the socket is currently being watched for.
+static std::uint32_t s_socketEvents = 0;
+
+// When the client should next be given a chance to keep the connection alive, or reconnect.
+static Time s_nextMaintenanceTime;
+
+// How long to wait after the next failure to connect in the main loop.
+static std::chrono::seconds s_reconnectDelay = kMinReconnectDelay;
 
 // Keep track of whether we have ever seen text-to-speech finish.
 static bool s_firstTextToSpeechFinished = false;
@@ -48,21 +118,38 @@ static std::vector<MessageInfo> s_pendingMessageList;
 // A list of notifications to post once we are able.
 static std::vector<std::string> s_pendingNotificationList;
 
-// We need to protect access to the list of received messages.
-static std::mutex s_receivedMessagesMutex;
+// The number of messages and notifications dropped since they were last reported.
+static unsigned int s_droppedPendingCount = 0u;
+
+// We use this to tell not only when we are attempting the first notification for the very first
+// time, but to prevent us from double posting the first notification after we succeed.
+static std::string s_firstNotification;
+
+// When we last attempted the first notification.
+static Time s_firstNotificationLastAttemptTime;
 
-// A list of messages we have received to process when we are able.
-static std::vector<MessageInfo> s_receivedMessageList;
+// Hands the messages received on the client's thread to the main loop. Messages that arrive while
+// every slot is waiting for the main loop are dropped and counted.
+static Common::SlotQueue<ReceivedMessageSlot, kReceivedMessageSlotCount> s_receivedMessageQueue;
+
+// The number of messages that were dropped because they didn't fit in a slot.
+static std::atomic<unsigned int> s_oversizedReceivedMessageCount{ 0u };
 
 // Keep track of the current dialogue manager session ID.
 static std::string s_dialogueManagerSessionID;
 
 // If we have command tokens awaiting confirmation, store them here.
-static std::vector<CommandToken> s_commandTokensPendingConfirmation;
+static CommandTokenList s_commandTokensPendingConfirmation;
+
+// Hands received messages to their handlers. It doesn't change once the client is started, so the
+// client's thread can use it too.
+static TopicRouter s_topicRouter;
 
 // Functions
 //
 
+static void MQTTRegisterTopicHandlers();
+
 // Subscribes to a topic.
 //
 // mosquittoClient:	The client instance.
@@ -103,10 +190,40 @@ void OnConnectCallback(mosquitto* mosquittoClient, void* /* userData */, int ret
 	s_connectedToHost = true;
 	Logger::WriteLine("Connected to MQTT host.");
 
-	// Subscribe to the relevant topics.
-	MQTTSubscribeTopic(mosquittoClient, "hermes/intent/#");
-	MQTTSubscribeTopic(mosquittoClient, "hermes/tts/#");
-	MQTTSubscribeTopic(mosquittoClient, "hermes/dialogueManager/#");
+	// Start backing off from scratch the next time the connection is lost.
+	if (s_threadEnabled == false)
+	{
+		s_reconnectDelay = kMinReconnectDelay;
+	}
+
+	// Anything waiting for the connection can now be published.
+	ReactorWake();
+
+	// Subscribe to exactly the topics that we handle.
+	for (auto const& pattern : s_topicRouter.GetPatterns())
+	{
+		MQTTSubscribeTopic(mosquittoClient, pattern.c_str());
+	}
+}
+
+// Handles the connection being closed, whether we asked for it or it was lost.
+//
+// mosquittoClient:	The client instance that disconnected.
+// userData:				The user data associated with the client instance.
+// returnCode:			Zero if we asked to disconnect, otherwise why the connection was lost.
+//
+void OnDisconnectCallback(mosquitto* /* mosquittoClient */, void* /* userData */, int returnCode)
+{
+	// Anything published from now on is held until the connection is made again.
+	auto const wasConnected = s_connectedToHost.exchange(false);
+
+	if ((wasConnected == true) && (returnCode != MOSQ_ERR_SUCCESS))
+	{
+		Logger::WriteLine(Shell::Yellow("Lost connection to MQTT host with return code ",
+												  returnCode, "."));
+	}
+
+	ReactorWake();
 }
 
 // Handles message for a subscribed topic.
@@ -118,53 +235,288 @@ void OnConnectCallback(mosquitto* mosquittoClient, void* /* userData */, int ret
 void OnMessageCallback(mosquitto* /* mosquittoClient */, void* /* userData */,
 							  mosquitto_message const* message)
 {
-	const auto* payloadString = reinterpret_cast<char*>(message->payload);
+	// Nothing we listen to is useful without a payload.
+	if (message->payload == nullptr)
+	{
+		return;
+	}
+
+	auto* const payloadString = static_cast<char*>(message->payload);
 
-	std::string const topic(message->topic);
+	std::string_view const topic(message->topic);
 
-	// Keep track of whether the first text-to-speech finished.
-	if (topic.find("hermes/tts/sayFinished") != std::string::npos)
+	// On the main loop, the message can be handled right away. The payload is ours to parse in
+	// place until we return.
+	if (s_threadEnabled == false)
 	{
-		s_firstTextToSpeechFinished = true;
+		s_topicRouter.Dispatch(topic, payloadString);
+		return;
+	}
 
-		// Record this time.
-		TimerGetCurrent(s_lastTextToSpeechFinishedTime);
+	// Otherwise, only save the messages that something will handle.
+	if (s_topicRouter.Matches(topic) == false)
+	{
+		return;
+	}
+
+	// Save the message to process later. This never waits on the main thread, so if it has fallen
+	// behind, the message is dropped and counted instead.
+	auto const payloadLength = static_cast<std::size_t>(message->payloadlen);
+
+	if ((topic.size() >= kReceivedTopicCapacity) || (payloadLength >= kReceivedPayloadCapacity))
+	{
+		s_oversizedReceivedMessageCount++;
+		ReactorWake();
+		return;
 	}
 
-	// Helper lambda to save a message to process later.
-	auto SaveMessage = [&]()
+	unsigned int slotIndex = 0u;
+	if (s_receivedMessageQueue.TryAcquire(slotIndex) == false)
 	{
-		// Acquire a lock to protect the received message list.
-		std::lock_guard<std::mutex> messageGuard(s_receivedMessagesMutex);
+		ReactorWake();
+		return;
+	}
+
+	auto& slot = s_receivedMessageQueue.GetSlot(slotIndex);
 
-		MessageInfo messageObject;
-		messageObject.m_topic = topic;
-		messageObject.m_payload = payloadString;
+	std::memcpy(slot.m_topic, topic.data(), topic.size());
+	slot.m_topic[topic.size()] = '\0';
 
-		s_receivedMessageList.push_back(messageObject);
-	};
+	std::memcpy(slot.m_payload, payloadString, payloadLength);
+	slot.m_payload[payloadLength] = '\0';
+
+	s_receivedMessageQueue.Queue(slotIndex);
+
+	// Let the main thread know there is something to process.
+	ReactorWake();
+}
 
-	// Only save certain messages to process later.
-	if (topic.find("hermes/dialogueManager/") != std::string::npos)
+// Watch for the socket becoming writable only while the client has something to write.
+//
+static void MQTTUpdateSocketEvents()
+{
+	if (s_socketFileDescriptor == kInvalidFileDescriptor)
 	{
-		SaveMessage();
 		return;
 	}
 
-	if (topic.find("hermes/intent/") != std::string::npos) 
+	std::uint32_t events = EPOLLIN;
+
+	if (mosquitto_want_write(s_mosquittoClient) == true)
+	{
+		events |= EPOLLOUT;
+	}
+
+	if (events == s_socketEvents)
 	{
-		SaveMessage();
 		return;
 	}
+
+	if (ReactorModifyFileDescriptor(s_socketFileDescriptor, events) == true)
+	{
+		s_socketEvents = events;
+	}
+}
+
+// Stop watching the client's socket. It belongs to the client, so it isn't closed here.
+//
+static void MQTTStopWatchingSocket()
+{
+	if (s_socketFileDescriptor == kInvalidFileDescriptor)
+	{
+		return;
+	}
+
+	ReactorRemoveFileDescriptor(s_socketFileDescriptor);
+	s_socketFileDescriptor = kInvalidFileDescriptor;
+	s_socketEvents = 0;
+}
+
+// Schedule another attempt to connect from the main loop, backing off after each failure.
+//
+static void MQTTScheduleReconnect()
+{
+	s_nextMaintenanceTime = TimerClock::now() + s_reconnectDelay;
+	s_reconnectDelay = std::min(s_reconnectDelay * 2, kMaxReconnectDelay);
+}
+
+// Handles the client losing its connection while it runs in the main loop.
+//
+// returnCode:	The return code that reported the loss.
+//
+static void MQTTHandleConnectionLost(int returnCode)
+{
+	MQTTStopWatchingSocket();
+
+	// The client may have already reported this through the disconnect callback.
+	if (s_connectedToHost.exchange(false) == true)
+	{
+		Logger::WriteLine(Shell::Yellow("Lost connection to MQTT host with return code ",
+												  returnCode, "."));
+	}
+
+	MQTTScheduleReconnect();
+}
+
+// Handles the client's socket being ready.
+//
+// events:	The epoll events that are ready.
+//
+static void MQTTHandleSocketEvents(std::uint32_t events)
+{
+	// Receiving is where messages are handled in this mode, so it counts as MQTT work.
+	StatsTimer const timer(kStatsSubsystemMQTT);
+
+	// The client only reads one packet at a time, but anything left over keeps the socket ready.
+	static constexpr int kMaxPacketCount{ 1 };
+
+	int returnCode = MOSQ_ERR_SUCCESS;
+
+	// Errors and hang ups are discovered by trying to read.
+	if ((events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0)
+	{
+		returnCode = mosquitto_loop_read(s_mosquittoClient, kMaxPacketCount);
+	}
+
+	if ((returnCode == MOSQ_ERR_SUCCESS) && ((events & EPOLLOUT) != 0))
+	{
+		returnCode = mosquitto_loop_write(s_mosquittoClient, kMaxPacketCount);
+	}
+
+	if (returnCode != MOSQ_ERR_SUCCESS)
+	{
+		MQTTHandleConnectionLost(returnCode);
+		return;
+	}
+
+	// Handling what was read may have queued more to write.
+	MQTTUpdateSocketEvents();
+}
+
+// Start watching the client's socket from the main loop.
+//
+// Returns:	True on success, false on failure.
+//
+static bool MQTTWatchSocket()
+{
+	auto const socketFileDescriptor = mosquitto_socket(s_mosquittoClient);
+
+	if (socketFileDescriptor == kInvalidFileDescriptor)
+	{
+		return false;
+	}
+
+	if (ReactorAddFileDescriptor(socketFileDescriptor, EPOLLIN, MQTTHandleSocketEvents) == false)
+	{
+		return false;
+	}
+
+	s_socketFileDescriptor = socketFileDescriptor;
+	s_socketEvents = EPOLLIN;
+	s_nextMaintenanceTime = TimerClock::now() + kMaintenanceInterval;
+
+	// The connection request may still be waiting to go out.
+	MQTTUpdateSocketEvents();
+	return true;
+}
+
+// Finish an attempt to connect from the main loop, by watching the socket if it was started or by
+// scheduling another attempt if it wasn't.
+//
+// returnCode:	The return code of the attempt.
+//
+static void MQTTFinishConnectAttempt(int returnCode)
+{
+	if ((returnCode == MOSQ_ERR_SUCCESS) && (MQTTWatchSocket() == true))
+	{
+		return;
+	}
+
+	MQTTScheduleReconnect();
+}
+
+// Give the client a chance to keep the connection alive, or to reconnect if it was lost, when it
+// runs in the main loop.
+//
+static void MQTTMaintainConnection()
+{
+	if (TimerClock::now() < s_nextMaintenanceTime)
+	{
+		return;
+	}
+
+	s_nextMaintenanceTime = TimerClock::now() + kMaintenanceInterval;
+
+	if (s_socketFileDescriptor != kInvalidFileDescriptor)
+	{
+		auto const returnCode = mosquitto_loop_misc(s_mosquittoClient);
+
+		if (returnCode != MOSQ_ERR_SUCCESS)
+		{
+			MQTTHandleConnectionLost(returnCode);
+			return;
+		}
+
+		// A keep alive may have been queued.
+		MQTTUpdateSocketEvents();
+		return;
+	}
+
+	// This doesn't wait for the connection to be made. The socket becomes writable once it is.
+	MQTTFinishConnectAttempt(mosquitto_reconnect_async(s_mosquittoClient));
+}
+
+// Make every received message slot free again. This must only be called while the client's thread
+// isn't running.
+//
+static void MQTTResetReceivedMessageSlots()
+{
+	s_receivedMessageQueue.Reset();
+	s_oversizedReceivedMessageCount = 0u;
+}
+
+// Process the messages received on the client's thread, handing each slot back once it's done.
+//
+static void MQTTProcessReceivedMessageSlots()
+{
+	unsigned int slotIndex = 0u;
+
+	while (s_receivedMessageQueue.TryTake(slotIndex) == true)
+	{
+		auto& slot = s_receivedMessageQueue.GetSlot(slotIndex);
+		s_topicRouter.Dispatch(slot.m_topic, slot.m_payload);
+
+		s_receivedMessageQueue.Release(slotIndex);
+	}
+
+	auto const droppedMessageCount = s_receivedMessageQueue.TakeDroppedCount();
+
+	if (droppedMessageCount > 0u)
+	{
+		Logger::WriteLine(Shell::Yellow("Dropped "), droppedMessageCount,
+								Shell::Yellow(" MQTT messages because too many were waiting."));
+	}
+
+	auto const oversizedMessageCount = s_oversizedReceivedMessageCount.exchange(0u);
+
+	if (oversizedMessageCount > 0u)
+	{
+		Logger::WriteLine(Shell::Yellow("Dropped "), oversizedMessageCount,
+								Shell::Yellow(" MQTT messages that were too large."));
+	}
 }
 
 // Initialize MQTT.
 //
-bool MQTTInitialize()
+// threadEnabled:	Whether the client runs on its own thread, rather than in the main loop.
+//
+bool MQTTInitialize(bool threadEnabled)
 {
 	Logger::WriteLine("Initializing MQTT support...");
 
+	s_threadEnabled = threadEnabled;
 	s_connectedToHost = false;
+	MQTTRegisterTopicHandlers();
 	s_firstTextToSpeechFinished = false;
 	s_dialogueManagerSessionID = "";
 	
@@ -200,63 +552,37 @@ bool MQTTInitialize()
 
 	// Set some necessary callbacks.
 	mosquitto_connect_callback_set(s_mosquittoClient, OnConnectCallback);
+	mosquitto_disconnect_callback_set(s_mosquittoClient, OnDisconnectCallback);
 	mosquitto_message_callback_set(s_mosquittoClient, OnMessageCallback);
 
-	Logger::WriteLine("Connecting to MQTT host...");
+	// The host may not be up yet, and nothing else should have to wait for it, so the connection
+	// is made in the background. Anything published before then is held until it is.
+	Logger::WriteLine("Connecting to MQTT host in the background.");
+	Logger::WriteLine();
+
+	s_reconnectDelay = kMinReconnectDelay;
 
-	// We are going to repeatedly attempt to connect roughly every second for a 
-	// certain period of time.
-	auto connected = false;
-	
-	Time connectStartTime;
-	TimerGetCurrent(connectStartTime);
-		
-	while (connected == false)
+	auto const returnCode = mosquitto_connect_async(s_mosquittoClient, "localhost", kPort,
+																	kKeepAliveSeconds);
+
+	if (s_threadEnabled == true)
 	{
-		static constexpr int kPort{ 12183 };
-		static constexpr int kKeepAliveSeconds{ 60 };
+		// The thread keeps trying to connect, even if the first attempt failed.
+		auto const exponentialBackoff = true;
+		mosquitto_reconnect_delay_set(s_mosquittoClient, kMinReconnectDelay.count(),
+												kMaxReconnectDelay.count(), exponentialBackoff);
 
-		const auto returnCode = mosquitto_connect(s_mosquittoClient, "localhost", 
-			kPort, kKeepAliveSeconds);
-		
-		if (returnCode == MOSQ_ERR_SUCCESS)
-		{		
-			connected = true;
-			break;
-		}
-	
-		// Figure out how long we have been attempting to connect.
-		Time connectCurrentTime;
-		TimerGetCurrent(connectCurrentTime);
-		
-		float const durationMS = TimerGetElapsedMilliseconds(connectStartTime, connectCurrentTime);
-		auto const durationSeconds = static_cast<unsigned long>(durationMS) / 1'000;
-		
-		// Attempt for five minutes at most.
-		static constexpr unsigned long kTimeoutDurationSeconds = 5 * 60;
-		
-		if (durationSeconds >= kTimeoutDurationSeconds)
-		{
-			break;
-		}
-		
-		// Sleep for one second.
-		sleep(1);
-	}
+		// Every slot starts out free.
+		MQTTResetReceivedMessageSlots();
 
-	if (connected == false) {
-		
-		Logger::WriteLine('\t', Shell::Red("failed"));
-		return false;
+		// Start processing in another thread.
+		mosquitto_loop_start(s_mosquittoClient);
+		return true;
 	}
-	
-	Logger::WriteLine('\t', Shell::Green("succeeded"));
-	Logger::WriteLine();
-
-	// Start processing in another thread.
-	mosquitto_loop_start(s_mosquittoClient);
 
-   return true;
+	// Otherwise, the main loop handles the client's socket and keeps trying to connect.
+	MQTTFinishConnectAttempt(returnCode);
+	return true;
 }
 
 // Uninitialize MQTT.
@@ -265,30 +591,49 @@ void MQTTUninitialize()
 {
 	if (s_mosquittoClient != nullptr)
 	{
-		// Stop any processing that may have been occurring in another thread.
-		const auto force = true;
-		mosquitto_loop_stop(s_mosquittoClient, force);
+		if (s_threadEnabled == true)
+		{
+			// Stop any processing that may have been occurring in another thread.
+			const auto force = true;
+			mosquitto_loop_stop(s_mosquittoClient, force);
+		}
+
+		MQTTStopWatchingSocket();
 
 		mosquitto_disconnect(s_mosquittoClient);
 		mosquitto_destroy(s_mosquittoClient);
+		s_mosquittoClient = nullptr;
 	}
 	
 	mosquitto_lib_cleanup();
 }
 
-// Publishes a message to a given topic.
+// Make room on a list of things waiting to be published, by dropping the oldest if it's full.
 //
-// topic:		The topic to publish to.
-// message:	The message to be published.
+// list:		(Input/Output) The list.
+// maxCount:	The most the list may hold.
 //
-static void MQTTPublishMessage(char const* topic, char const* message)
+template <typename ElementType>
+static void MQTTMakeRoomForPending(std::vector<ElementType>& list, std::size_t maxCount)
 {
-	if (topic == nullptr)
+	if (list.size() < maxCount)
 	{
 		return;
 	}
 
-	if (message == nullptr)
+	auto const dropCount = list.size() - maxCount + 1u;
+	list.erase(list.begin(), list.begin() + dropCount);
+	s_droppedPendingCount += static_cast<unsigned int>(dropCount);
+}
+
+// Publishes a message to a given topic.
+//
+// topic:		The topic to publish to.
+// message:	The message to be published.
+//
+static void MQTTPublishMessage(char const* topic, std::string_view message)
+{
+	if (topic == nullptr)
 	{
 		return;
 	}
@@ -300,18 +645,16 @@ static void MQTTPublishMessage(char const* topic, char const* message)
 		pendingMessage.m_topic = topic;
 		pendingMessage.m_payload = message;
 
-		s_pendingMessageList.push_back(pendingMessage);
+		MQTTMakeRoomForPending(s_pendingMessageList, kMaxPendingMessageCount);
+		s_pendingMessageList.push_back(std::move(pendingMessage));
 		return;
 	}
 
-	// I thought that we needed to count the terminator here, but it actually doesn't work if we do. 
-	// Go figure.
-	auto const messageLength = std::strlen(message);
-
+	// The client copies the payload into its own packet, so it can be handed over as it is.
 	int const qualityOfService = 0;
 	bool const retain = false;
-	auto returnCode = mosquitto_publish(s_mosquittoClient, nullptr, topic, messageLength,
-		message, qualityOfService, retain);
+	auto returnCode = mosquitto_publish(s_mosquittoClient, nullptr, topic,
+		static_cast<int>(message.size()), message.data(), qualityOfService, retain);
 
 	if (returnCode != MOSQ_ERR_SUCCESS)
 	{
@@ -322,6 +665,9 @@ static void MQTTPublishMessage(char const* topic, char const* message)
 	{
 		//LoggerAddMessage("Published message to MQTT topic \"%s\": %s", p_topic, p_message);
 		Logger::WriteLine("Published message to MQTT topic \"", topic, "\"");
+
+		// Whatever couldn't be written right away has to wait for the socket.
+		MQTTUpdateSocketEvents();
 	}
 }
 
@@ -330,93 +676,26 @@ static void MQTTPublishMessage(char const* topic, char const* message)
 static void DialogueManagerEndSession()
 {
 	// Create a properly formatted message that will end the session.
-	static constexpr std::size_t kMessageBufferCapacity{ 500u };
-	char messageBuffer[kMessageBufferCapacity];
-
-	std::snprintf(messageBuffer, kMessageBufferCapacity, "{\"sessionId\": \"%s\", \"text\": \"\"}", 
-		s_dialogueManagerSessionID.c_str());
+	auto const message = IntentWriteSessionPayload(s_dialogueManagerSessionID, "");
 
 	// Actually publish to the topic.
 	char const* topic = "hermes/dialogueManager/endSession";
-	MQTTPublishMessage(topic, messageBuffer);
-}
-
-// Handles processing a dialogue manager message.
-//
-// topic:					The topic of the message.
-// messageDocument:	The JSON document for the message payload.
-// 
-static void ProcessDialogueManagerMessage(std::string const& topic, 
-	rapidjson::Document const& messageDocument)
-{
-	// Technically we probably don't need to be able to access the session ID for all cases here, 
-	// but it's reasonable to expect and the code is cleanest this way.
-	auto const sessionIDIterator = messageDocument.FindMember("sessionId");
-
-	if (sessionIDIterator == messageDocument.MemberEnd())
-	{
-		return;
-	}
-		
-	auto const sessionID = sessionIDIterator->value.GetString();
-	
-	if (topic.find("sessionStarted") != std::string::npos)
-	{
-		Logger::WriteLine("Dialogue session started with ID: ", sessionID);
-		s_dialogueManagerSessionID = sessionID;
-		return;
-	}
-
-	if (topic.find("sessionEnded") != std::string::npos)
-	{
-		auto GetReason = [&]() -> char const*
-		{
-			auto const terminationIterator = messageDocument.FindMember("termination");
-
-			if (terminationIterator == messageDocument.MemberEnd())
-			{
-				return nullptr;
-			}
-
-			auto const reasonIterator = terminationIterator->value.FindMember("reason");
-
-			if (reasonIterator == messageDocument.MemberEnd())
-			{
-				return nullptr;
-			}
-
-			return reasonIterator->value.GetString();
-		};
-
-		auto const reason = GetReason();
-
-		if (reason != nullptr)
-		{
-			Logger::WriteLine("Dialogue session ended with ID: ", sessionID, " and reason: ", reason);
-		}
-		else
-		{
-			Logger::WriteLine("Dialogue session ended with ID: ", sessionID);
-		}	
-	
-		s_dialogueManagerSessionID = "";
-		return;
-	}
+	MQTTPublishMessage(topic, message);
 }
 
 // Handles processing an intent message.
 //
-// intentDocument:	The JSON document for the intent payload.
+// intent:	The fields read from the intent payload.
 //
-static void ProcessIntentMessage(rapidjson::Document const& intentDocument)
+static void ProcessIntentMessage(IntentMessage const& intent)
 {
 	// Take into account tokens pending confirmation, but only once.
 	auto commandTokens = s_commandTokensPendingConfirmation;
-	s_commandTokensPendingConfirmation.clear();
+	s_commandTokensPendingConfirmation.Clear();
 
-	CommandTokenizeJSONDocument(commandTokens, intentDocument);
+	CommandTokenizeIntent(commandTokens, intent);
 
-	if (commandTokens.empty() == true)
+	if (commandTokens.IsEmpty() == true)
 	{
 		DialogueManagerEndSession();
 		return;
@@ -441,47 +720,111 @@ static void ProcessIntentMessage(rapidjson::Document const& intentDocument)
 	s_commandTokensPendingConfirmation = commandTokens;
 	
 	// Create a properly formatted message that will trigger the confirmation.
-	static constexpr std::size_t kMessageBufferCapacity{ 500u };
-	char messageBuffer[kMessageBufferCapacity];
-
-	snprintf(messageBuffer, kMessageBufferCapacity, "{\"sessionId\": \"%s\", \"text\": \"%s\"}", 
-		s_dialogueManagerSessionID.c_str(), confirmationText);
+	auto const message = IntentWriteSessionPayload(s_dialogueManagerSessionID,
+		(confirmationText != nullptr) ? confirmationText : "");
 
 	// Actually publish to the topic.
 	char const* topic = "hermes/dialogueManager/continueSession";
-	MQTTPublishMessage(topic, messageBuffer);
+	MQTTPublishMessage(topic, message);
 }
 
-// Process is a message that we have received.
+// Handles text-to-speech finishing.
 //
-// message:	The message we have received.
+// topic:		The topic of the message.
+// payload:	(Input/Output) The message payload.
 //
-static void MQTTProcessReceivedMessage(MessageInfo const& message)
+static void MQTTHandleTextToSpeechFinished(std::string_view /* topic */, char* /* payload */)
 {
-	// Parse the payload as JSON.
-	rapidjson::Document payloadDocument;
-	payloadDocument.Parse(message.m_payload.c_str());
+	s_firstTextToSpeechFinished = true;
+
+	// Record this time.
+	s_lastTextToSpeechFinishedTime = TimerClock::now();
+}
 
-	if (payloadDocument.HasParseError() == true)
+// Handles a dialogue manager session starting.
+//
+// topic:		The topic of the message.
+// payload:	(Input/Output) The message payload. It is read in place.
+//
+static void MQTTHandleSessionStarted(std::string_view /* topic */, char* payload)
+{
+	IntentMessage message;
+	if (IntentReadFromPayload(message, payload, kIntentFieldSessionID) == false)
 	{
 		return;
 	}
 
-	auto const& topic = message.m_topic;
-	
-	if (topic.find("hermes/dialogueManager/") != std::string::npos)
+	if (message.m_sessionID.empty() == true)
+	{
+		return;
+	}
+
+	Logger::WriteLine("Dialogue session started with ID: ", message.m_sessionID);
+	s_dialogueManagerSessionID = message.m_sessionID;
+}
+
+// Handles a dialogue manager session ending.
+//
+// topic:		The topic of the message.
+// payload:	(Input/Output) The message payload. It is read in place.
+//
+static void MQTTHandleSessionEnded(std::string_view /* topic */, char* payload)
+{
+	IntentMessage message;
+	if (IntentReadFromPayload(message, payload,
+									  kIntentFieldSessionID | kIntentFieldTermination) == false)
+	{
+		return;
+	}
+
+	if (message.m_sessionID.empty() == true)
 	{
-		ProcessDialogueManagerMessage(topic, payloadDocument);
 		return;
 	}
 
-	if (topic.find("hermes/intent/") != std::string::npos) 
+	auto const& reason = message.m_terminationReason;
+
+	if (reason.empty() == false)
+	{
+		Logger::WriteLine("Dialogue session ended with ID: ", message.m_sessionID, " and reason: ",
+								reason);
+	}
+	else
 	{
-		Logger::WriteLine("Received MQTT message for topic \"", message.m_topic, "\"");
+		Logger::WriteLine("Dialogue session ended with ID: ", message.m_sessionID);
+	}	
 
-		ProcessIntentMessage(payloadDocument);
+	s_dialogueManagerSessionID = "";
+}
+
+// Handles an intent being recognized.
+//
+// topic:		The topic of the message.
+// payload:	(Input/Output) The message payload. It is read in place.
+//
+static void MQTTHandleIntent(std::string_view topic, char* payload)
+{
+	// Only read what's needed to carry out the intent. Recognizers add plenty more after it.
+	IntentMessage intent;
+	if (IntentReadFromPayload(intent, payload, kIntentFieldIntentName | kIntentFieldSlots) == false)
+	{
 		return;
 	}
+
+	Logger::WriteLine("Received MQTT message for topic \"", topic, "\"");
+
+	ProcessIntentMessage(intent);
+}
+
+// Register the handlers for the topics we listen to. These are also the topics we subscribe to.
+//
+static void MQTTRegisterTopicHandlers()
+{
+	s_topicRouter.Clear();
+	s_topicRouter.Add("hermes/tts/sayFinished", MQTTHandleTextToSpeechFinished);
+	s_topicRouter.Add("hermes/dialogueManager/sessionStarted", MQTTHandleSessionStarted);
+	s_topicRouter.Add("hermes/dialogueManager/sessionEnded", MQTTHandleSessionEnded);
+	s_topicRouter.Add("hermes/intent/#", MQTTHandleIntent);
 }
 
 // Generates and publishes a message that causes a spoken notification.
@@ -491,42 +834,39 @@ static void MQTTProcessReceivedMessage(MessageInfo const& message)
 static void MQTTPublishNotification(std::string const& text)
 {
 	// Create a properly formatted message that will trigger the notification.
-	static constexpr std::size_t kMessageBufferCapacity{ 500u };
-	char messageBuffer[kMessageBufferCapacity];
-
-	snprintf(messageBuffer, kMessageBufferCapacity, 
-		"{\"init\": {\"type\": \"notification\", \"text\": \"%s\"}, \"siteId\": \"default\"}",
-		text.c_str());
+	auto const message = IntentWriteNotificationPayload(text);
 
 	// Actually publish to the topic.
 	char const* topic = "hermes/dialogueManager/startSession";
-	MQTTPublishMessage(topic, messageBuffer);
+	MQTTPublishMessage(topic, message);
 }
 
 // Process MQTT.
 //
 void MQTTProcess()
 {
+	if (s_threadEnabled == true)
 	{
-		// Acquire a lock to protect the received message list.
-		// NOTE: It is expected that this will be executed from the main thread.
-		std::lock_guard<std::mutex> messageGuard(s_receivedMessagesMutex);
-
-		for (auto const& message : s_receivedMessageList)		
-		{
-			MQTTProcessReceivedMessage(message);
-		}
-
-		// Get rid of the messages.
-		s_receivedMessageList.clear();
+		MQTTProcessReceivedMessageSlots();
+	}
+	else if (s_mosquittoClient != nullptr)
+	{
+		MQTTMaintainConnection();
 	}
 
 	// If we are connected, send any pending messages.
 	if (s_connectedToHost == true) {
 
+		if (s_droppedPendingCount > 0u)
+		{
+			Logger::WriteLine(Shell::Yellow("Dropped "), s_droppedPendingCount,
+									Shell::Yellow(" MQTT messages and notifications that waited too long."));
+			s_droppedPendingCount = 0u;
+		}
+
 		for (auto const& pendingMessage : s_pendingMessageList)
 		{
-			MQTTPublishMessage(pendingMessage.m_topic.c_str(), pendingMessage.m_payload.c_str());
+			MQTTPublishMessage(pendingMessage.m_topic.c_str(), pendingMessage.m_payload);
 		}
 
 		// Get rid of the pending messages.
@@ -545,13 +885,6 @@ void MQTTProcess()
 		}
 		else
 		{
-			// We use this to tell not only when we are attempting the first notification for the very 
-			// first time, but to prevent us from double posting the first notification after we 
-			//succeed.
-			static std::string s_firstNotification = "";
-
-			static Time s_lastAttemptTime;
-
 			if ((s_firstNotification.compare("") == 0) && (s_pendingNotificationList.size() > 0))
 			{
 				// Pull the first notification off and store it separately.
@@ -560,26 +893,20 @@ void MQTTProcess()
 
 				// Make our first attempt.
 				MQTTPublishNotification(s_firstNotification);
-				TimerGetCurrent(s_lastAttemptTime);
+				s_firstNotificationLastAttemptTime = TimerClock::now();
 
 				Logger::WriteLine("Attempted first notification.");
 			}
 
 			// See if enough time has passed since our last attempt.
-			Time currentTime;
-			TimerGetCurrent(currentTime);
-
-			auto const durationMS = TimerGetElapsedMilliseconds(s_lastAttemptTime, currentTime);
-			auto const durationSeconds = static_cast<unsigned long>(durationMS) / 1'000;
-
-			static constexpr unsigned long kReattemptTimeSeconds = 5;
+			auto const reattemptTime = s_firstNotificationLastAttemptTime +
+				kFirstNotificationReattemptDuration;
 
-			if ((s_firstNotification.compare("") != 0) && 
-				(durationSeconds >= kReattemptTimeSeconds))
+			if ((s_firstNotification.compare("") != 0) && (TimerClock::now() >= reattemptTime))
 			{
 				// If so, reattempt the notification.
 				MQTTPublishNotification(s_firstNotification);
-				TimerGetCurrent(s_lastAttemptTime);
+				s_firstNotificationLastAttemptTime = TimerClock::now();
 
 				Logger::WriteLine("Reattempted first notification.");
 			}
@@ -587,6 +914,80 @@ void MQTTProcess()
 	}
 }
 
+// Get the next time that messages need to be processed, if any.
+//
+// deadline:	(Output) The time by which messages need to be processed.
+//
+// Returns:	True if messages need to be processed again, false otherwise.
+//
+static bool MQTTGetNextMessageDeadline(Time& deadline)
+{
+	// Received messages don't need a deadline, because each one wakes us up and they are all
+	// processed together.
+
+	// Nothing can be published until we connect, which will wake us up.
+	if (s_connectedToHost == false)
+	{
+		return false;
+	}
+
+	if (s_pendingMessageList.empty() == false)
+	{
+		deadline = TimerClock::now();
+		return true;
+	}
+
+	if (s_firstTextToSpeechFinished == true)
+	{
+		if (s_pendingNotificationList.empty() == true)
+		{
+			return false;
+		}
+
+		deadline = TimerClock::now();
+		return true;
+	}
+
+	// Until text-to-speech is known to work, notifications are held back behind the first one.
+	if (s_firstNotification.compare("") == 0)
+	{
+		if (s_pendingNotificationList.empty() == true)
+		{
+			return false;
+		}
+
+		deadline = TimerClock::now();
+		return true;
+	}
+
+	deadline = s_firstNotificationLastAttemptTime + kFirstNotificationReattemptDuration;
+	return true;
+}
+
+// Get the next time that MQTT needs to be processed, if any.
+//
+// deadline:	(Output) The time by which MQTT needs to be processed.
+//
+// Returns:	True if MQTT needs to be processed again, false otherwise.
+//
+bool MQTTGetNextDeadline(Time& deadline)
+{
+	auto const hasMessageDeadline = MQTTGetNextMessageDeadline(deadline);
+
+	// The client on its own thread, or no client at all, doesn't need anything else.
+	if ((s_threadEnabled == true) || (s_mosquittoClient == nullptr))
+	{
+		return hasMessageDeadline;
+	}
+
+	if ((hasMessageDeadline == false) || (s_nextMaintenanceTime < deadline))
+	{
+		deadline = s_nextMaintenanceTime;
+	}
+
+	return true;
+}
+
 // Generates and publishes a message to cause the provided text to be spoken.
 //
 // text:	The text that should be spoken.
@@ -594,16 +995,11 @@ void MQTTProcess()
 void MQTTTextToSpeech(std::string const& text)
 {
 	// Create a properly formatted message that will trigger the text to be spoken.
-	static constexpr std::size_t kMessageBufferCapacity{ 500u };
-	char messageBuffer[kMessageBufferCapacity];
-
-	snprintf(messageBuffer, kMessageBufferCapacity, 
-		"{\"text\": \"%s\", \"siteId\": \"default\", \"lang\": null, \"id\": \"\", "
-		"\"sessionId\": \"\", \"volume\": 1.0}", text.c_str());
+	auto const message = IntentWriteTextToSpeechPayload(text);
 
 	// Actually publish to the topic.
 	char const* topic = "hermes/tts/say";
-	MQTTPublishMessage(topic, messageBuffer);
+	MQTTPublishMessage(topic, message);
 }
 
 // Causes a spoken notification.
@@ -612,6 +1008,7 @@ void MQTTTextToSpeech(std::string const& text)
 //
 void MQTTNotification(std::string const& text)
 {
+	MQTTMakeRoomForPending(s_pendingNotificationList, kMaxPendingNotificationCount);
 	s_pendingNotificationList.push_back(text);
 }
 
@@ -9,7 +9,9 @@
 
 // Initialize MQTT.
 //
-bool MQTTInitialize();
+// threadEnabled:	Whether the client runs on its own thread, rather than in the main loop.
+//
+bool MQTTInitialize(bool threadEnabled);
 
 // Uninitialize MQTT.
 //
@@ -19,6 +21,14 @@ void MQTTUninitialize();
 //
 void MQTTProcess();
 
+// Get the next time that MQTT needs to be processed, if any.
+//
+// deadline:	(Output) The time by which MQTT needs to be processed.
+//
+// Returns:	True if MQTT needs to be processed again, false otherwise.
+//
+bool MQTTGetNextDeadline(Time& deadline);
+
 // Generates and publishes a message to cause the provided text to be spoken.
 //
 // text:	The text that should be spoken.
@@ -0,0 +1,358 @@
+#include "reactor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <map>
+
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+// Constants
+//
+
+// Used to detect when a file descriptor is invalid.
+static constexpr int kInvalidFileDescriptor{ -1 };
+
+// The maximum number of ready file descriptors to handle per wait.
+static constexpr int kMaxReadyEventCount{ 16 };
+
+// Locals
+//
+
+// The epoll instance that everything is watched through.
+static int s_epollFileDescriptor = kInvalidFileDescriptor;
+
+// An event file descriptor used to wake up a wait from another thread.
+static int s_wakeFileDescriptor = kInvalidFileDescriptor;
+
+// A timer file descriptor used to end a wait at a deadline.
+static int s_timerFileDescriptor = kInvalidFileDescriptor;
+
+// A signal file descriptor used to receive termination signals.
+static int s_signalFileDescriptor = kInvalidFileDescriptor;
+
+// The signal mask prior to initialization, so that it can be restored.
+static sigset_t s_previousSignalMask;
+
+// Whether a termination signal has been received.
+static bool s_terminationRequested = false;
+
+// A mapping of watched file descriptors to their handlers.
+static std::map<int, ReactorHandler> s_fileDescriptorToHandlerMap;
+
+// Functions
+//
+
+// Read and discard whatever is available from a file descriptor which signals by being readable.
+//
+// fileDescriptor:	The file descriptor to drain.
+//
+static void ReactorDrainCounter(int fileDescriptor)
+{
+	// Both event and timer file descriptors are read as a single 8 byte counter.
+	std::uint64_t counter = 0;
+	while (read(fileDescriptor, &counter, sizeof(counter)) > 0)
+	{
+	}
+}
+
+// Handle the signal file descriptor being ready.
+//
+static void ReactorHandleSignal()
+{
+	signalfd_siginfo signalInfo;
+	while (read(s_signalFileDescriptor, &signalInfo, sizeof(signalInfo)) == sizeof(signalInfo))
+	{
+		Logger::WriteLine("Received signal \"", strsignal(signalInfo.ssi_signo), "\".");
+		s_terminationRequested = true;
+	}
+}
+
+// Close a file descriptor, if it is valid.
+//
+// fileDescriptor:	(Input/Output) The file descriptor to close. It will be invalid afterward.
+//
+static void ReactorCloseFileDescriptor(int& fileDescriptor)
+{
+	if (fileDescriptor == kInvalidFileDescriptor)
+	{
+		return;
+	}
+
+	close(fileDescriptor);
+	fileDescriptor = kInvalidFileDescriptor;
+}
+
+// Initialize the reactor. This also blocks the termination signals so that they are delivered
+// through the reactor instead, so it should be called before any other threads are started.
+//
+// Returns:	True on success, false on failure.
+//
+bool ReactorInitialize()
+{
+	Logger::WriteLine("Initializing the reactor...");
+
+	s_terminationRequested = false;
+
+	s_epollFileDescriptor = epoll_create1(EPOLL_CLOEXEC);
+
+	if (s_epollFileDescriptor < 0)
+	{
+		Logger::WriteLine('\t', Shell::Red("failed to create epoll instance"));
+		return false;
+	}
+
+	s_wakeFileDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if (s_wakeFileDescriptor < 0)
+	{
+		Logger::WriteLine('\t', Shell::Red("failed to create wake event"));
+		return false;
+	}
+
+	// The timer clock reads from the steady clock, which is the monotonic clock.
+	s_timerFileDescriptor = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+	if (s_timerFileDescriptor < 0)
+	{
+		Logger::WriteLine('\t', Shell::Red("failed to create timer"));
+		return false;
+	}
+
+	// Block the termination signals so that we can receive them as events and shut down cleanly.
+	sigset_t signalMask;
+	sigemptyset(&signalMask);
+	sigaddset(&signalMask, SIGINT);
+	sigaddset(&signalMask, SIGTERM);
+
+	if (pthread_sigmask(SIG_BLOCK, &signalMask, &s_previousSignalMask) != 0)
+	{
+		Logger::WriteLine('\t', Shell::Red("failed to block termination signals"));
+		return false;
+	}
+
+	s_signalFileDescriptor = signalfd(kInvalidFileDescriptor, &signalMask,
+												 SFD_NONBLOCK | SFD_CLOEXEC);
+
+	if (s_signalFileDescriptor < 0)
+	{
+		Logger::WriteLine('\t', Shell::Red("failed to create signal file descriptor"));
+		return false;
+	}
+
+	auto const succeeded =
+		ReactorAddFileDescriptor(s_wakeFileDescriptor, EPOLLIN,
+			[](std::uint32_t /* events */) { ReactorDrainCounter(s_wakeFileDescriptor); }) &&
+		ReactorAddFileDescriptor(s_timerFileDescriptor, EPOLLIN,
+			[](std::uint32_t /* events */) { ReactorDrainCounter(s_timerFileDescriptor); }) &&
+		ReactorAddFileDescriptor(s_signalFileDescriptor, EPOLLIN,
+			[](std::uint32_t /* events */) { ReactorHandleSignal(); });
+
+	if (succeeded == false)
+	{
+		Logger::WriteLine('\t', Shell::Red("failed"));
+		return false;
+	}
+
+	Logger::WriteLine('\t', Shell::Green("succeeded"));
+	Logger::WriteLine();
+	return true;
+}
+
+// Uninitialize the reactor.
+//
+void ReactorUninitialize()
+{
+	s_fileDescriptorToHandlerMap.clear();
+
+	ReactorCloseFileDescriptor(s_signalFileDescriptor);
+	ReactorCloseFileDescriptor(s_timerFileDescriptor);
+	ReactorCloseFileDescriptor(s_wakeFileDescriptor);
+
+	if (s_epollFileDescriptor != kInvalidFileDescriptor)
+	{
+		ReactorCloseFileDescriptor(s_epollFileDescriptor);
+
+		// Restore the signal mask that was in place before we were initialized.
+		pthread_sigmask(SIG_SETMASK, &s_previousSignalMask, nullptr);
+	}
+}
+
+// Start watching a file descriptor.
+//
+// fileDescriptor:	The file descriptor to watch.
+// events:				The epoll events to watch for.
+// handler:				Called whenever the file descriptor is ready.
+//
+// Returns:	True on success, false on failure.
+//
+bool ReactorAddFileDescriptor(int fileDescriptor, std::uint32_t events,
+										ReactorHandler const& handler)
+{
+	if (s_epollFileDescriptor == kInvalidFileDescriptor)
+	{
+		return false;
+	}
+
+	epoll_event event = {};
+	event.events = events;
+	event.data.fd = fileDescriptor;
+
+	if (epoll_ctl(s_epollFileDescriptor, EPOLL_CTL_ADD, fileDescriptor, &event) < 0)
+	{
+		Logger::WriteLine(Shell::Red("Failed to watch file descriptor "), fileDescriptor,
+								Shell::Red(": "), std::strerror(errno));
+		return false;
+	}
+
+	s_fileDescriptorToHandlerMap[fileDescriptor] = handler;
+	return true;
+}
+
+// Change the events that a file descriptor is being watched for.
+//
+// fileDescriptor:	The file descriptor being watched.
+// events:				The epoll events to watch for.
+//
+// Returns:	True on success, false on failure.
+//
+bool ReactorModifyFileDescriptor(int fileDescriptor, std::uint32_t events)
+{
+	if (s_epollFileDescriptor == kInvalidFileDescriptor)
+	{
+		return false;
+	}
+
+	epoll_event event = {};
+	event.events = events;
+	event.data.fd = fileDescriptor;
+
+	return (epoll_ctl(s_epollFileDescriptor, EPOLL_CTL_MOD, fileDescriptor, &event) == 0);
+}
+
+// Stop watching a file descriptor. This should be done before it is closed.
+//
+// fileDescriptor:	The file descriptor to stop watching.
+//
+void ReactorRemoveFileDescriptor(int fileDescriptor)
+{
+	if (s_epollFileDescriptor == kInvalidFileDescriptor)
+	{
+		return;
+	}
+
+	epoll_ctl(s_epollFileDescriptor, EPOLL_CTL_DEL, fileDescriptor, nullptr);
+	s_fileDescriptorToHandlerMap.erase(fileDescriptor);
+}
+
+// Cause the current or next wait to return early. This is safe to call from any thread.
+//
+void ReactorWake()
+{
+	if (s_wakeFileDescriptor == kInvalidFileDescriptor)
+	{
+		return;
+	}
+
+	std::uint64_t const increment = 1;
+	[[maybe_unused]] auto const writeCount = write(s_wakeFileDescriptor, &increment,
+																  sizeof(increment));
+}
+
+// Block until a watched file descriptor is ready, the deadline passes, or a wake is requested,
+// then call the handlers for anything that is ready.
+//
+// deadline:	(Optional) The time by which to return, even if nothing else happens.
+// wakeTime:	(Optional, Output) When the wait ended, before any of the handlers were called.
+//
+// Returns:	True if a termination signal has been received, false otherwise.
+//
+bool ReactorWait(Time const* deadline, Time* wakeTime)
+{
+	if (s_epollFileDescriptor == kInvalidFileDescriptor)
+	{
+		if (wakeTime != nullptr)
+		{
+			*wakeTime = TimerClock::now();
+		}
+
+		return true;
+	}
+
+	// Arm the timer for the deadline, or disarm it if there isn't one.
+	itimerspec timerValue = {};
+	int timerFlags = TFD_TIMER_ABSTIME;
+
+	if (deadline != nullptr)
+	{
+		auto timerDuration = deadline->time_since_epoch();
+
+		// A simulated deadline doesn't correspond to the monotonic clock, so only the time
+		// remaining until it means anything.
+		if (TimerGetClockSource() == kTimerClockSourceSimulated)
+		{
+			timerDuration = std::max(*deadline - TimerClock::now(), TimerClock::duration::zero());
+			timerFlags = 0;
+		}
+
+		auto const timerSeconds = std::chrono::duration_cast<std::chrono::seconds>(timerDuration);
+
+		timerValue.it_value.tv_sec = timerSeconds.count();
+		timerValue.it_value.tv_nsec = (timerDuration - timerSeconds).count();
+
+		// A zero value would disarm the timer instead, so nudge it. It's in the past either way.
+		if ((timerValue.it_value.tv_sec == 0) && (timerValue.it_value.tv_nsec == 0))
+		{
+			timerValue.it_value.tv_nsec = 1;
+		}
+	}
+
+	timerfd_settime(s_timerFileDescriptor, timerFlags, &timerValue, nullptr);
+
+	epoll_event readyEvents[kMaxReadyEventCount];
+	auto const readyEventCount = epoll_wait(s_epollFileDescriptor, readyEvents,
+														 kMaxReadyEventCount, -1);
+
+	if (wakeTime != nullptr)
+	{
+		*wakeTime = TimerClock::now();
+	}
+
+	// Interrupted by a signal handler (window resizes, for example), which is fine.
+	if (readyEventCount < 0)
+	{
+		if (errno != EINTR)
+		{
+			Logger::WriteLine(Shell::Red("Failed to wait for events: "), std::strerror(errno));
+		}
+
+		return s_terminationRequested;
+	}
+
+	for (int eventIndex = 0; eventIndex < readyEventCount; eventIndex++)
+	{
+		auto const& readyEvent = readyEvents[eventIndex];
+
+		// An earlier handler may have stopped watching this one.
+		auto const handlerIterator = s_fileDescriptorToHandlerMap.find(readyEvent.data.fd);
+
+		if (handlerIterator == s_fileDescriptorToHandlerMap.end())
+		{
+			continue;
+		}
+
+		// Copy the handler, because it's allowed to stop watching its own file descriptor.
+		auto const handler = handlerIterator->second;
+		handler(readyEvent.events);
+	}
+
+	return s_terminationRequested;
+}
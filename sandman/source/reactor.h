@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "timer.h"
+
+// Types
+//
+
+// Called when a file descriptor registered with the reactor is ready.
+//
+// events:	The epoll events that are ready.
+//
+using ReactorHandler = std::function<void(std::uint32_t events)>;
+
+// Functions
+//
+
+// Initialize the reactor. This also blocks the termination signals so that they are delivered
+// through the reactor instead, so it should be called before any other threads are started.
+//
+// Returns:	True on success, false on failure.
+//
+bool ReactorInitialize();
+
+// Uninitialize the reactor.
+//
+void ReactorUninitialize();
+
+// Start watching a file descriptor.
+//
+// fileDescriptor:	The file descriptor to watch.
+// events:				The epoll events to watch for.
+// handler:				Called whenever the file descriptor is ready.
+//
+// Returns:	True on success, false on failure.
+//
+bool ReactorAddFileDescriptor(int fileDescriptor, std::uint32_t events,
+										ReactorHandler const& handler);
+
+// Change the events that a file descriptor is being watched for.
+//
+// fileDescriptor:	The file descriptor being watched.
+// events:				The epoll events to watch for.
+//
+// Returns:	True on success, false on failure.
+//
+bool ReactorModifyFileDescriptor(int fileDescriptor, std::uint32_t events);
+
+// Stop watching a file descriptor. This should be done before it is closed.
+//
+// fileDescriptor:	The file descriptor to stop watching.
+//
+void ReactorRemoveFileDescriptor(int fileDescriptor);
+
+// Cause the current or next wait to return early. This is safe to call from any thread.
+//
+void ReactorWake();
+
+// Block until a watched file descriptor is ready, the deadline passes, or a wake is requested,
+// then call the handlers for anything that is ready.
+//
+// deadline:	(Optional) The time by which to return, even if nothing else happens.
+// wakeTime:	(Optional, Output) When the wait ended, before any of the handlers were called.
+//
+// Returns:	True if a termination signal has been received, false otherwise.
+//
+bool ReactorWait(Time const* deadline, Time* wakeTime);
@@ -11,11 +11,13 @@
 #include "rapidjson/writer.h"
 
 #include "logger.h"
+#include "timer.h"
 
-#define REPORT_VERSION	3
+#define REPORT_VERSION	4
 //	1					Initial version.
 // 2	2023/08/29	Adding the report start time to the header, for use when analyzing the data.
 // 3	2024/02/04	Adding support for schedule items and distinguishing the source of movement items.
+// 4	2026/10/16	Adding latency items, when they're enabled.
 
 // Eventually this should be configurable.
 #define REPORT_STARTING_HOUR	17
@@ -68,7 +70,7 @@ static constexpr std::array kControlActionNames =
 static std::string ReportsGetEffectiveDate()
 {
 	// Get the current time.
-	auto const rawTime = time(nullptr);
+	auto const rawTime = TimerGetCurrentCalendarTime();
 	auto* localTime = localtime(&rawTime);
 
 	// If the time is after the starting hour, advance the day.
@@ -94,7 +96,7 @@ static std::string ReportsGetEffectiveDate()
 static std::string ReportsGetStartingDateTime()
 {
 	// Get the current time.
-	auto const rawTime = time(nullptr);
+	auto const rawTime = TimerGetCurrentCalendarTime();
 	auto* localTime = localtime(&rawTime);
 
 	// If the time is before the starting hour, go back one day.
@@ -348,6 +350,44 @@ void ReportsProcess()
 	ReportsOpenFile();
 }
 
+// Get the next time that the reports need to be processed.
+//
+// deadline:	(Output) The time by which the reports need to be processed.
+//
+// Returns:	True if the reports need to be processed again, false otherwise.
+//
+bool ReportsGetNextDeadline(Time& deadline)
+{
+	{
+		// Acquire a lock to protect the pending item list.
+		const std::lock_guard<std::mutex> reportGuard(s_reportMutex);
+
+		// Pending items should be written out right away.
+		if ((s_reportFile != nullptr) && (s_pendingItemList.empty() == false))
+		{
+			deadline = TimerClock::now();
+			return true;
+		}
+	}
+
+	// Otherwise, the next thing that happens is switching to the next report at the starting hour.
+	auto const rawTime = TimerGetCurrentCalendarTime();
+	auto* localTime = localtime(&rawTime);
+
+	if (localTime->tm_hour >= REPORT_STARTING_HOUR)
+	{
+		localTime->tm_mday++;
+	}
+
+	localTime->tm_hour = REPORT_STARTING_HOUR;
+	localTime->tm_min = 0;
+	localTime->tm_sec = 0;
+	localTime->tm_isdst = -1;
+
+	deadline = TimerGetTimeFromCalendarTime(mktime(localTime));
+	return true;
+}
+
 // Add an item to the report.
 // 
 // eventString:	The string version of the JSON for the event.
@@ -358,7 +398,7 @@ static void ReportsAddItem(std::string const& eventString)
 	const std::lock_guard<std::mutex> reportGuard(s_reportMutex);
 
 	PendingItem pendingItem;
-	pendingItem.m_rawTime = time(nullptr);
+	pendingItem.m_rawTime = TimerGetCurrentCalendarTime();
 	pendingItem.m_eventString = eventString;
 
 	s_pendingItemList.push_back(pendingItem);
@@ -457,6 +497,39 @@ void ReportsAddStatusItem()
 	rapidjson::Writer<rapidjson::StringBuffer> itemWriter(itemBuffer);
 	itemDocument.Accept(itemWriter);
 
+	// Handle the rest.
+	ReportsAddItem(itemBuffer.GetString());
+}
+
+// Add an item to the report corresponding to a measured latency, like the time from a key press to
+// the pins changing.
+//
+// latencyName:	The name of the latency.
+// latencyUS:		The latency in microseconds.
+//
+void ReportsAddLatencyItem(char const* latencyName, int64_t latencyUS)
+{
+	// Make a JSON representation of this item.
+	rapidjson::Document itemDocument;
+	itemDocument.SetObject();
+
+	auto itemAllocator = itemDocument.GetAllocator();
+
+	itemDocument.AddMember("type", 
+		rapidjson::Value(rapidjson::StringRef("latency")), itemAllocator);	
+
+	// It is safe to use a string reference here because this document will not live outside of this 
+	// scope.
+	itemDocument.AddMember("name", 
+		rapidjson::Value(rapidjson::StringRef(latencyName)), itemAllocator);
+
+	itemDocument.AddMember("latencyUS", rapidjson::Value(latencyUS), itemAllocator);
+	
+	// Write this into a string.
+	rapidjson::StringBuffer itemBuffer;
+	rapidjson::Writer<rapidjson::StringBuffer> itemWriter(itemBuffer);
+	itemDocument.Accept(itemWriter);
+
 	// Handle the rest.
 	ReportsAddItem(itemBuffer.GetString());
 }
\ No newline at end of file
@@ -24,6 +24,14 @@ void ReportsUninitialize();
 //
 void ReportsProcess();
 
+// Get the next time that the reports need to be processed.
+//
+// deadline:	(Output) The time by which the reports need to be processed.
+//
+// Returns:	True if the reports need to be processed again, false otherwise.
+//
+bool ReportsGetNextDeadline(Time& deadline);
+
 // Add an item to the report corresponding to a control event.
 // 
 // controlName:	The name of the control.
@@ -41,4 +49,12 @@ void ReportsAddRoutineItem(std::string const& actionName);
 
 // Add an item to the report corresponding to a status event.
 // 
-void ReportsAddStatusItem();
\ No newline at end of file
+void ReportsAddStatusItem();
+
+// Add an item to the report corresponding to a measured latency, like the time from a key press to
+// the pins changing.
+//
+// latencyName:	The name of the latency.
+// latencyUS:		The latency in microseconds.
+//
+void ReportsAddLatencyItem(char const* latencyName, int64_t latencyUS);
\ No newline at end of file
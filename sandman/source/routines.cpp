@@ -151,6 +151,16 @@ bool Routine::ReadFromFile(char const* fileName)
 		{
 			continue;
 		}
+
+		// Find the control now, so that running the step doesn't have to. A step that doesn't move
+		// anything is just a delay.
+		if ((step.m_controlAction.m_action < Control::kNumActions) &&
+			 (step.m_controlAction.Resolve() == false))
+		{
+			Logger::WriteLine(Shell::Red("Routine step refers to unknown control \""),
+									step.m_controlAction.m_controlName, Shell::Red("\" in "), fileName,
+									Shell::Red("."));
+		}
 					
 		// If we successfully read the step, add it to the list.
 		m_steps.push_back(step);
@@ -311,7 +321,7 @@ void RoutineStart()
 	}
 	
 	s_routineIndex = 0u;
-	TimerGetCurrent(s_routineDelayStartTime);
+	s_routineDelayStartTime = TimerClock::now();
 	
 	// Notify.
 	NotificationPlay("routine_start");
@@ -376,17 +386,10 @@ void RoutinesProcess()
 		return;
 	}
 
-	// Get elapsed time since delay start.
-	Time currentTime;
-	TimerGetCurrent(currentTime);
-
-	auto const elapsedTimeSec = 
-		TimerGetElapsedMilliseconds(s_routineDelayStartTime, currentTime) / 1000.0f;
-
 	// Time up?
 	auto& step = s_routine.GetSteps()[s_routineIndex];
 	
-	if (elapsedTimeSec < step.m_delaySec)
+	if (TimerClock::now() < s_routineDelayStartTime + std::chrono::seconds(step.m_delaySec))
 	{
 		return;
 	}
@@ -395,7 +398,7 @@ void RoutinesProcess()
 	s_routineIndex = (s_routineIndex + 1u) % numSteps;
 	
 	// Set the new delay start time.
-	TimerGetCurrent(s_routineDelayStartTime);
+	s_routineDelayStartTime = TimerClock::now();
 	
 	// Sanity check the step.
 	if (step.m_controlAction.m_action >= Control::kNumActions)
@@ -421,3 +424,28 @@ void RoutinesProcess()
 
 	Logger::WriteLine("Routine moving to step ", s_routineIndex, ".");
 }
+
+// Get the next time that the routines need to be processed, if any.
+//
+// deadline:	(Output) The time by which the routines need to be processed.
+//
+// Returns:	True if the routines need to be processed again, false otherwise.
+//
+bool RoutinesGetNextDeadline(Time& deadline)
+{
+	if ((s_routinesInitialized == false) || (RoutineIsRunning() == false))
+	{
+		return false;
+	}
+
+	if (s_routine.IsEmpty() == true)
+	{
+		return false;
+	}
+
+	// The next step happens once its delay is up.
+	auto const& step = s_routine.GetSteps()[s_routineIndex];
+
+	deadline = s_routineDelayStartTime + std::chrono::seconds(step.m_delaySec);
+	return true;
+}
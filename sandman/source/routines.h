@@ -87,3 +87,11 @@ bool RoutineIsRunning();
 //
 void RoutinesProcess();
 
+// Get the next time that the routines need to be processed, if any.
+//
+// deadline:	(Output) The time by which the routines need to be processed.
+//
+// Returns:	True if the routines need to be processed again, false otherwise.
+//
+bool RoutinesGetNextDeadline(Time& deadline);
+
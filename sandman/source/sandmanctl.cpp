@@ -0,0 +1,371 @@
+// A minimal client for sending commands to the Sandman daemon. It links against nothing but the C
+// and C++ runtimes, so it starts far faster than the full program, and it can send any number of
+// commands over a single connection.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <poll.h>
+#include <pwd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Constants
+//
+
+// How much to read from the daemon or stdin at once.
+static constexpr std::size_t kReadBufferCapacity{ 512u };
+
+// Locals
+//
+
+// Whether the next response text received starts a new response.
+static bool s_atResponseStart = true;
+
+// Whether the next response character received starts a new line.
+static bool s_atLineStart = true;
+
+// The number of responses that reported an error.
+static unsigned int s_errorCount = 0u;
+
+// Functions
+//
+
+// Get the path of the daemon's socket, the same way the daemon decides where it lives.
+//
+// socketFilename:	(Output) The path of the socket.
+//
+// Returns:	True on success, false on failure.
+//
+static bool GetSocketFilename(std::string& socketFilename)
+{
+	auto const* homeDirectory = std::getenv("SANDMAN_ROOT");
+
+	if (homeDirectory == nullptr)
+	{
+		homeDirectory = std::getenv("HOME");
+	}
+
+	if (homeDirectory == nullptr)
+	{
+		auto const* passwordEntry = getpwuid(getuid());
+
+		if (passwordEntry == nullptr)
+		{
+			return false;
+		}
+
+		homeDirectory = passwordEntry->pw_dir;
+	}
+
+	socketFilename = std::string(homeDirectory) + "/.sandman/sandman.sock";
+	return true;
+}
+
+// Connect to the daemon.
+//
+// Returns:	The connected socket, or -1 on failure.
+//
+static int Connect()
+{
+	std::string socketFilename;
+
+	if (GetSocketFilename(socketFilename) == false)
+	{
+		std::fprintf(stderr, "Failed to find the home directory.\n");
+		return -1;
+	}
+
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+
+	if (socketFilename.size() >= sizeof(address.sun_path))
+	{
+		std::fprintf(stderr, "The socket path \"%s\" is too long.\n", socketFilename.c_str());
+		return -1;
+	}
+
+	std::strncpy(address.sun_path, socketFilename.c_str(), sizeof(address.sun_path) - 1);
+
+	auto const connectionSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (connectionSocket < 0)
+	{
+		std::fprintf(stderr, "Failed to create a socket.\n");
+		return -1;
+	}
+
+	if (connect(connectionSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+	{
+		std::fprintf(stderr, "Failed to connect to the daemon at \"%s\".\n", socketFilename.c_str());
+		close(connectionSocket);
+		return -1;
+	}
+
+	return connectionSocket;
+}
+
+// Send all of some text, even if the socket takes it a piece at a time.
+//
+// connectionSocket:	The socket to send on.
+// text:					The text.
+// length:				The length of the text.
+//
+// Returns:	True on success, false on failure.
+//
+static bool SendAll(int connectionSocket, char const* text, std::size_t length)
+{
+	while (length > 0u)
+	{
+		auto const numSentBytes = send(connectionSocket, text, length, MSG_NOSIGNAL);
+
+		if (numSentBytes < 0)
+		{
+			return false;
+		}
+
+		text += numSentBytes;
+		length -= static_cast<std::size_t>(numSentBytes);
+	}
+
+	return true;
+}
+
+// Print response text from the daemon, keeping track of which responses were errors.
+//
+// text:		The response text.
+// length:	The length of the text.
+//
+static void HandleResponseText(char const* text, std::size_t length)
+{
+	static constexpr char const* kErrorPrefix = "error";
+
+	for (std::size_t characterIndex = 0u; characterIndex < length; characterIndex++)
+	{
+		auto const character = text[characterIndex];
+
+		if (character == '\n')
+		{
+			// An empty line ends the response and isn't worth printing.
+			if (s_atLineStart == true)
+			{
+				s_atResponseStart = true;
+				continue;
+			}
+
+			s_atLineStart = true;
+		}
+		else if (s_atLineStart == true)
+		{
+			if ((s_atResponseStart == true) &&
+				 (std::strncmp(text + characterIndex, kErrorPrefix,
+									std::min(length - characterIndex, std::strlen(kErrorPrefix))) == 0))
+			{
+				s_errorCount++;
+			}
+
+			s_atLineStart = false;
+			s_atResponseStart = false;
+		}
+
+		std::fputc(character, stdout);
+	}
+}
+
+// Send one command and print the response.
+//
+// command:	The command.
+//
+// Returns:	The exit code.
+//
+static int SendCommand(std::string const& command)
+{
+	auto const connectionSocket = Connect();
+
+	if (connectionSocket < 0)
+	{
+		return EXIT_FAILURE;
+	}
+
+	auto const line = command + '\n';
+
+	if (SendAll(connectionSocket, line.c_str(), line.size()) == false)
+	{
+		std::fprintf(stderr, "Failed to send \"%s\" to the daemon.\n", command.c_str());
+		close(connectionSocket);
+		return EXIT_FAILURE;
+	}
+
+	// Let the daemon know that there's nothing more coming, then print until it hangs up.
+	shutdown(connectionSocket, SHUT_WR);
+
+	char readBuffer[kReadBufferCapacity];
+
+	while (true)
+	{
+		auto const numReceivedBytes = recv(connectionSocket, readBuffer, kReadBufferCapacity, 0);
+
+		if (numReceivedBytes <= 0)
+		{
+			break;
+		}
+
+		HandleResponseText(readBuffer, static_cast<std::size_t>(numReceivedBytes));
+	}
+
+	close(connectionSocket);
+	return (s_errorCount == 0u) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Send every line from stdin as a command over a single connection, printing the responses as they
+// arrive.
+//
+// Returns:	The exit code.
+//
+static int SendCommandsFromInput()
+{
+	auto const connectionSocket = Connect();
+
+	if (connectionSocket < 0)
+	{
+		return EXIT_FAILURE;
+	}
+
+	char readBuffer[kReadBufferCapacity];
+
+	auto inputOpen = true;
+
+	pollfd pollFileDescriptors[2] = {};
+	pollFileDescriptors[0].fd = connectionSocket;
+	pollFileDescriptors[0].events = POLLIN;
+	pollFileDescriptors[1].fd = STDIN_FILENO;
+	pollFileDescriptors[1].events = POLLIN;
+
+	while (true)
+	{
+		// Once the input is finished, only wait for the daemon.
+		auto const pollFileDescriptorCount = (inputOpen == true) ? 2 : 1;
+
+		if (poll(pollFileDescriptors, pollFileDescriptorCount, -1) < 0)
+		{
+			break;
+		}
+
+		// Forward commands as they come in. The daemon splits them at newlines itself.
+		if ((inputOpen == true) && (pollFileDescriptors[1].revents != 0))
+		{
+			auto const numReadBytes = read(STDIN_FILENO, readBuffer, kReadBufferCapacity);
+
+			if (numReadBytes <= 0)
+			{
+				// The daemon will answer the rest and then hang up.
+				shutdown(connectionSocket, SHUT_WR);
+				inputOpen = false;
+			}
+			else if (SendAll(connectionSocket, readBuffer,
+								  static_cast<std::size_t>(numReadBytes)) == false)
+			{
+				std::fprintf(stderr, "Failed to send to the daemon.\n");
+				break;
+			}
+		}
+
+		if (pollFileDescriptors[0].revents != 0)
+		{
+			auto const numReceivedBytes = recv(connectionSocket, readBuffer, kReadBufferCapacity, 0);
+
+			if (numReceivedBytes <= 0)
+			{
+				break;
+			}
+
+			HandleResponseText(readBuffer, static_cast<std::size_t>(numReceivedBytes));
+			std::fflush(stdout);
+		}
+	}
+
+	close(connectionSocket);
+	return (s_errorCount == 0u) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Print how to use the program.
+//
+static void PrintUsage()
+{
+	std::printf("Usage:\n"
+					"  sandmanctl <command...>     Send a command, like \"sandmanctl legs raise\".\n"
+					"  sandmanctl --command=<cmd>  Send a command with '_' for spaces, like "
+					"\"--command=legs_raise\".\n"
+					"  sandmanctl --stats          Print the daemon's timing and latency statistics.\n"
+					"  sandmanctl --shutdown       Stop the daemon.\n"
+					"  sandmanctl -                Send each line from stdin as a command over one "
+					"connection.\n"
+					"\n"
+					"The exit code is nonzero if any command was rejected.\n");
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	std::string const firstArgument = argv[1];
+
+	if (firstArgument == "-")
+	{
+		return SendCommandsFromInput();
+	}
+
+	if ((firstArgument == "--help") || (firstArgument == "-h"))
+	{
+		PrintUsage();
+		return EXIT_SUCCESS;
+	}
+
+	if (firstArgument == "--stats")
+	{
+		return SendCommand("stats");
+	}
+
+	if (firstArgument == "--shutdown")
+	{
+		return SendCommand("shutdown");
+	}
+
+	// The same form that the full program takes, so that existing setups can switch over.
+	static constexpr char const* kCommandPrefix = "--command=";
+
+	if (firstArgument.compare(0, std::strlen(kCommandPrefix), kCommandPrefix) == 0)
+	{
+		auto command = firstArgument.substr(std::strlen(kCommandPrefix));
+
+		// Replace '_' with ' '.
+		for (auto& character : command)
+		{
+			if (character == '_')
+			{
+				character = ' ';
+			}
+		}
+
+		return SendCommand(command);
+	}
+
+	// Otherwise the arguments are the words of the command.
+	std::string command = firstArgument;
+
+	for (int argumentIndex = 2; argumentIndex < argc; argumentIndex++)
+	{
+		command += ' ';
+		command += argv[argumentIndex];
+	}
+
+	return SendCommand(command);
+}
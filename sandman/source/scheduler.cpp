@@ -0,0 +1,195 @@
+#include "scheduler.h"
+
+#include <utility>
+
+// Functions
+//
+
+// Scheduler members
+
+// Schedule an item, replacing any deadline it already has.
+//
+// id:			The identifier of the item.
+// deadline:	The time at which the item is due.
+//
+void Scheduler::Schedule(unsigned int id, Time const& deadline)
+{
+	// Make room for the item if we haven't seen it before.
+	if (id >= m_heapIndices.size())
+	{
+		m_heapIndices.resize(id + 1, kNotScheduled);
+		m_deadlines.resize(id + 1);
+	}
+
+	m_deadlines[id] = deadline;
+
+	auto heapIndex = m_heapIndices[id];
+
+	if (heapIndex == kNotScheduled)
+	{
+		heapIndex = static_cast<unsigned int>(m_heap.size());
+		m_heap.push_back(id);
+		m_heapIndices[id] = heapIndex;
+	}
+
+	// The deadline may have moved in either direction.
+	SiftUp(heapIndex);
+	SiftDown(m_heapIndices[id]);
+}
+
+// Remove the deadline for an item, if it has one.
+//
+// id:	The identifier of the item.
+//
+void Scheduler::Cancel(unsigned int id)
+{
+	if (id >= m_heapIndices.size())
+	{
+		return;
+	}
+
+	auto const heapIndex = m_heapIndices[id];
+
+	if (heapIndex == kNotScheduled)
+	{
+		return;
+	}
+
+	// Replace it with the last entry, then restore the order.
+	auto const lastHeapIndex = static_cast<unsigned int>(m_heap.size() - 1);
+	Swap(heapIndex, lastHeapIndex);
+
+	m_heap.pop_back();
+	m_heapIndices[id] = kNotScheduled;
+
+	if (heapIndex < m_heap.size())
+	{
+		SiftUp(heapIndex);
+		SiftDown(m_heapIndices[m_heap[heapIndex]]);
+	}
+}
+
+// Remove all of the deadlines.
+//
+void Scheduler::Clear()
+{
+	m_heap.clear();
+	m_deadlines.clear();
+	m_heapIndices.clear();
+}
+
+// Get the earliest deadline, if there is one.
+//
+// deadline:	(Output) The earliest deadline.
+//
+// Returns:	True if there is a deadline, false otherwise.
+//
+bool Scheduler::GetNextDeadline(Time& deadline) const
+{
+	if (m_heap.empty() == true)
+	{
+		return false;
+	}
+
+	deadline = m_deadlines[m_heap.front()];
+	return true;
+}
+
+// Remove the item with the earliest deadline, if that deadline has passed.
+//
+// currentTime:	The current time.
+// id:				(Output) The identifier of the item that is due.
+//
+// Returns:	True if an item was due, false otherwise.
+//
+bool Scheduler::PopExpired(Time const& currentTime, unsigned int& id)
+{
+	if (m_heap.empty() == true)
+	{
+		return false;
+	}
+
+	auto const earliestID = m_heap.front();
+
+	if (currentTime < m_deadlines[earliestID])
+	{
+		return false;
+	}
+
+	Cancel(earliestID);
+
+	id = earliestID;
+	return true;
+}
+
+// Move an entry of the heap toward the root until it's in order.
+//
+// heapIndex:	The index of the entry in the heap.
+//
+void Scheduler::SiftUp(unsigned int heapIndex)
+{
+	while (heapIndex > 0)
+	{
+		auto const parentHeapIndex = (heapIndex - 1) / 2;
+
+		if (IsEarlier(heapIndex, parentHeapIndex) == false)
+		{
+			break;
+		}
+
+		Swap(heapIndex, parentHeapIndex);
+		heapIndex = parentHeapIndex;
+	}
+}
+
+// Move an entry of the heap toward the leaves until it's in order.
+//
+// heapIndex:	The index of the entry in the heap.
+//
+void Scheduler::SiftDown(unsigned int heapIndex)
+{
+	auto const heapSize = static_cast<unsigned int>(m_heap.size());
+
+	while (true)
+	{
+		auto earliestHeapIndex = heapIndex;
+
+		auto const leftHeapIndex = (2 * heapIndex) + 1;
+		auto const rightHeapIndex = leftHeapIndex + 1;
+
+		if ((leftHeapIndex < heapSize) && (IsEarlier(leftHeapIndex, earliestHeapIndex) == true))
+		{
+			earliestHeapIndex = leftHeapIndex;
+		}
+
+		if ((rightHeapIndex < heapSize) && (IsEarlier(rightHeapIndex, earliestHeapIndex) == true))
+		{
+			earliestHeapIndex = rightHeapIndex;
+		}
+
+		if (earliestHeapIndex == heapIndex)
+		{
+			break;
+		}
+
+		Swap(heapIndex, earliestHeapIndex);
+		heapIndex = earliestHeapIndex;
+	}
+}
+
+// Swap two entries of the heap, keeping track of where they went.
+//
+void Scheduler::Swap(unsigned int heapIndexA, unsigned int heapIndexB)
+{
+	std::swap(m_heap[heapIndexA], m_heap[heapIndexB]);
+
+	m_heapIndices[m_heap[heapIndexA]] = heapIndexA;
+	m_heapIndices[m_heap[heapIndexB]] = heapIndexB;
+}
+
+// Whether the entry at one heap index is due before the entry at another.
+//
+bool Scheduler::IsEarlier(unsigned int heapIndexA, unsigned int heapIndexB) const
+{
+	return m_deadlines[m_heap[heapIndexA]] < m_deadlines[m_heap[heapIndexB]];
+}
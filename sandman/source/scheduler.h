@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+
+#include "timer.h"
+
+// Types
+//
+
+// Keeps track of a deadline for each of a set of items, identified by small integers, so that the
+// earliest deadline can be found quickly. Each item has at most one deadline at a time.
+//
+class Scheduler
+{
+	public:
+
+		// Schedule an item, replacing any deadline it already has.
+		//
+		// id:			The identifier of the item.
+		// deadline:	The time at which the item is due.
+		//
+		void Schedule(unsigned int id, Time const& deadline);
+
+		// Remove the deadline for an item, if it has one.
+		//
+		// id:	The identifier of the item.
+		//
+		void Cancel(unsigned int id);
+
+		// Remove all of the deadlines.
+		//
+		void Clear();
+
+		// Get the earliest deadline, if there is one.
+		//
+		// deadline:	(Output) The earliest deadline.
+		//
+		// Returns:	True if there is a deadline, false otherwise.
+		//
+		bool GetNextDeadline(Time& deadline) const;
+
+		// Remove the item with the earliest deadline, if that deadline has passed.
+		//
+		// currentTime:	The current time.
+		// id:				(Output) The identifier of the item that is due.
+		//
+		// Returns:	True if an item was due, false otherwise.
+		//
+		bool PopExpired(Time const& currentTime, unsigned int& id);
+
+	private:
+
+		// Constants.
+
+		// Marks an item that is not in the heap.
+		static constexpr unsigned int kNotScheduled{ ~0u };
+
+		// Move an entry of the heap toward the root until it's in order.
+		//
+		// heapIndex:	The index of the entry in the heap.
+		//
+		void SiftUp(unsigned int heapIndex);
+
+		// Move an entry of the heap toward the leaves until it's in order.
+		//
+		// heapIndex:	The index of the entry in the heap.
+		//
+		void SiftDown(unsigned int heapIndex);
+
+		// Swap two entries of the heap, keeping track of where they went.
+		//
+		void Swap(unsigned int heapIndexA, unsigned int heapIndexB);
+
+		// Whether the entry at one heap index is due before the entry at another.
+		//
+		bool IsEarlier(unsigned int heapIndexA, unsigned int heapIndexB) const;
+
+		// A binary min-heap of item identifiers, ordered by deadline.
+		std::vector<unsigned int> m_heap;
+
+		// The deadline for each item, indexed by identifier.
+		std::vector<Time> m_deadlines;
+
+		// Where each item is in the heap, indexed by identifier.
+		std::vector<unsigned int> m_heapIndices;
+};
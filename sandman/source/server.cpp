@@ -0,0 +1,446 @@
+#include "server.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "reactor.h"
+#include "stats.h"
+
+// Constants
+//
+
+// Used to detect when a file descriptor is invalid.
+static constexpr int kInvalidFileDescriptor{ -1 };
+
+// The number of connections that may be waiting to be accepted.
+static constexpr int kListenBacklog{ 16 };
+
+// The maximum number of clients connected at once.
+static constexpr std::size_t kMaxConnectionCount{ 32u };
+
+// The longest message we will hold onto while waiting for its newline.
+static constexpr std::size_t kMaxMessageLength{ 1'024u };
+
+// The most response text we will hold onto for a client that isn't reading it.
+static constexpr std::size_t kMaxPendingOutputLength{ 64u * 1'024u };
+
+// How much to read from a client at once.
+static constexpr std::size_t kReceiveBufferCapacity{ 512u };
+
+// Types
+//
+
+// A connected client.
+struct ServerConnection
+{
+	// Received text that doesn't yet make up a whole message.
+	std::string m_input;
+
+	// Response text that the client hasn't taken yet.
+	std::string m_output;
+
+	// Whether the client has finished sending, so we hang up once the responses are sent.
+	bool m_closeWhenFlushed = false;
+
+	// The events we are watching the socket for.
+	std::uint32_t m_watchedEvents = EPOLLIN;
+};
+
+// Locals
+//
+
+// Used to listen for connections.
+static int s_listeningSocket = kInvalidFileDescriptor;
+
+// Called for each message received.
+static ServerMessageHandler s_messageHandler;
+
+// The connected clients, keyed by their sockets.
+static std::map<int, ServerConnection> s_socketToConnectionMap;
+
+// Functions
+//
+
+// Change the events we are watching a client's socket for, if they differ.
+//
+// connectionSocket:	The client's socket.
+// connection:			The client.
+// events:				The epoll events to watch for.
+//
+static void ServerWatchConnection(int connectionSocket, ServerConnection& connection,
+											 std::uint32_t events)
+{
+	if (connection.m_watchedEvents == events)
+	{
+		return;
+	}
+
+	ReactorModifyFileDescriptor(connectionSocket, events);
+	connection.m_watchedEvents = events;
+}
+
+// Hang up on a client.
+//
+// connectionSocket:	The client's socket.
+//
+static void ServerCloseConnection(int connectionSocket)
+{
+	ReactorRemoveFileDescriptor(connectionSocket);
+	close(connectionSocket);
+
+	s_socketToConnectionMap.erase(connectionSocket);
+
+	Logger::WriteLine("Connection closed.");
+}
+
+// Send as much pending response text as the client will take without blocking.
+//
+// connectionSocket:	The client's socket.
+// connection:			The client.
+//
+// Returns:	True if the connection is still open, false if it was closed.
+//
+static bool ServerFlushConnection(int connectionSocket, ServerConnection& connection)
+{
+	std::size_t sentLength = 0u;
+
+	while (sentLength < connection.m_output.size())
+	{
+		auto const numSentBytes = send(connectionSocket, connection.m_output.data() + sentLength,
+												 connection.m_output.size() - sentLength, MSG_NOSIGNAL);
+
+		if (numSentBytes < 0)
+		{
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+			{
+				break;
+			}
+
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			// The client went away without reading everything, which is up to them.
+			ServerCloseConnection(connectionSocket);
+			return false;
+		}
+
+		sentLength += static_cast<std::size_t>(numSentBytes);
+	}
+
+	connection.m_output.erase(0, sentLength);
+
+	if (connection.m_output.empty() == true)
+	{
+		if (connection.m_closeWhenFlushed == true)
+		{
+			ServerCloseConnection(connectionSocket);
+			return false;
+		}
+
+		ServerWatchConnection(connectionSocket, connection, EPOLLIN);
+		return true;
+	}
+
+	// Don't let a client that never reads make us hold onto responses forever.
+	if (connection.m_output.size() > kMaxPendingOutputLength)
+	{
+		Logger::WriteLine(Shell::Yellow("Closing a connection that isn't reading its responses."));
+		ServerCloseConnection(connectionSocket);
+		return false;
+	}
+
+	// Finish sending once the client catches up. Once it has finished sending, the socket stays
+	// readable for good, so only wait for it to become writable.
+	ServerWatchConnection(connectionSocket, connection, (connection.m_closeWhenFlushed == true) ?
+								 EPOLLOUT : (EPOLLIN | EPOLLOUT));
+	return true;
+}
+
+// Handle a message from a client, queueing up its response.
+//
+// connection:	The client.
+// message:		The message, without its terminating newline.
+//
+static void ServerHandleMessage(ServerConnection& connection, std::string message)
+{
+	// Be forgiving of clients that send carriage returns.
+	if ((message.empty() == false) && (message.back() == '\r'))
+	{
+		message.pop_back();
+	}
+
+	// Blank lines are ignored, so that they can be used to keep a connection alive.
+	if (message.empty() == true)
+	{
+		return;
+	}
+
+	std::string response;
+	s_messageHandler(message, response);
+
+	// An empty line marks the end of the response.
+	connection.m_output += response;
+	connection.m_output += '\n';
+}
+
+// Handle whatever a client has sent.
+//
+// connectionSocket:	The client's socket.
+// connection:			The client.
+//
+// Returns:	True if the connection is still open, false if it was closed.
+//
+static bool ServerReceiveFromConnection(int connectionSocket, ServerConnection& connection)
+{
+	while (connection.m_closeWhenFlushed == false)
+	{
+		char receiveBuffer[kReceiveBufferCapacity];
+		auto const numReceivedBytes = recv(connectionSocket, receiveBuffer, kReceiveBufferCapacity, 0);
+
+		if (numReceivedBytes < 0)
+		{
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+			{
+				break;
+			}
+
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			Logger::WriteLine("Connection closed, error receiving.");
+			ServerCloseConnection(connectionSocket);
+			return false;
+		}
+
+		// The client is done sending. A message without a newline at the end still counts, which is
+		// how one-shot clients talk to us.
+		if (numReceivedBytes == 0)
+		{
+			if (connection.m_input.empty() == false)
+			{
+				ServerHandleMessage(connection, connection.m_input);
+				connection.m_input.clear();
+			}
+
+			connection.m_closeWhenFlushed = true;
+			break;
+		}
+
+		connection.m_input.append(receiveBuffer, static_cast<std::size_t>(numReceivedBytes));
+
+		// Handle every complete message.
+		std::size_t messageStart = 0u;
+
+		while (true)
+		{
+			auto const messageEnd = connection.m_input.find('\n', messageStart);
+
+			if (messageEnd == std::string::npos)
+			{
+				break;
+			}
+
+			ServerHandleMessage(connection,
+									  connection.m_input.substr(messageStart, messageEnd - messageStart));
+			messageStart = messageEnd + 1u;
+		}
+
+		connection.m_input.erase(0, messageStart);
+
+		if (connection.m_input.size() > kMaxMessageLength)
+		{
+			Logger::WriteLine(Shell::Yellow("Closing a connection that sent a message longer than "),
+									kMaxMessageLength, Shell::Yellow(" characters."));
+			ServerCloseConnection(connectionSocket);
+			return false;
+		}
+	}
+
+	return ServerFlushConnection(connectionSocket, connection);
+}
+
+// Handle a client's socket being ready.
+//
+// connectionSocket:	The client's socket.
+// events:				The epoll events that are ready.
+//
+static void ServerHandleConnectionEvents(int connectionSocket, std::uint32_t events)
+{
+	StatsTimer const timer(kStatsSubsystemSocket);
+
+	auto const connectionIterator = s_socketToConnectionMap.find(connectionSocket);
+
+	if (connectionIterator == s_socketToConnectionMap.end())
+	{
+		return;
+	}
+
+	auto& connection = connectionIterator->second;
+
+	// Errors and hang ups are found out about when reading.
+	if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0)
+	{
+		if (ServerReceiveFromConnection(connectionSocket, connection) == false)
+		{
+			return;
+		}
+	}
+
+	if ((events & EPOLLOUT) != 0)
+	{
+		ServerFlushConnection(connectionSocket, connection);
+	}
+}
+
+// Accept all of the clients that are waiting to connect.
+//
+static void ServerAcceptConnections()
+{
+	StatsTimer const timer(kStatsSubsystemSocket);
+
+	while (true)
+	{
+		auto const connectionSocket = accept4(s_listeningSocket, nullptr, nullptr,
+														  SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+		if (connectionSocket < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		if (s_socketToConnectionMap.size() >= kMaxConnectionCount)
+		{
+			Logger::WriteLine(Shell::Yellow("Refusing a new connection, because there are already "),
+									kMaxConnectionCount, Shell::Yellow(" connections."));
+			close(connectionSocket);
+			continue;
+		}
+
+		auto const HandleEvents = [connectionSocket](std::uint32_t events)
+		{
+			ServerHandleConnectionEvents(connectionSocket, events);
+		};
+
+		if (ReactorAddFileDescriptor(connectionSocket, EPOLLIN, HandleEvents) == false)
+		{
+			close(connectionSocket);
+			continue;
+		}
+
+		s_socketToConnectionMap[connectionSocket] = ServerConnection();
+
+		Logger::WriteLine("Got a new connection.");
+	}
+}
+
+// Start listening for clients on a Unix domain socket. Clients may stay connected and send any
+// number of messages, each terminated by a newline. Every message gets a response, which is
+// terminated by an empty line. The server is driven by the reactor, so it should already be
+// initialized.
+//
+// socketFilename:	The path of the socket file to create.
+// handler:				Called for each message received.
+//
+// Returns:	True on success, false on failure.
+//
+bool ServerInitialize(std::string const& socketFilename, ServerMessageHandler const& handler)
+{
+	Logger::WriteLine("Initializing the socket server...");
+
+	s_messageHandler = handler;
+
+	sockaddr_un listeningAddress = {};
+	listeningAddress.sun_family = AF_UNIX;
+
+	if (socketFilename.size() >= sizeof(listeningAddress.sun_path))
+	{
+		Logger::WriteLine('\t', Shell::Red("socket path \""), socketFilename,
+								Shell::Red("\" is too long"));
+		return false;
+	}
+
+	std::strncpy(listeningAddress.sun_path, socketFilename.c_str(),
+					 sizeof(listeningAddress.sun_path) - 1);
+
+	// Create a listening socket.
+	s_listeningSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	if (s_listeningSocket < 0)
+	{
+		Logger::WriteLine('\t', Shell::Red("failed to create listening socket"));
+		return false;
+	}
+
+	// Unlink the file if needed.
+	unlink(listeningAddress.sun_path);
+
+	// Bind the socket to the file.
+	if (bind(s_listeningSocket, reinterpret_cast<sockaddr*>(&listeningAddress),
+				sizeof(sockaddr_un)) < 0)
+	{
+		Logger::WriteLine('\t', Shell::Red("failed to bind listening socket: "),
+								std::strerror(errno));
+		return false;
+	}
+
+	// Mark the socket for listening.
+	if (listen(s_listeningSocket, kListenBacklog) < 0)
+	{
+		Logger::WriteLine('\t', Shell::Red("failed to mark listening socket to listen"));
+		return false;
+	}
+
+	if (ReactorAddFileDescriptor(s_listeningSocket, EPOLLIN,
+										  [](std::uint32_t /* events */) { ServerAcceptConnections(); }) == false)
+	{
+		Logger::WriteLine('\t', Shell::Red("failed to watch listening socket"));
+		return false;
+	}
+
+	Logger::WriteLine('\t', Shell::Green("succeeded"));
+	Logger::WriteLine();
+	return true;
+}
+
+// Disconnect all of the clients and stop listening.
+//
+void ServerUninitialize()
+{
+	while (s_socketToConnectionMap.empty() == false)
+	{
+		ServerCloseConnection(s_socketToConnectionMap.begin()->first);
+	}
+
+	if (s_listeningSocket != kInvalidFileDescriptor)
+	{
+		ReactorRemoveFileDescriptor(s_listeningSocket);
+		close(s_listeningSocket);
+		s_listeningSocket = kInvalidFileDescriptor;
+	}
+
+	s_messageHandler = nullptr;
+}
+
+// Get the number of clients that are connected.
+//
+unsigned int ServerGetConnectionCount()
+{
+	return static_cast<unsigned int>(s_socketToConnectionMap.size());
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+// Types
+//
+
+// Called for each message received from a client.
+//
+// message:		The message, without its terminating newline.
+// response:	(Output) The text to send back, as zero or more lines each ending with a newline.
+//
+using ServerMessageHandler = std::function<void(std::string const& message, std::string& response)>;
+
+// Functions
+//
+
+// Start listening for clients on a Unix domain socket. Clients may stay connected and send any
+// number of messages, each terminated by a newline. Every message gets a response, which is
+// terminated by an empty line. The server is driven by the reactor, so it should already be
+// initialized.
+//
+// socketFilename:	The path of the socket file to create.
+// handler:				Called for each message received.
+//
+// Returns:	True on success, false on failure.
+//
+bool ServerInitialize(std::string const& socketFilename, ServerMessageHandler const& handler);
+
+// Disconnect all of the clients and stop listening.
+//
+void ServerUninitialize();
+
+// Get the number of clients that are connected.
+//
+unsigned int ServerGetConnectionCount();
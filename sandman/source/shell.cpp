@@ -464,8 +464,8 @@ namespace Shell
 			// Parse a command.
 			{
 				// Tokenize the string.
-				std::vector<CommandToken> commandTokens;
-				CommandTokenizeString(commandTokens, s_buffer.GetData().data());
+				CommandTokenList commandTokens;
+				CommandTokenizeString(commandTokens, bufferView);
 
 				// Parse command tokens.
 				if (CommandParseTokens(commandTokens) == CommandParseTokensReturnTypes::kInvalid)
@@ -503,7 +503,7 @@ namespace Shell
 		switch (int const inputKey{ wgetch(s_window) })
 		{
 			// No input.
-			case ERR: return Result::kNone;
+			case ERR: return Result::kNoInput;
 
 			// "Ctrl+D", EOT (End of Transmission), should gracefully quit.
 			case Key::Ctrl<'D'>: return Result::kRequestToQuit;
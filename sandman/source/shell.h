@@ -198,11 +198,13 @@ namespace Shell
 		enum struct Result : std::uint_least8_t {
 			kNone          = 0u,
 			kRequestToQuit = 1u,
+			kNoInput       = 2u,
 		};
 
 		/// @brief Process a single key input from the user, if any.
 		/// @warning Not thread safe.
-		/// @returns `kRequestToQuit` if the "quit" command was processed.
+		/// @returns `kRequestToQuit` if the "quit" command was processed,
+		/// or `kNoInput` if there was no key input to process.
 		///
 		[[nodiscard]]
 		Result ProcessSingleUserKey();
@@ -0,0 +1,289 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Constants
+//
+
+// The names of the subsystems.
+static constexpr char const* const kStatsSubsystemNames[] =
+{
+	"frame",		// kStatsSubsystemFrame
+	"shell",		// kStatsSubsystemShell
+	"socket",	// kStatsSubsystemSocket
+	"command",	// kStatsSubsystemCommand
+	"input",		// kStatsSubsystemInput
+	"mqtt",		// kStatsSubsystemMQTT
+	"routines",	// kStatsSubsystemRoutines
+	"controls",	// kStatsSubsystemControls
+	"reports",	// kStatsSubsystemReports
+	"actuation",	// kStatsSubsystemActuation
+};
+
+static_assert(sizeof(kStatsSubsystemNames) / sizeof(kStatsSubsystemNames[0]) ==
+				  kNumStatsSubsystems, "Every subsystem needs a name.");
+
+// The most latencies that can be measured.
+static constexpr unsigned int kMaxLatencyCount{ 64u };
+
+// Locals
+//
+
+// The processing time histogram for each subsystem.
+static StatsHistogram s_subsystemHistograms[kNumStatsSubsystems];
+
+// The names and histograms of the latencies being measured. Only the first s_latencyCount are in
+// use.
+static std::array<std::string, kMaxLatencyCount> s_latencyNames;
+static std::array<StatsHistogram, kMaxLatencyCount> s_latencyHistograms;
+static unsigned int s_latencyCount = 0u;
+
+// Functions
+//
+
+// StatsHistogram members
+
+// Record a duration.
+//
+// durationUS:	The duration in microseconds.
+//
+void StatsHistogram::Record(uint64_t durationUS)
+{
+	// The bucket is the number of bits needed to represent the duration.
+	unsigned int bucketIndex = 0;
+	for (auto remainingUS = durationUS; remainingUS != 0; remainingUS >>= 1)
+	{
+		bucketIndex++;
+	}
+
+	bucketIndex = std::min(bucketIndex, kBucketCount - 1);
+
+	m_bucketCounts[bucketIndex]++;
+	m_count++;
+	m_maxUS = std::max(m_maxUS, durationUS);
+}
+
+// Forget all of the recorded durations.
+//
+void StatsHistogram::Reset()
+{
+	m_bucketCounts.fill(0);
+	m_count = 0;
+	m_maxUS = 0;
+}
+
+// Get an upper bound on the duration that a given fraction of the recorded durations fall within.
+//
+// fraction:	The fraction of the durations, between 0 and 1.
+//
+// Returns:	The duration in microseconds.
+//
+uint64_t StatsHistogram::GetPercentileUS(float fraction) const
+{
+	if (m_count == 0)
+	{
+		return 0;
+	}
+
+	// Find the bucket that contains the requested rank.
+	auto const clampedFraction = std::clamp(fraction, 0.0f, 1.0f);
+	auto const rank = static_cast<uint64_t>(std::ceil(clampedFraction * m_count));
+
+	uint64_t cumulativeCount = 0;
+	for (unsigned int bucketIndex = 0; bucketIndex < kBucketCount; bucketIndex++)
+	{
+		cumulativeCount += m_bucketCounts[bucketIndex];
+
+		if ((cumulativeCount == 0) || (cumulativeCount < rank))
+		{
+			continue;
+		}
+
+		// Use the top of the bucket, but never claim more than we've actually seen.
+		auto const bucketMaxUS = (bucketIndex == 0) ? 0 : ((uint64_t{ 1 } << bucketIndex) - 1);
+		return std::min(bucketMaxUS, m_maxUS);
+	}
+
+	return m_maxUS;
+}
+
+// StatsTimer members
+
+// Start timing.
+//
+// subsystem:	The subsystem to record the time for.
+//
+StatsTimer::StatsTimer(StatsSubsystem subsystem)
+	: m_subsystem(subsystem),
+	  m_startTime(TimerClock::now())
+{
+}
+
+// Stop timing and record the duration.
+//
+StatsTimer::~StatsTimer()
+{
+	auto const endTime = TimerClock::now();
+
+	StatsRecord(m_subsystem, m_startTime, endTime);
+}
+
+// Get the time between two times, in a form that can be recorded.
+//
+// startTime:	The earlier time.
+// endTime:		The later time.
+//
+// Returns:	The duration in microseconds.
+//
+static uint64_t StatsGetDurationUS(Time const& startTime, Time const& endTime)
+{
+	// Durations shouldn't be negative, but don't let one turn into a huge unsigned value.
+	auto const duration = std::max(endTime - startTime, TimerClock::duration::zero());
+	auto const durationUS = std::chrono::duration_cast<std::chrono::microseconds>(duration);
+
+	return static_cast<uint64_t>(durationUS.count());
+}
+
+// Record how long a subsystem took to process.
+//
+// subsystem:	The subsystem.
+// startTime:	When processing started.
+// endTime:		When processing ended.
+//
+void StatsRecord(StatsSubsystem subsystem, Time const& startTime, Time const& endTime)
+{
+	if (subsystem >= kNumStatsSubsystems)
+	{
+		return;
+	}
+
+	s_subsystemHistograms[subsystem].Record(StatsGetDurationUS(startTime, endTime));
+}
+
+// Forget all of the recorded durations.
+//
+void StatsReset()
+{
+	for (auto& histogram : s_subsystemHistograms)
+	{
+		histogram.Reset();
+	}
+
+	for (auto& histogram : s_latencyHistograms)
+	{
+		histogram.Reset();
+	}
+}
+
+// Write a human readable summary of the recorded durations.
+//
+// text:	(Output) The summary, one line per subsystem.
+//
+void StatsGetSummary(std::string& text)
+{
+	static constexpr std::size_t kLineCapacity{ 128u };
+	char line[kLineCapacity];
+
+	std::snprintf(line, kLineCapacity, "%-10s %10s %10s %10s %10s\n", "subsystem", "count",
+					  "p50 ms", "p99 ms", "max ms");
+	text = line;
+
+	for (unsigned int subsystemIndex = 0; subsystemIndex < kNumStatsSubsystems; subsystemIndex++)
+	{
+		auto const& histogram = s_subsystemHistograms[subsystemIndex];
+
+		std::snprintf(line, kLineCapacity, "%-10s %10llu %10.3f %10.3f %10.3f\n",
+						  kStatsSubsystemNames[subsystemIndex],
+						  static_cast<unsigned long long>(histogram.GetCount()),
+						  histogram.GetPercentileUS(0.50f) / 1.0e3,
+						  histogram.GetPercentileUS(0.99f) / 1.0e3,
+						  histogram.GetMaxUS() / 1.0e3);
+		text += line;
+	}
+
+	if (s_latencyCount == 0u)
+	{
+		return;
+	}
+
+	// The socket protocol ends a response with an empty line, so the tables can't be separated by
+	// one. The header line sets this one apart well enough.
+	std::snprintf(line, kLineCapacity, "%-32s %10s %10s %10s %10s\n", "latency", "count",
+					  "p50 ms", "p99 ms", "max ms");
+	text += line;
+
+	for (unsigned int latencyIndex = 0u; latencyIndex < s_latencyCount; latencyIndex++)
+	{
+		auto const& histogram = s_latencyHistograms[latencyIndex];
+
+		std::snprintf(line, kLineCapacity, "%-32s %10llu %10.3f %10.3f %10.3f\n",
+						  s_latencyNames[latencyIndex].c_str(),
+						  static_cast<unsigned long long>(histogram.GetCount()),
+						  histogram.GetPercentileUS(0.50f) / 1.0e3,
+						  histogram.GetPercentileUS(0.99f) / 1.0e3,
+						  histogram.GetMaxUS() / 1.0e3);
+		text += line;
+	}
+}
+
+// Start measuring a latency. Adding a latency with the same name as an existing one measures into
+// the same histogram.
+//
+// name:	The name of the latency.
+//
+// Returns:	The latency, or kStatsNoLatency if there's no more room for latencies.
+//
+StatsLatencyID StatsAddLatency(std::string const& name)
+{
+	for (unsigned int latencyIndex = 0u; latencyIndex < s_latencyCount; latencyIndex++)
+	{
+		if (s_latencyNames[latencyIndex] == name)
+		{
+			return latencyIndex;
+		}
+	}
+
+	if (s_latencyCount >= kMaxLatencyCount)
+	{
+		return kStatsNoLatency;
+	}
+
+	s_latencyNames[s_latencyCount] = name;
+	s_latencyHistograms[s_latencyCount].Reset();
+
+	return s_latencyCount++;
+}
+
+// Get the name of a latency.
+//
+// latencyID:	The latency.
+//
+// Returns:	The name, or an empty string if there's no such latency.
+//
+char const* StatsGetLatencyName(StatsLatencyID latencyID)
+{
+	if (latencyID >= s_latencyCount)
+	{
+		return "";
+	}
+
+	return s_latencyNames[latencyID].c_str();
+}
+
+// Record a latency.
+//
+// latencyID:	The latency.
+// startTime:	When the thing being measured happened.
+// endTime:		When it was responded to.
+//
+void StatsRecordLatency(StatsLatencyID latencyID, Time const& startTime, Time const& endTime)
+{
+	if (latencyID >= s_latencyCount)
+	{
+		return;
+	}
+
+	s_latencyHistograms[latencyID].Record(StatsGetDurationUS(startTime, endTime));
+}
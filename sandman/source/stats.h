@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "timer.h"
+
+// Types
+//
+
+// The parts of the program whose processing time is tracked.
+enum StatsSubsystem
+{
+	kStatsSubsystemFrame = 0,	// Everything done in a single pass of the main loop.
+	kStatsSubsystemShell,
+	kStatsSubsystemSocket,
+	kStatsSubsystemCommand,
+	kStatsSubsystemInput,
+	kStatsSubsystemMQTT,
+	kStatsSubsystemRoutines,
+	kStatsSubsystemControls,
+	kStatsSubsystemReports,
+	kStatsSubsystemActuation,	// From a control action being requested to its pins changing.
+
+	kNumStatsSubsystems
+};
+
+// A histogram of durations with a fixed set of buckets. Each bucket covers twice the range of
+// the one before it, so percentiles are approximate but recording is cheap and needs no memory.
+class StatsHistogram
+{
+	public:
+
+		// Record a duration.
+		//
+		// durationUS:	The duration in microseconds.
+		//
+		void Record(uint64_t durationUS);
+
+		// Forget all of the recorded durations.
+		//
+		void Reset();
+
+		// Get the number of recorded durations.
+		//
+		uint64_t GetCount() const
+		{
+			return m_count;
+		}
+
+		// Get the longest recorded duration.
+		//
+		// Returns:	The duration in microseconds.
+		//
+		uint64_t GetMaxUS() const
+		{
+			return m_maxUS;
+		}
+
+		// Get an upper bound on the duration that a given fraction of the recorded durations fall
+		// within.
+		//
+		// fraction:	The fraction of the durations, between 0 and 1.
+		//
+		// Returns:	The duration in microseconds.
+		//
+		uint64_t GetPercentileUS(float fraction) const;
+
+	private:
+
+		// Constants.
+
+		// Enough buckets to cover over an hour in microseconds.
+		static constexpr unsigned int kBucketCount{ 33u };
+
+		// The number of durations that fell in each bucket. Bucket 0 holds durations of zero,
+		// and bucket N holds durations in [2^(N-1), 2^N).
+		std::array<uint64_t, kBucketCount> m_bucketCounts{};
+
+		// The total number of durations recorded.
+		uint64_t m_count = 0;
+
+		// The longest duration recorded.
+		uint64_t m_maxUS = 0;
+};
+
+// Identifies a latency being measured, like the time from a key press to the pins changing.
+using StatsLatencyID = unsigned int;
+
+// Used when a latency isn't being measured.
+static constexpr StatsLatencyID kStatsNoLatency{ ~0u };
+
+// Records how long a subsystem took from construction until destruction.
+class StatsTimer
+{
+	public:
+
+		// Start timing.
+		//
+		// subsystem:	The subsystem to record the time for.
+		//
+		explicit StatsTimer(StatsSubsystem subsystem);
+
+		// Stop timing and record the duration.
+		//
+		~StatsTimer();
+
+		StatsTimer(StatsTimer const&) = delete;
+		StatsTimer& operator=(StatsTimer const&) = delete;
+
+	private:
+
+		// The subsystem being timed.
+		StatsSubsystem m_subsystem;
+
+		// When timing started.
+		Time m_startTime;
+};
+
+// Functions
+//
+
+// Record how long a subsystem took to process.
+//
+// subsystem:	The subsystem.
+// startTime:	When processing started.
+// endTime:		When processing ended.
+//
+void StatsRecord(StatsSubsystem subsystem, Time const& startTime, Time const& endTime);
+
+// Forget all of the recorded durations.
+//
+void StatsReset();
+
+// Write a human readable summary of the recorded durations.
+//
+// text:	(Output) The summary, one line per subsystem, followed by one line per latency.
+//
+void StatsGetSummary(std::string& text);
+
+// Start measuring a latency. Adding a latency with the same name as an existing one measures into
+// the same histogram.
+//
+// name:	The name of the latency.
+//
+// Returns:	The latency, or kStatsNoLatency if there's no more room for latencies.
+//
+StatsLatencyID StatsAddLatency(std::string const& name);
+
+// Get the name of a latency.
+//
+// latencyID:	The latency.
+//
+// Returns:	The name, or an empty string if there's no such latency.
+//
+char const* StatsGetLatencyName(StatsLatencyID latencyID);
+
+// Record a latency.
+//
+// latencyID:	The latency.
+// startTime:	When the thing being measured happened.
+// endTime:		When it was responded to.
+//
+void StatsRecordLatency(StatsLatencyID latencyID, Time const& startTime, Time const& endTime);
@@ -1,85 +1,130 @@
 #include "timer.h"
 
-#if defined (_WIN32)
-	#include <Windows.h>
-#endif // defined (_WIN32)
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 
-#include <ctime>
+// Locals
+//
+
+// Where the current time comes from.
+static std::atomic<TimerClockSource> s_clockSource{ kTimerClockSourceReal };
+
+// The current time of the simulated clock.
+static Time s_simulatedTime;
+
+// The simulated time and the calendar time when the simulated clock was started, so that
+// simulated calendar times can be derived.
+static Time s_simulatedStartTime;
+static std::chrono::system_clock::time_point s_simulatedStartCalendarTime;
+
+// Protects the simulated time, which may be read from other threads.
+static std::mutex s_simulatedTimeMutex;
 
 // Functions
 //
 
-// Get the current time.
+// Get the current time from the steady system clock.
 //
-// time:	(Output) The current time.
+// Returns:	The current time.
 //
-void TimerGetCurrent(Time& time)
+static Time TimerGetCurrentReal()
 {
-	#if defined (_WIN32)
-
-		// NOTE - STL 2011/10/31 - This can fail.
-		LARGE_INTEGER ticks;
-		QueryPerformanceCounter(&ticks);
-
-		// Get tick frequency in ticks/second.
-		// NOTE - STL 2012/11/11 - It's inefficient to call this each time. 
-		// NOTE - STL 2011/10/31 - This can fail.
-		LARGE_INTEGER frequency;
-		QueryPerformanceFrequency(&frequency);
-	
-		// Convert to our form.
-		time.m_seconds = ticks.QuadPart / frequency.QuadPart;
-		time.m_nanoseconds = ((ticks.QuadPart % frequency.QuadPart) * 1'000'000'000) / 
-			frequency.QuadPart;
-		
-	#elif defined (__linux__)
-
-		// NOTE - STL 2012/09/23 - This can fail.
-		timespec timeValue;
-		clock_gettime(CLOCK_REALTIME, &timeValue);
-
-		time.m_seconds = timeValue.tv_sec;
-		time.m_nanoseconds = timeValue.tv_nsec;
-
-	#endif // defined (_WIN32)
+	auto const steadyTime = std::chrono::steady_clock::now();
+	return Time(std::chrono::duration_cast<TimerClock::duration>(steadyTime.time_since_epoch()));
 }
 
-// Get the elapsed time in milliseconds between to times.
-// Note: Will return -1 if the end time is less than the start time.
-//
-// startTime:	Start time.
-// endTime:		End time.
+// TimerClock members
+
+// Get the current time.
 //
-float TimerGetElapsedMilliseconds(Time const& startTime, Time const& endTime)
+Time TimerClock::now()
 {
-	// For now just return a negative sentinel if the end time is before the start time.
-	if (endTime < startTime)
+	if (s_clockSource == kTimerClockSourceSimulated)
 	{
-		return -1.0f;
+		std::lock_guard<std::mutex> const simulatedTimeGuard(s_simulatedTimeMutex);
+		return s_simulatedTime;
 	}
 
-	// Calculate the elapsed time.
-	Time elapsedTime;
-	
-	elapsedTime.m_seconds = endTime.m_seconds - startTime.m_seconds;
-	
-	// Did the nanoseconds wrap into seconds?
-	if (endTime.m_nanoseconds < startTime.m_nanoseconds)
+	return TimerGetCurrentReal();
+}
+
+// Choose where the current time comes from. Switching to the simulated clock starts it at the
+// current real time.
+//
+// clockSource:	The clock source to use.
+//
+void TimerSetClockSource(TimerClockSource clockSource)
+{
+	if (clockSource == kTimerClockSourceSimulated)
 	{
-		// Borrow a second.
-		elapsedTime.m_seconds--;
-		
-		// Add a billion nanoseconds in exchange.
-		elapsedTime.m_nanoseconds = endTime.m_nanoseconds + (1'000'000'000 - startTime.m_nanoseconds);
+		std::lock_guard<std::mutex> const simulatedTimeGuard(s_simulatedTimeMutex);
+
+		s_simulatedTime = TimerGetCurrentReal();
+		s_simulatedStartTime = s_simulatedTime;
+		s_simulatedStartCalendarTime = std::chrono::system_clock::now();
 	}
-	else
+
+	s_clockSource = clockSource;
+}
+
+// Get where the current time comes from.
+//
+TimerClockSource TimerGetClockSource()
+{
+	return s_clockSource;
+}
+
+// Set the time of the simulated clock. It only has an effect while the simulated clock is in use,
+// and times earlier than the current simulated time are ignored.
+//
+// time:	The new simulated time.
+//
+void TimerSetSimulatedTime(Time const& time)
+{
+	std::lock_guard<std::mutex> const simulatedTimeGuard(s_simulatedTimeMutex);
+	s_simulatedTime = std::max(s_simulatedTime, time);
+}
+
+// Advance the simulated clock. It only has an effect while the simulated clock is in use.
+//
+// duration:	How far to advance.
+//
+void TimerAdvanceSimulatedTime(TimerClock::duration duration)
+{
+	std::lock_guard<std::mutex> const simulatedTimeGuard(s_simulatedTimeMutex);
+	s_simulatedTime += std::max(duration, TimerClock::duration::zero());
+}
+
+// Get the current calendar time, from the same clock source as the current time.
+//
+// Returns:	The number of seconds since the epoch, like time().
+//
+std::time_t TimerGetCurrentCalendarTime()
+{
+	if (s_clockSource == kTimerClockSourceSimulated)
 	{
-		elapsedTime.m_nanoseconds = endTime.m_nanoseconds - startTime.m_nanoseconds;
+		std::lock_guard<std::mutex> const simulatedTimeGuard(s_simulatedTimeMutex);
+
+		auto const elapsedTime = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+			s_simulatedTime - s_simulatedStartTime);
+		return std::chrono::system_clock::to_time_t(s_simulatedStartCalendarTime + elapsedTime);
 	}
-	
-	// Convert to milliseconds.
-	float const elapsedTimeMS = (1.0e3f * elapsedTime.m_seconds) +
-										 (elapsedTime.m_nanoseconds / 1.0e6f);
 
-	return elapsedTimeMS;
+	return std::time(nullptr);
+}
+
+// Convert a calendar time to the corresponding point in time on the timer clock.
+//
+// calendarTime:	The number of seconds since the epoch, like time().
+//
+// Returns:	The time.
+//
+Time TimerGetTimeFromCalendarTime(std::time_t calendarTime)
+{
+	// The clocks aren't related, so go by how far away the calendar time is from now.
+	auto const currentTime = TimerClock::now();
+	auto const currentCalendarTime = TimerGetCurrentCalendarTime();
+
+	return currentTime + std::chrono::seconds(calendarTime - currentCalendarTime);
 }
@@ -1,49 +1,76 @@
 #pragma once
 
-#include <stdint.h>
+#include <chrono>
+#include <ctime>
 
 // Types
 //
 
-// Represents a point in time useful for elapsed time.
-struct Time
+// A monotonic clock for measuring elapsed time and scheduling. It reads from the steady system
+// clock, so it is unaffected by changes to the wall clock, unless the simulated clock source is in
+// use, in which case it only moves when told to.
+struct TimerClock
 {
-	// The portion of the time in seconds.
-	uint64_t m_seconds = 0;
-	
-	// The portion of the time in nanoseconds.
-	uint64_t m_nanoseconds = 0;	
-
-	friend auto operator<(const Time& left, const Time& right)
-	{
-		if (left.m_seconds != right.m_seconds)
-		{
-			return left.m_seconds < right.m_seconds;
-		}
-
-		return left.m_nanoseconds < right.m_nanoseconds;
-	}
-
-	friend auto operator>(const Time& left, const Time& right)
-	{
-		return right < left;
-	}
+	using duration = std::chrono::nanoseconds;
+	using rep = duration::rep;
+	using period = duration::period;
+	using time_point = std::chrono::time_point<TimerClock>;
+
+	// The simulated clock is never allowed to move backward.
+	static constexpr bool is_steady = true;
+
+	// Get the current time.
+	//
+	static time_point now();
+};
+
+// Represents a point in time useful for elapsed time.
+using Time = TimerClock::time_point;
 
+// Where the current time comes from.
+enum TimerClockSource
+{
+	kTimerClockSourceReal = 0,	// The system clock.
+	kTimerClockSourceSimulated,	// A clock that only moves when it is told to.
 };
 
 // Functions
 //
 
-// Get the current time.
+// Choose where the current time comes from. Switching to the simulated clock starts it at the
+// current real time.
 //
-// time:	(Output) The current time.
+// clockSource:	The clock source to use.
 //
-void TimerGetCurrent(Time& time);
+void TimerSetClockSource(TimerClockSource clockSource);
 
-// Get the elapsed time in milliseconds between two times.
-// Note: Will return -1 if the end time is less than the start time.
+// Get where the current time comes from.
+//
+TimerClockSource TimerGetClockSource();
+
+// Set the time of the simulated clock. It only has an effect while the simulated clock is in use,
+// and times earlier than the current simulated time are ignored.
+//
+// time:	The new simulated time.
+//
+void TimerSetSimulatedTime(Time const& time);
+
+// Advance the simulated clock. It only has an effect while the simulated clock is in use.
+//
+// duration:	How far to advance.
+//
+void TimerAdvanceSimulatedTime(TimerClock::duration duration);
+
+// Get the current calendar time, from the same clock source as the current time.
+//
+// Returns:	The number of seconds since the epoch, like time().
+//
+std::time_t TimerGetCurrentCalendarTime();
+
+// Convert a calendar time to the corresponding point in time on the timer clock.
+//
+// calendarTime:	The number of seconds since the epoch, like time().
 //
-// startTime:	Start time.
-// endTime:		End time.
+// Returns:	The time.
 //
-float TimerGetElapsedMilliseconds(Time const& startTime, Time const& endTime);
+Time TimerGetTimeFromCalendarTime(std::time_t calendarTime);
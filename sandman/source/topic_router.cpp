@@ -0,0 +1,237 @@
+#include "topic_router.h"
+
+// Functions
+//
+
+// TopicRouter members
+
+// Register a handler for every topic that matches a pattern.
+//
+// pattern:	The pattern.
+// handler:	Called for each message on a matching topic.
+//
+// Returns:	True on success, false if the pattern is malformed.
+//
+bool TopicRouter::Add(std::string_view pattern, TopicHandler const& handler)
+{
+	if (pattern.empty() == true)
+	{
+		return false;
+	}
+
+	// Validate the whole pattern first, so that a malformed one doesn't leave nodes behind.
+	for (std::string_view::size_type segmentStart = 0u; segmentStart != std::string_view::npos; )
+	{
+		auto const separator = pattern.find('/', segmentStart);
+		auto const segment = pattern.substr(segmentStart, (separator == std::string_view::npos) ?
+			std::string_view::npos : separator - segmentStart);
+
+		auto const isWildcard = (segment == "+") || (segment == "#");
+
+		// Wildcards have to be whole segments.
+		if ((isWildcard == false) && (segment.find_first_of("+#") != std::string_view::npos))
+		{
+			return false;
+		}
+
+		// Nothing can follow a multi-level wildcard.
+		if ((segment == "#") && (separator != std::string_view::npos))
+		{
+			return false;
+		}
+
+		segmentStart = (separator == std::string_view::npos) ? separator : separator + 1u;
+	}
+
+	if (m_nodes.empty() == true)
+	{
+		m_nodes.emplace_back();
+	}
+
+	auto const handlerIndex = static_cast<unsigned int>(m_handlers.size());
+	m_handlers.push_back(handler);
+	m_patterns.emplace_back(pattern);
+
+	// Walk down the tree, adding whatever nodes are missing.
+	unsigned int nodeIndex = 0u;
+
+	for (std::string_view::size_type segmentStart = 0u; segmentStart != std::string_view::npos; )
+	{
+		auto const separator = pattern.find('/', segmentStart);
+		auto const segment = pattern.substr(segmentStart, (separator == std::string_view::npos) ?
+			std::string_view::npos : separator - segmentStart);
+
+		segmentStart = (separator == std::string_view::npos) ? separator : separator + 1u;
+
+		if (segment == "#")
+		{
+			m_nodes[nodeIndex].m_multiLevelHandlerIndices.push_back(handlerIndex);
+			return true;
+		}
+
+		auto childIndex = kNoNode;
+
+		if (segment == "+")
+		{
+			childIndex = m_nodes[nodeIndex].m_singleLevelChild;
+		}
+		else
+		{
+			for (auto const& [childSegment, exactChildIndex] : m_nodes[nodeIndex].m_exactChildren)
+			{
+				if (childSegment == segment)
+				{
+					childIndex = exactChildIndex;
+					break;
+				}
+			}
+		}
+
+		if (childIndex == kNoNode)
+		{
+			childIndex = static_cast<unsigned int>(m_nodes.size());
+
+			// This may move the nodes, so nothing refers to them across it.
+			m_nodes.emplace_back();
+
+			if (segment == "+")
+			{
+				m_nodes[nodeIndex].m_singleLevelChild = childIndex;
+			}
+			else
+			{
+				m_nodes[nodeIndex].m_exactChildren.emplace_back(std::string(segment), childIndex);
+			}
+		}
+
+		nodeIndex = childIndex;
+	}
+
+	m_nodes[nodeIndex].m_handlerIndices.push_back(handlerIndex);
+	return true;
+}
+
+// Remove all of the patterns and their handlers.
+//
+void TopicRouter::Clear()
+{
+	m_nodes.clear();
+	m_handlers.clear();
+	m_patterns.clear();
+}
+
+// Call the handler of every pattern that matches a topic, in no particular order. Handlers may
+// parse the payload in place, so when patterns overlap, all but one of them get their own copy.
+//
+// topic:		The topic the message was published to.
+// payload:	(Input/Output) The null terminated message payload.
+//
+// Returns:	The number of handlers that were called.
+//
+unsigned int TopicRouter::Dispatch(std::string_view topic, char* payload) const
+{
+	unsigned int handlerCount = 0u;
+
+	// Each handler is held back until the next match turns up, so that the payload is copied only
+	// when there is more than one, and the last one can have the original.
+	auto pendingHandlerIndex = kNoHandler;
+
+	auto const CallHandler = [&](unsigned int handlerIndex)
+	{
+		if (pendingHandlerIndex != kNoHandler)
+		{
+			std::string payloadCopy(payload);
+			m_handlers[pendingHandlerIndex](topic, payloadCopy.data());
+		}
+
+		pendingHandlerIndex = handlerIndex;
+		handlerCount++;
+	};
+
+	if (m_nodes.empty() == false)
+	{
+		VisitMatches(0u, topic, 0u, CallHandler);
+	}
+
+	if (pendingHandlerIndex != kNoHandler)
+	{
+		m_handlers[pendingHandlerIndex](topic, payload);
+	}
+
+	return handlerCount;
+}
+
+// Find out whether any pattern matches a topic, without calling any handlers.
+//
+// topic:	The topic.
+//
+// Returns:	True if a pattern matches, false otherwise.
+//
+bool TopicRouter::Matches(std::string_view topic) const
+{
+	auto matched = false;
+
+	auto const NoteMatch = [&](unsigned int /* handlerIndex */)
+	{
+		matched = true;
+	};
+
+	if (m_nodes.empty() == false)
+	{
+		VisitMatches(0u, topic, 0u, NoteMatch);
+	}
+
+	return matched;
+}
+
+// Call a visitor with the handler index of every pattern, from a node on down, that matches the
+// rest of a topic.
+//
+// nodeIndex:		The node to start from.
+// topic:			The whole topic.
+// segmentStart:	Where the next segment starts in the topic, or npos if there are none left.
+// visitor:			Called with each matching handler index.
+//
+template <typename VisitorType>
+void TopicRouter::VisitMatches(unsigned int nodeIndex, std::string_view topic,
+										 std::string_view::size_type segmentStart,
+										 VisitorType& visitor) const
+{
+	auto const& node = m_nodes[nodeIndex];
+
+	// A multi-level wildcard matches whatever is left, even if nothing is.
+	for (auto const handlerIndex : node.m_multiLevelHandlerIndices)
+	{
+		visitor(handlerIndex);
+	}
+
+	if (segmentStart == std::string_view::npos)
+	{
+		for (auto const handlerIndex : node.m_handlerIndices)
+		{
+			visitor(handlerIndex);
+		}
+
+		return;
+	}
+
+	auto const separator = topic.find('/', segmentStart);
+	auto const segment = topic.substr(segmentStart, (separator == std::string_view::npos) ?
+		std::string_view::npos : separator - segmentStart);
+	auto const nextSegmentStart = (separator == std::string_view::npos) ? separator :
+		separator + 1u;
+
+	for (auto const& [childSegment, childIndex] : node.m_exactChildren)
+	{
+		if (childSegment == segment)
+		{
+			VisitMatches(childIndex, topic, nextSegmentStart, visitor);
+			break;
+		}
+	}
+
+	if (node.m_singleLevelChild != kNoNode)
+	{
+		VisitMatches(node.m_singleLevelChild, topic, nextSegmentStart, visitor);
+	}
+}
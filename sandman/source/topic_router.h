@@ -0,0 +1,114 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Types
+//
+
+// Called when a message arrives on a topic that matches a registered pattern.
+//
+// topic:		The topic the message was published to.
+// payload:	(Input/Output) The null terminated message payload, which the handler may change,
+//				such as by parsing it in place.
+//
+using TopicHandler = std::function<void(std::string_view topic, char* payload)>;
+
+// Hands messages to the handlers registered for the topics they arrive on. Patterns are MQTT topic
+// filters, split into segments by "/". A "+" segment matches any one segment, and a "#" segment,
+// which must come last, matches any number of segments, including none. The patterns are kept in a
+// tree of segments, so a topic is matched against all of them in one pass over its segments.
+//
+class TopicRouter
+{
+	public:
+
+		// Register a handler for every topic that matches a pattern.
+		//
+		// pattern:	The pattern.
+		// handler:	Called for each message on a matching topic.
+		//
+		// Returns:	True on success, false if the pattern is malformed.
+		//
+		bool Add(std::string_view pattern, TopicHandler const& handler);
+
+		// Remove all of the patterns and their handlers.
+		//
+		void Clear();
+
+		// Call the handler of every pattern that matches a topic, in no particular order. Handlers
+		// may parse the payload in place, so when patterns overlap, all but one of them get their
+		// own copy.
+		//
+		// topic:		The topic the message was published to.
+		// payload:	(Input/Output) The null terminated message payload.
+		//
+		// Returns:	The number of handlers that were called.
+		//
+		unsigned int Dispatch(std::string_view topic, char* payload) const;
+
+		// Find out whether any pattern matches a topic, without calling any handlers.
+		//
+		// topic:	The topic.
+		//
+		// Returns:	True if a pattern matches, false otherwise.
+		//
+		bool Matches(std::string_view topic) const;
+
+		// Get the patterns that have been registered, in the order they were added.
+		//
+		std::vector<std::string> const& GetPatterns() const
+		{
+			return m_patterns;
+		}
+
+	private:
+
+		// Constants.
+
+		// Marks a child node that doesn't exist.
+		static constexpr unsigned int kNoNode{ ~0u };
+
+		// Marks a handler that doesn't exist.
+		static constexpr unsigned int kNoHandler{ ~0u };
+
+		// A segment of the patterns. The root node comes before the first segment.
+		struct Node
+		{
+			// The children for exact segments, along with those segments.
+			std::vector<std::pair<std::string, unsigned int>> m_exactChildren;
+
+			// The child for a "+" segment.
+			unsigned int m_singleLevelChild = kNoNode;
+
+			// The handlers of the patterns that end here.
+			std::vector<unsigned int> m_handlerIndices;
+
+			// The handlers of the patterns that end with a "#" segment after this one.
+			std::vector<unsigned int> m_multiLevelHandlerIndices;
+		};
+
+		// Call a visitor with the handler index of every pattern, from a node on down, that matches
+		// the rest of a topic.
+		//
+		// nodeIndex:		The node to start from.
+		// topic:			The whole topic.
+		// segmentStart:	Where the next segment starts in the topic, or npos if there are none left.
+		// visitor:			Called with each matching handler index.
+		//
+		template <typename VisitorType>
+		void VisitMatches(unsigned int nodeIndex, std::string_view topic,
+								std::string_view::size_type segmentStart, VisitorType& visitor) const;
+
+		// The nodes of the tree, with the root first.
+		std::vector<Node> m_nodes;
+
+		// The handlers, indexed by the order their patterns were added.
+		std::vector<TopicHandler> m_handlers;
+
+		// The patterns, in the order they were added.
+		std::vector<std::string> m_patterns;
+};
@@ -1,9 +1,30 @@
 #include "catch_amalgamated.hpp"
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "command.h"
+#include "common/ring_buffer.h"
+#include "common/slot_queue.h"
 #include "config.h"
 #include "gpio.h"
+#include "gpio_driver.h"
+#include "intent.h"
 #include "logger.h"
+#include "rapidjson/document.h"
 #include "routines.h"
+#include "reactor.h"
+#include "scheduler.h"
+#include "server.h"
+#include "stats.h"
+#include "timer.h"
+#include "topic_router.h"
 
 class TestRunListener : public Catch::EventListenerBase
 {
@@ -67,8 +88,16 @@ TEST_CASE("Test default config", "[config]")
 
 	REQUIRE(config.GetControlMaxMovingDurationMS() == 100000);
 	REQUIRE(config.GetControlCoolDownDurationMS() == 25);
+	REQUIRE(config.GetControlActuationThreadEnabled() == false);
+	REQUIRE(config.GetControlActuationThreadPriority() == 50);
+	REQUIRE(config.GetControlImmediateActuationEnabled() == false);
+	REQUIRE(config.GetMQTTThreadEnabled() == false);
+
+	std::vector<InputDeviceConfig> const& inputDeviceConfigs = config.GetInputDeviceConfigs();
+	REQUIRE(inputDeviceConfigs.size() == 1);
+	REQUIRE(std::string(inputDeviceConfigs[0].m_deviceName) == "");
 
-	std::vector<InputBinding> const& inputBindings = config.GetInputBindings();
+	std::vector<InputBinding> const& inputBindings = inputDeviceConfigs[0].m_bindings;
 	REQUIRE(inputBindings.size() == 6);
 	if (inputBindings.size() > 5)
 	{
@@ -105,6 +134,268 @@ TEST_CASE("Test default config", "[config]")
 	}
 }
 
+TEST_CASE("Test multiple input devices config", "[config]")
+{
+	auto const configFileName = std::string(SANDMAN_TEST_BUILD_DIR) + "input_devices.conf";
+
+	{
+		std::ofstream configFile(configFileName);
+		configFile << R"({
+			"controlSettings" : { "controls" : [] },
+			"inputSettings" : {
+				"inputDevices" : [
+					{
+						"device" : "/dev/input/event1",
+						"bindings" : [
+							{ "keyCode" : 310, "controlAction" : { "control" : "back", "action" : "up" } }
+						]
+					},
+					{ "bindings" : [] },
+					{
+						"device" : "/dev/input/event2",
+						"exclusive" : true,
+						"bindings" : []
+					}
+				]
+			}
+		})";
+	}
+
+	Config config;
+	REQUIRE(config.ReadFromFile(configFileName.c_str()) == true);
+
+	// The device without a name is skipped.
+	auto const& inputDeviceConfigs = config.GetInputDeviceConfigs();
+	REQUIRE(inputDeviceConfigs.size() == 2);
+	REQUIRE(std::string(inputDeviceConfigs[0].m_deviceName) == "/dev/input/event1");
+	REQUIRE(inputDeviceConfigs[0].m_bindings.size() == 1);
+	REQUIRE(inputDeviceConfigs[0].m_exclusive == false);
+	REQUIRE(std::string(inputDeviceConfigs[1].m_deviceName) == "/dev/input/event2");
+	REQUIRE(inputDeviceConfigs[1].m_bindings.empty() == true);
+	REQUIRE(inputDeviceConfigs[1].m_exclusive == true);
+}
+
+TEST_CASE("Test input gestures", "[input]")
+{
+	auto const configFileName = std::string(SANDMAN_TEST_BUILD_DIR) + "input_gestures.conf";
+
+	{
+		std::ofstream configFile(configFileName);
+		configFile << R"({
+			"controlSettings" : { "controls" : [] },
+			"inputSettings" : {
+				"chordWindowMS" : 100,
+				"longPressDurationMS" : 1000,
+				"doubleTapWindowMS" : 300,
+				"inputDevices" : [
+					{
+						"device" : "/dev/input/event1",
+						"bindings" : [],
+						"gestures" : [
+							{ "gesture" : "chord", "keyCodes" : [310, 311] },
+							{ "gesture" : "longPress", "keyCode" : 308 },
+							{
+								"gesture" : "doubleTap",
+								"keyCode" : 307,
+								"controlAction" : { "control" : "elev", "action" : "up" }
+							},
+							{ "gesture" : "chord", "keyCodes" : [310] },
+							{ "gesture" : "doubleTap", "keyCode" : 304 }
+						]
+					}
+				]
+			}
+		})";
+	}
+
+	Config config;
+	REQUIRE(config.ReadFromFile(configFileName.c_str()) == true);
+
+	auto const& timings = config.GetInputGestureTimings();
+	REQUIRE(timings.m_chordWindowMS == 100);
+	REQUIRE(timings.m_longPressDurationMS == 1000);
+	REQUIRE(timings.m_doubleTapWindowMS == 300);
+
+	// The chord with one key and the double tap without a control action are skipped.
+	REQUIRE(config.GetInputDeviceConfigs().size() == 1);
+	auto const& gestures = config.GetInputDeviceConfigs()[0].m_gestures;
+	REQUIRE(gestures.size() == 3);
+	REQUIRE(gestures[0].m_type == InputGesture::kTypeChord);
+	REQUIRE(gestures[0].m_action == InputGesture::kActionStopAll);
+	REQUIRE(gestures[1].m_type == InputGesture::kTypeLongPress);
+	REQUIRE(gestures[1].m_action == InputGesture::kActionStartRoutine);
+	REQUIRE(gestures[2].m_type == InputGesture::kTypeDoubleTap);
+	REQUIRE(gestures[2].m_action == InputGesture::kActionMoveControl);
+
+	InputGestureRecognizer recognizer;
+	recognizer.Initialize(gestures, timings);
+
+	using namespace std::chrono_literals;
+	static constexpr auto kNoGesture = InputGestureRecognizer::kNoGesture;
+
+	// Chords need both keys pressed close together.
+	REQUIRE(recognizer.HandleKeyPressed(310, 0ms) == kNoGesture);
+	REQUIRE(recognizer.HandleKeyPressed(311, 50ms) == 0u);
+	recognizer.HandleKeyReleased(310);
+	recognizer.HandleKeyReleased(311);
+
+	REQUIRE(recognizer.HandleKeyPressed(310, 1'000ms) == kNoGesture);
+	REQUIRE(recognizer.HandleKeyPressed(311, 1'200ms) == kNoGesture);
+	recognizer.HandleKeyReleased(310);
+	recognizer.HandleKeyReleased(311);
+
+	// Long presses are made by time passing while the key is held, and only once per press.
+	InputEventTime longPressTime;
+	REQUIRE(recognizer.GetNextLongPressTime(longPressTime) == false);
+	REQUIRE(recognizer.HandleKeyPressed(308, 2'000ms) == kNoGesture);
+	REQUIRE(recognizer.GetNextLongPressTime(longPressTime) == true);
+	REQUIRE(longPressTime == 3'000ms);
+	REQUIRE(recognizer.HandleTime(2'999ms) == kNoGesture);
+	REQUIRE(recognizer.HandleTime(3'000ms) == 1u);
+	REQUIRE(recognizer.HandleTime(3'500ms) == kNoGesture);
+	REQUIRE(recognizer.GetNextLongPressTime(longPressTime) == false);
+	recognizer.HandleKeyReleased(308);
+
+	REQUIRE(recognizer.HandleKeyPressed(308, 4'000ms) == kNoGesture);
+	recognizer.HandleKeyReleased(308);
+	REQUIRE(recognizer.HandleTime(5'000ms) == kNoGesture);
+
+	// Double taps need the second press to come quickly, and a third tap starts over.
+	REQUIRE(recognizer.HandleKeyPressed(307, 6'000ms) == kNoGesture);
+	recognizer.HandleKeyReleased(307);
+	REQUIRE(recognizer.HandleKeyPressed(307, 6'500ms) == kNoGesture);
+	recognizer.HandleKeyReleased(307);
+	REQUIRE(recognizer.HandleKeyPressed(307, 6'700ms) == 2u);
+	recognizer.HandleKeyReleased(307);
+	REQUIRE(recognizer.HandleKeyPressed(307, 6'800ms) == kNoGesture);
+	recognizer.HandleKeyReleased(307);
+
+	// Resetting forgets held keys and pending taps.
+	REQUIRE(recognizer.HandleKeyPressed(308, 7'000ms) == kNoGesture);
+	recognizer.Reset();
+	REQUIRE(recognizer.GetNextLongPressTime(longPressTime) == false);
+}
+
+TEST_CASE("Test input key repeat", "[input]")
+{
+	// What the keys asked a control to do.
+	struct ControlChange
+	{
+		ControlHandle m_controlHandle;
+		Control::Actions m_action;
+		Time m_time;
+		StatsLatencyID m_latencyID;
+	};
+
+	std::vector<ControlChange> changes;
+	auto const RecordChange = [&changes](ControlHandle controlHandle, Control::Actions action,
+													 Time const& time, StatsLatencyID latencyID)
+	{
+		changes.push_back({ controlHandle, action, time, latencyID });
+	};
+
+	static constexpr unsigned short kUpKeyCode{ 310 };
+	static constexpr unsigned short kDownKeyCode{ 311 };
+	static constexpr unsigned short kOtherKeyCode{ 312 };
+	static constexpr StatsLatencyID kUpLatencyID{ 1 };
+	static constexpr StatsLatencyID kDownLatencyID{ 2 };
+
+	InputKeyTracker tracker;
+	tracker.Bind(kUpKeyCode, 0u, Control::kActionMovingUp, kUpLatencyID);
+	tracker.Bind(kDownKeyCode, 0u, Control::kActionMovingDown, kDownLatencyID);
+	tracker.Bind(kOtherKeyCode, 2u, Control::kActionMovingUp, kStatsNoLatency);
+
+	using namespace std::chrono_literals;
+	auto const startTime = TimerClock::now();
+
+	// Pressing a key starts its control, measured from the press.
+	tracker.HandleKeyEvent(kUpKeyCode, 1, startTime);
+	tracker.ApplyChanges(RecordChange);
+	REQUIRE(changes.size() == 1);
+	REQUIRE(changes[0].m_controlHandle == 0u);
+	REQUIRE(changes[0].m_action == Control::kActionMovingUp);
+	REQUIRE(changes[0].m_time == startTime);
+	REQUIRE(changes[0].m_latencyID == kUpLatencyID);
+
+	// Autorepeat arrives every so often while the key is held, and changes nothing.
+	for (auto repeatTime = startTime + 250ms; repeatTime < startTime + 2s; repeatTime += 33ms)
+	{
+		tracker.HandleKeyEvent(kUpKeyCode, 2, repeatTime);
+		tracker.ApplyChanges(RecordChange);
+	}
+
+	REQUIRE(changes.size() == 1);
+
+	// Letting go stops the control, measured from the release.
+	tracker.HandleKeyEvent(kUpKeyCode, 0, startTime + 2s);
+	tracker.HandleKeyEvent(kUpKeyCode, 0, startTime + 2s);
+	tracker.ApplyChanges(RecordChange);
+	REQUIRE(changes.size() == 2);
+	REQUIRE(changes[1].m_action == Control::kActionStopped);
+	REQUIRE(changes[1].m_time == startTime + 2s);
+	changes.clear();
+
+	// All of the events handled before the changes are applied change each control at most once,
+	// to whatever the last of them wanted.
+	tracker.HandleKeyEvent(kUpKeyCode, 1, startTime + 3s);
+	tracker.HandleKeyEvent(kUpKeyCode, 2, startTime + 3s + 10ms);
+	tracker.HandleKeyEvent(kUpKeyCode, 0, startTime + 3s + 20ms);
+	tracker.HandleKeyEvent(kUpKeyCode, 1, startTime + 3s + 30ms);
+	tracker.HandleKeyEvent(kDownKeyCode, 1, startTime + 3s + 40ms);
+	tracker.HandleKeyEvent(kOtherKeyCode, 1, startTime + 3s + 50ms);
+	tracker.HandleKeyEvent(kOtherKeyCode, 2, startTime + 3s + 60ms);
+	tracker.ApplyChanges(RecordChange);
+	REQUIRE(changes.size() == 2);
+	REQUIRE(changes[0].m_controlHandle == 0u);
+	REQUIRE(changes[0].m_action == Control::kActionMovingDown);
+	REQUIRE(changes[0].m_time == startTime + 3s + 40ms);
+	REQUIRE(changes[0].m_latencyID == kDownLatencyID);
+	REQUIRE(changes[1].m_controlHandle == 2u);
+	REQUIRE(changes[1].m_action == Control::kActionMovingUp);
+	changes.clear();
+
+	// Letting go of a key that was overridden leaves the control to the one that's still held.
+	tracker.HandleKeyEvent(kUpKeyCode, 0, startTime + 4s);
+	tracker.ApplyChanges(RecordChange);
+	REQUIRE(changes.empty() == true);
+
+	// Letting go and pressing again before the changes are applied changes nothing.
+	tracker.HandleKeyEvent(kDownKeyCode, 0, startTime + 5s);
+	tracker.HandleKeyEvent(kDownKeyCode, 1, startTime + 5s + 10ms);
+	tracker.ApplyChanges(RecordChange);
+	REQUIRE(changes.empty() == true);
+
+	// Unbound keys are ignored, even ones beyond the bound key codes.
+	tracker.HandleKeyEvent(309, 1, startTime + 6s);
+	tracker.HandleKeyEvent(1'000, 1, startTime + 6s);
+	tracker.ApplyChanges(RecordChange);
+	REQUIRE(changes.empty() == true);
+
+	// Letting go of everything stops the controls that keys were moving, without a latency.
+	tracker.ReleaseAllKeys(startTime + 7s);
+	tracker.ApplyChanges(RecordChange);
+	REQUIRE(changes.size() == 2);
+	REQUIRE(changes[0].m_action == Control::kActionStopped);
+	REQUIRE(changes[0].m_latencyID == kStatsNoLatency);
+	REQUIRE(changes[1].m_action == Control::kActionStopped);
+	changes.clear();
+
+	// The releases that follow, and the autorepeat of a key that was stopped, change nothing.
+	tracker.HandleKeyEvent(kDownKeyCode, 2, startTime + 8s);
+	tracker.HandleKeyEvent(kDownKeyCode, 0, startTime + 8s);
+	tracker.HandleKeyEvent(kOtherKeyCode, 0, startTime + 8s);
+	tracker.ApplyChanges(RecordChange);
+	REQUIRE(changes.empty() == true);
+
+	// Neither does a key whose control was stopped by something else.
+	tracker.HandleKeyEvent(kUpKeyCode, 1, startTime + 9s);
+	tracker.StopAll();
+	tracker.HandleKeyEvent(kUpKeyCode, 0, startTime + 9s + 100ms);
+	tracker.SetControlAction(1u, Control::kActionMovingDown);
+	tracker.ApplyChanges(RecordChange);
+	REQUIRE(changes.empty() == true);
+}
+
 TEST_CASE("Test missing routine", "[routines]")
 {
 	Routine routine;
@@ -193,5 +484,745 @@ TEST_CASE("Test controls", "[control]")
 		{
 			REQUIRE(elevationControl->GetState() == Control::kStateIdle);
 		}
+
+		// Handles should refer to the same controls as the names do.
+		{
+			REQUIRE(Control::GetHandleByName("chicken") == kInvalidControlHandle);
+			REQUIRE(Control::GetByHandle(kInvalidControlHandle) == nullptr);
+
+			auto const legHandle = Control::GetHandleByName("legs");
+			REQUIRE(legHandle != kInvalidControlHandle);
+			REQUIRE(Control::GetByHandle(legHandle) == legControl);
+
+			ControlAction controlAction("back", Control::kActionMovingUp);
+			REQUIRE(controlAction.GetControl() == nullptr);
+			REQUIRE(controlAction.Resolve() == true);
+			REQUIRE(controlAction.GetControl() == backControl);
+
+			ControlAction unknownControlAction("chicken", Control::kActionMovingUp);
+			REQUIRE(unknownControlAction.Resolve() == false);
+			REQUIRE(unknownControlAction.GetControl() == nullptr);
+		}
+
+		// Idle controls shouldn't need any attention.
+		Time deadline;
+		REQUIRE(ControlsGetNextDeadline(deadline) == false);
+
+		// A desired action should be acted upon the next time the controls are processed.
+		if (legControl != nullptr)
+		{
+			legControl->SetDesiredAction(Control::kActionMovingUp, Control::kModeManual);
+			ControlsProcess();
+			REQUIRE(legControl->GetState() == Control::kStateMovingUp);
+			REQUIRE(ControlsGetNextDeadline(deadline) == true);
+
+			legControl->SetDesiredAction(Control::kActionStopped, Control::kModeManual);
+			ControlsProcess();
+			REQUIRE(legControl->GetState() == Control::kStateCoolDown);
+		}
+
+		// With immediate actuation, requests should be acted upon before they return, but still
+		// follow the rules.
+		if (backControl != nullptr)
+		{
+			Control::SetImmediateActuation(true);
+
+			backControl->SetDesiredAction(Control::kActionMovingDown, Control::kModeManual);
+			REQUIRE(backControl->GetState() == Control::kStateMovingDown);
+
+			backControl->SetDesiredAction(Control::kActionMovingUp, Control::kModeManual);
+			REQUIRE(backControl->GetState() == Control::kStateMovingUp);
+
+			ControlsStopAll();
+			REQUIRE(backControl->GetState() == Control::kStateCoolDown);
+
+			// Cooling down controls don't move.
+			backControl->SetDesiredAction(Control::kActionMovingUp, Control::kModeManual);
+			REQUIRE(backControl->GetState() == Control::kStateCoolDown);
+
+			Control::SetImmediateActuation(false);
+		}
+
+		// The time from a request to the pins changing is recorded as a latency, measured from when
+		// the request says it happened.
+		if (elevationControl != nullptr)
+		{
+			Control::SetImmediateActuation(true);
+			StatsReset();
+
+			auto const latencyID = StatsAddLatency("test:elev");
+			REQUIRE(latencyID != kStatsNoLatency);
+
+			using namespace std::chrono_literals;
+			elevationControl->SetDesiredAction(Control::kActionMovingUp, Control::kModeManual, 100u,
+														  TimerClock::now() - 20ms, latencyID);
+			REQUIRE(elevationControl->GetState() == Control::kStateMovingUp);
+
+			unsigned long long count = 0;
+			double p50MS = 0.0;
+			auto const ReadLatency = [&count, &p50MS]()
+			{
+				std::string summary;
+				StatsGetSummary(summary);
+
+				auto const lineStart = summary.find("test:elev");
+				REQUIRE(lineStart != std::string::npos);
+				REQUIRE(std::sscanf(summary.c_str() + lineStart, "test:elev %llu %lf", &count,
+										  &p50MS) == 2);
+			};
+
+			ReadLatency();
+			REQUIRE(count == 1);
+			REQUIRE(p50MS >= 20.0);
+
+			// If the pins can't be set, nothing is announced or recorded, and setting them is tried
+			// again, even once the control has gone idle, until it works.
+			auto* const driver = dynamic_cast<GPIORecordingDriver*>(GPIOGetDriver());
+			REQUIRE(driver != nullptr);
+			driver->SetFailing(true);
+
+			elevationControl->SetDesiredAction(Control::kActionStopped, Control::kModeManual, 0u,
+														  TimerClock::now(), latencyID);
+			REQUIRE(elevationControl->GetState() == Control::kStateCoolDown);
+
+			while (elevationControl->GetState() != Control::kStateIdle)
+			{
+				REQUIRE(ControlsGetNextDeadline(deadline) == true);
+				std::this_thread::sleep_until(deadline);
+				ControlsProcess();
+			}
+
+			REQUIRE(ControlsGetNextDeadline(deadline) == true);
+			ReadLatency();
+			REQUIRE(count == 1);
+
+			driver->SetFailing(false);
+			std::this_thread::sleep_until(deadline);
+			ControlsProcess();
+
+			REQUIRE(ControlsGetNextDeadline(deadline) == false);
+			ReadLatency();
+			REQUIRE(count == 2);
+
+			ControlsStopAll();
+			Control::SetImmediateActuation(false);
+		}
+
+		ControlsUninitialize();
+		GPIOUninitialize();
+	}
+}
+
+TEST_CASE("Test GPIO", "[gpio]")
+{
+	// Without hardware, the pins are recorded.
+	static constexpr bool kEnableGPIO = false;
+	GPIOInitialize(kEnableGPIO);
+
+	auto* const driver = dynamic_cast<GPIORecordingDriver*>(GPIOGetDriver());
+	REQUIRE(driver != nullptr);
+
+	// Pins start off, and a shared pin is only acquired once.
+	static constexpr int kPinOnValue = 0;
+	static constexpr int kPinOffValue = 1;
+
+	GPIOAcquireOutputPins({ 5, 6, 7, 5 });
+
+	int value = -1;
+	REQUIRE(driver->GetLineValue(5u, value) == true);
+	REQUIRE(value == kPinOffValue);
+	REQUIRE(driver->GetLineValue(8u, value) == false);
+	REQUIRE(driver->GetSetCount() == 0u);
+
+	// Each change on its own sets the lines.
+	GPIOSetPinOn(5);
+	REQUIRE(driver->GetSetCount() == 1u);
+	REQUIRE(driver->GetLineValue(5u, value) == true);
+	REQUIRE(value == kPinOnValue);
+
+	// Setting a pin to what it already is, or one that wasn't acquired, doesn't.
+	GPIOSetPinOn(5);
+	GPIOSetPinOn(8);
+	REQUIRE(driver->GetSetCount() == 1u);
+
+	// A batch sets the lines once, when it's done.
+	{
+		GPIOPinBatch const pinBatch;
+
+		GPIOSetPinOff(5);
+		GPIOSetPinOn(6);
+		GPIOSetPinOn(7);
+		REQUIRE(driver->GetSetCount() == 1u);
+	}
+
+	REQUIRE(driver->GetSetCount() == 2u);
+	REQUIRE(driver->GetLineValue(5u, value) == true);
+	REQUIRE(value == kPinOffValue);
+	REQUIRE(driver->GetLineValue(6u, value) == true);
+	REQUIRE(value == kPinOnValue);
+	REQUIRE(driver->GetLineValue(7u, value) == true);
+	REQUIRE(value == kPinOnValue);
+
+	GPIOUninitialize();
+	REQUIRE(GPIOGetDriver() == nullptr);
+}
+
+TEST_CASE("Test scheduler", "[scheduler]")
+{
+	using namespace std::chrono_literals;
+
+	Scheduler scheduler;
+
+	Time deadline;
+	REQUIRE(scheduler.GetNextDeadline(deadline) == false);
+
+	// Schedule some items out of order.
+	scheduler.Schedule(0, Time(30s));
+	scheduler.Schedule(1, Time(10s));
+	scheduler.Schedule(2, Time(20s));
+	scheduler.Schedule(3, Time(10s + 500ns));
+
+	REQUIRE(scheduler.GetNextDeadline(deadline) == true);
+	REQUIRE(deadline == Time(10s));
+
+	// Move one item earlier and cancel another.
+	scheduler.Schedule(0, Time(5s));
+	scheduler.Cancel(1);
+
+	// Nothing is due yet.
+	unsigned int id = 0;
+	REQUIRE(scheduler.PopExpired(Time(4s), id) == false);
+
+	// Items come out in deadline order, and only once they are due.
+	std::vector<unsigned int> ids;
+	while (scheduler.PopExpired(Time(25s), id) == true)
+	{
+		ids.push_back(id);
+	}
+
+	REQUIRE(ids == std::vector<unsigned int>{ 0, 3, 2 });
+	REQUIRE(scheduler.GetNextDeadline(deadline) == false);
+}
+
+TEST_CASE("Test command tokenizer", "[command]")
+{
+	// Case and extra whitespace don't matter, and alternative words are recognized.
+	CommandTokenList commandTokens;
+	CommandTokenizeString(commandTokens, "  Legs\tUP  50 bogus ");
+
+	REQUIRE(commandTokens.GetCount() == 4);
+	REQUIRE(commandTokens[0].m_type == CommandToken::kTypeLegs);
+	REQUIRE(commandTokens[1].m_type == CommandToken::kTypeRaise);
+	REQUIRE(commandTokens[2].m_type == CommandToken::kTypeInteger);
+	REQUIRE(commandTokens[2].m_parameter == 50);
+	REQUIRE(commandTokens[3].m_type == CommandToken::kTypeInvalid);
+
+	// Words that only start like keywords, or are longer than any, don't match.
+	commandTokens.Clear();
+	CommandTokenizeString(commandTokens, "backs stopped 12x elevationelevation");
+
+	REQUIRE(commandTokens.GetCount() == 4);
+
+	for (unsigned int tokenIndex = 0; tokenIndex < commandTokens.GetCount(); tokenIndex++)
+	{
+		CHECK(commandTokens[tokenIndex].m_type == CommandToken::kTypeInvalid);
+	}
+
+	// Anything past the capacity is dropped.
+	commandTokens.Clear();
+	CommandTokenizeString(commandTokens, "stop stop stop stop stop stop stop stop stop stop");
+
+	REQUIRE(commandTokens.GetCount() == CommandTokenList::kCapacity);
+
+	commandTokens.Clear();
+	CommandTokenizeString(commandTokens, "   ");
+	REQUIRE(commandTokens.IsEmpty() == true);
+}
+
+TEST_CASE("Test intent extraction", "[intent]")
+{
+	// Everything after the slots is left unparsed, so the broken tail doesn't matter.
+	char payload[] = R"({"input": "raise the legs", "intent": {"intentName": "MovePart", )"
+		R"("confidenceScore": 1.0}, "siteId": "default", "slots": [{"entity": "name", )"
+		R"("value": {"kind": "Unknown", "value": "legs"}, "slotName": "name", "rawValue": "legs"}, )"
+		R"({"slotName": "direction", "rawValue": "r\u0061ise", "range": {"start": 0}}], )"
+		R"("sessionId": "ignored", "asrTokens": [[{"value": )";
+
+	IntentMessage intent;
+	REQUIRE(IntentReadFromPayload(intent, payload, kIntentFieldIntentName | kIntentFieldSlots) ==
+			  true);
+
+	REQUIRE(intent.m_intentName == "MovePart");
+	REQUIRE(intent.m_sessionID.empty() == true);
+	REQUIRE(intent.m_slotCount == 2);
+	REQUIRE(intent.m_slots[0].m_name == "name");
+	REQUIRE(intent.m_slots[0].m_value == "legs");
+	REQUIRE(intent.m_slots[1].m_name == "direction");
+	REQUIRE(intent.m_slots[1].m_value == "raise");
+
+	CommandTokenList commandTokens;
+	CommandTokenizeIntent(commandTokens, intent);
+
+	REQUIRE(commandTokens.GetCount() == 2);
+	REQUIRE(commandTokens[0].m_type == CommandToken::kTypeLegs);
+	REQUIRE(commandTokens[1].m_type == CommandToken::kTypeRaise);
+
+	// Dialogue manager messages.
+	char sessionEndedPayload[] = R"({"sessionId": "abc", "siteId": "default", )"
+		R"("termination": {"reason": "nominal"}})";
+
+	IntentMessage sessionEnded;
+	REQUIRE(IntentReadFromPayload(sessionEnded, sessionEndedPayload,
+											kIntentFieldSessionID | kIntentFieldTermination) == true);
+	REQUIRE(sessionEnded.m_sessionID == "abc");
+	REQUIRE(sessionEnded.m_terminationReason == "nominal");
+
+	char invalidPayload[] = R"({"sessionId": )";
+	REQUIRE(IntentReadFromPayload(sessionEnded, invalidPayload, kIntentFieldSessionID) == false);
+}
+
+TEST_CASE("Test intent payload writing", "[intent]")
+{
+	// Quotes, backslashes, and control characters all have to be escaped to stay valid JSON.
+	std::string const sessionID = "abc\"123";
+	std::string const confirmationText = "Say \"yes\" to move C:\\back\tnow\x01?";
+
+	std::string const sessionPayload(IntentWriteSessionPayload(sessionID, confirmationText));
+
+	rapidjson::Document session;
+	session.Parse(sessionPayload.c_str());
+	REQUIRE(session.HasParseError() == false);
+	REQUIRE(session.IsObject() == true);
+	REQUIRE(session["sessionId"].IsString() == true);
+	REQUIRE(std::string(session["sessionId"].GetString()) == sessionID);
+	REQUIRE(session["text"].IsString() == true);
+	REQUIRE(std::string(session["text"].GetString()) == confirmationText);
+
+	// What we read back matches what was written.
+	std::vector<char> sessionBuffer(sessionPayload.begin(), sessionPayload.end());
+	sessionBuffer.push_back('\0');
+
+	IntentMessage message;
+	REQUIRE(IntentReadFromPayload(message, sessionBuffer.data(), kIntentFieldSessionID) == true);
+	REQUIRE(message.m_sessionID == sessionID);
+
+	std::string const notificationPayload(IntentWriteNotificationPayload(confirmationText));
+
+	rapidjson::Document notification;
+	notification.Parse(notificationPayload.c_str());
+	REQUIRE(notification.HasParseError() == false);
+	REQUIRE(std::string(notification["init"]["type"].GetString()) == "notification");
+	REQUIRE(std::string(notification["init"]["text"].GetString()) == confirmationText);
+	REQUIRE(std::string(notification["siteId"].GetString()) == "default");
+
+	std::string const textToSpeechPayload(IntentWriteTextToSpeechPayload(confirmationText));
+
+	rapidjson::Document textToSpeech;
+	textToSpeech.Parse(textToSpeechPayload.c_str());
+	REQUIRE(textToSpeech.HasParseError() == false);
+	REQUIRE(std::string(textToSpeech["text"].GetString()) == confirmationText);
+	REQUIRE(textToSpeech["lang"].IsNull() == true);
+}
+
+TEST_CASE("Test ring buffer", "[ring_buffer]")
+{
+	Common::RingBuffer<unsigned int, 4> ringBuffer;
+
+	unsigned int value = 0;
+	REQUIRE(ringBuffer.TryPop(value) == false);
+
+	// Fill it up.
+	for (unsigned int pushValue = 0; pushValue < 4; pushValue++)
+	{
+		REQUIRE(ringBuffer.TryPush(pushValue) == true);
+	}
+
+	REQUIRE(ringBuffer.TryPush(4) == false);
+
+	// Make room for one more, wrapping around.
+	REQUIRE(ringBuffer.TryPop(value) == true);
+	REQUIRE(value == 0);
+	REQUIRE(ringBuffer.TryPush(4) == true);
+
+	// Elements come out in the order they went in.
+	std::vector<unsigned int> values;
+	while (ringBuffer.TryPop(value) == true)
+	{
+		values.push_back(value);
+	}
+
+	REQUIRE(values == std::vector<unsigned int>{ 1, 2, 3, 4 });
+}
+
+TEST_CASE("Test slot queue", "[slot_queue]")
+{
+	struct Slot
+	{
+		unsigned int m_value = 0u;
+	};
+
+	static constexpr std::size_t kSlotCount{ 4u };
+	Common::SlotQueue<Slot, kSlotCount> queue;
+
+	// Fill every slot.
+	std::vector<unsigned int> acquiredSlotIndices;
+	for (unsigned int value = 0u; value < kSlotCount; value++)
+	{
+		unsigned int slotIndex = 0u;
+		REQUIRE(queue.TryAcquire(slotIndex) == true);
+		REQUIRE(slotIndex < kSlotCount);
+
+		queue.GetSlot(slotIndex).m_value = value;
+		queue.Queue(slotIndex);
+		acquiredSlotIndices.push_back(slotIndex);
+	}
+
+	std::sort(acquiredSlotIndices.begin(), acquiredSlotIndices.end());
+	REQUIRE(std::unique(acquiredSlotIndices.begin(), acquiredSlotIndices.end()) ==
+			  acquiredSlotIndices.end());
+
+	// Anything more is dropped and counted, without touching the queued slots.
+	unsigned int overflowSlotIndex = 0u;
+	REQUIRE(queue.TryAcquire(overflowSlotIndex) == false);
+	REQUIRE(queue.TryAcquire(overflowSlotIndex) == false);
+	REQUIRE(queue.TakeDroppedCount() == 2u);
+	REQUIRE(queue.TakeDroppedCount() == 0u);
+
+	// The slots come out in the order they were queued, still holding what was put in them.
+	unsigned int takenSlotIndex = 0u;
+	REQUIRE(queue.TryTake(takenSlotIndex) == true);
+	REQUIRE(queue.GetSlot(takenSlotIndex).m_value == 0u);
+
+	// Nothing is free until a taken slot is released, and then that one is reused.
+	REQUIRE(queue.TryAcquire(overflowSlotIndex) == false);
+	REQUIRE(queue.TakeDroppedCount() == 1u);
+	queue.Release(takenSlotIndex);
+
+	unsigned int reusedSlotIndex = kSlotCount;
+	REQUIRE(queue.TryAcquire(reusedSlotIndex) == true);
+	REQUIRE(reusedSlotIndex == takenSlotIndex);
+	queue.GetSlot(reusedSlotIndex).m_value = kSlotCount;
+	queue.Queue(reusedSlotIndex);
+
+	for (unsigned int value = 1u; value <= kSlotCount; value++)
+	{
+		REQUIRE(queue.TryTake(takenSlotIndex) == true);
+		REQUIRE(queue.GetSlot(takenSlotIndex).m_value == value);
+		queue.Release(takenSlotIndex);
+	}
+
+	REQUIRE(queue.TryTake(takenSlotIndex) == false);
+	REQUIRE(queue.TakeDroppedCount() == 0u);
+
+	// Resetting frees every slot and forgets what was dropped.
+	REQUIRE(queue.TryAcquire(takenSlotIndex) == true);
+	queue.Queue(takenSlotIndex);
+	REQUIRE(queue.TryAcquire(takenSlotIndex) == true);
+	queue.Reset();
+	REQUIRE(queue.TryTake(takenSlotIndex) == false);
+
+	for (std::size_t count = 0u; count < kSlotCount; count++)
+	{
+		REQUIRE(queue.TryAcquire(takenSlotIndex) == true);
+	}
+
+	REQUIRE(queue.TryAcquire(takenSlotIndex) == false);
+}
+
+TEST_CASE("Test topic router", "[topic_router]")
+{
+	TopicRouter router;
+
+	// Count how many times each pattern's handler is called.
+	std::vector<unsigned int> callCounts(5, 0);
+	auto const CountCall = [&](unsigned int patternIndex)
+	{
+		return [&callCounts, patternIndex](std::string_view /* topic */, char* /* payload */)
+		{
+			callCounts[patternIndex]++;
+		};
+	};
+
+	REQUIRE(router.Add("hermes/intent/#", CountCall(0)) == true);
+	REQUIRE(router.Add("hermes/tts/sayFinished", CountCall(1)) == true);
+	REQUIRE(router.Add("hermes/+/sayFinished", CountCall(2)) == true);
+	REQUIRE(router.Add("sandman/+/state", CountCall(3)) == true);
+	REQUIRE(router.Add("#", CountCall(4)) == true);
+
+	// Wildcards have to be whole segments, and nothing can follow "#".
+	REQUIRE(router.Add("", CountCall(0)) == false);
+	REQUIRE(router.Add("hermes/intent#", CountCall(0)) == false);
+	REQUIRE(router.Add("hermes/#/intent", CountCall(0)) == false);
+	REQUIRE(router.Add("sandman/bed+", CountCall(0)) == false);
+	REQUIRE(router.GetPatterns().size() == 5);
+
+	char payload[] = "{}";
+
+	REQUIRE(router.Dispatch("hermes/tts/sayFinished", payload) == 3);
+	REQUIRE(callCounts == std::vector<unsigned int>{ 0, 1, 1, 0, 1 });
+
+	// "#" matches the parent level too.
+	REQUIRE(router.Dispatch("hermes/intent", payload) == 2);
+	REQUIRE(router.Dispatch("hermes/intent/MovePart", payload) == 2);
+	REQUIRE(callCounts == std::vector<unsigned int>{ 2, 1, 1, 0, 3 });
+
+	// "+" matches exactly one segment.
+	REQUIRE(router.Dispatch("sandman/bed/state", payload) == 2);
+	REQUIRE(router.Dispatch("sandman/bed/back/state", payload) == 1);
+	REQUIRE(router.Dispatch("sandman/state", payload) == 1);
+	REQUIRE(callCounts == std::vector<unsigned int>{ 2, 1, 1, 1, 6 });
+
+	REQUIRE(router.Matches("hermes/tts/say") == true);
+
+	router.Clear();
+	REQUIRE(router.Matches("hermes/tts/say") == false);
+	REQUIRE(router.Add("hermes/tts/+", CountCall(1)) == true);
+	REQUIRE(router.Matches("hermes/tts/say") == true);
+	REQUIRE(router.Matches("hermes/tts") == false);
+	REQUIRE(router.Dispatch("hermes/audioServer/default/playBytes", payload) == 0);
+
+	// Handlers of overlapping patterns each see the payload as it arrived, even though they change
+	// it.
+	std::vector<std::string> seenPayloads;
+	auto const SeeAndClobber = [&seenPayloads](std::string_view /* topic */, char* handlerPayload)
+	{
+		seenPayloads.emplace_back(handlerPayload);
+		handlerPayload[0] = '\0';
+	};
+
+	router.Clear();
+	REQUIRE(router.Add("hermes/intent/+", SeeAndClobber) == true);
+	REQUIRE(router.Add("hermes/intent/#", SeeAndClobber) == true);
+	REQUIRE(router.Add("hermes/#", SeeAndClobber) == true);
+
+	char intentPayload[] = "{\"input\":\"back up\"}";
+	REQUIRE(router.Dispatch("hermes/intent/MovePart", intentPayload) == 3);
+	REQUIRE(seenPayloads == std::vector<std::string>(3, "{\"input\":\"back up\"}"));
+}
+
+TEST_CASE("Test socket server", "[server]")
+{
+	REQUIRE(ReactorInitialize() == true);
+
+	std::string const socketFilename = SANDMAN_TEST_BUILD_DIR "test.sock";
+
+	// Echo every message back.
+	auto const Echo = [](std::string const& message, std::string& response)
+	{
+		response = "got " + message + "\n";
+	};
+
+	REQUIRE(ServerInitialize(socketFilename, Echo) == true);
+
+	// Let the server handle whatever is waiting for it.
+	auto const Pump = []()
+	{
+		for (unsigned int count = 0; count < 5; count++)
+		{
+			auto const deadline = TimerClock::now() + std::chrono::milliseconds(10);
+			ReactorWait(&deadline, nullptr);
+		}
+	};
+
+	// Connect a client.
+	auto const Connect = [&socketFilename]()
+	{
+		auto const clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		std::strncpy(address.sun_path, socketFilename.c_str(), sizeof(address.sun_path) - 1);
+
+		connect(clientSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+		return clientSocket;
+	};
+
+	// Get whatever has been sent to a client so far.
+	auto const Receive = [](int clientSocket)
+	{
+		char buffer[256];
+		auto const numReceivedBytes = recv(clientSocket, buffer, sizeof(buffer), MSG_DONTWAIT);
+		return (numReceivedBytes > 0) ? std::string(buffer, numReceivedBytes) : std::string();
+	};
+
+	auto const firstClient = Connect();
+	auto const secondClient = Connect();
+
+	// Several messages at once, and part of another.
+	std::string const firstText = "one\ntwo\nthr";
+	send(firstClient, firstText.c_str(), firstText.size(), 0);
+
+	std::string const secondText = "x\n";
+	send(secondClient, secondText.c_str(), secondText.size(), 0);
+
+	Pump();
+
+	REQUIRE(ServerGetConnectionCount() == 2);
+	REQUIRE(Receive(firstClient) == "got one\n\ngot two\n\n");
+	REQUIRE(Receive(secondClient) == "got x\n\n");
+
+	// Finish the partial message. The last message doesn't need a newline once we're done sending.
+	std::string const finishText = "ee\nfour";
+	send(firstClient, finishText.c_str(), finishText.size(), 0);
+	shutdown(firstClient, SHUT_WR);
+
+	Pump();
+
+	REQUIRE(Receive(firstClient) == "got three\n\ngot four\n\n");
+	REQUIRE(ServerGetConnectionCount() == 1);
+
+	close(firstClient);
+	close(secondClient);
+
+	Pump();
+
+	REQUIRE(ServerGetConnectionCount() == 0);
+
+	ServerUninitialize();
+	ReactorUninitialize();
+}
+
+TEST_CASE("Test stats histogram", "[stats]")
+{
+	StatsHistogram histogram;
+	REQUIRE(histogram.GetCount() == 0);
+	REQUIRE(histogram.GetPercentileUS(0.5f) == 0);
+
+	// Mostly short durations with one long outlier.
+	for (unsigned int count = 0; count < 99; count++)
+	{
+		histogram.Record(100);
 	}
-}
\ No newline at end of file
+
+	histogram.Record(50'000);
+
+	REQUIRE(histogram.GetCount() == 100);
+	REQUIRE(histogram.GetMaxUS() == 50'000);
+
+	// Percentiles are reported as the top of the bucket they fall in.
+	REQUIRE(histogram.GetPercentileUS(0.50f) >= 100);
+	REQUIRE(histogram.GetPercentileUS(0.50f) < 200);
+	REQUIRE(histogram.GetPercentileUS(0.99f) < 200);
+	REQUIRE(histogram.GetPercentileUS(1.0f) == 50'000);
+
+	histogram.Reset();
+	REQUIRE(histogram.GetCount() == 0);
+	REQUIRE(histogram.GetMaxUS() == 0);
+}
+
+TEST_CASE("Test stats latencies", "[stats]")
+{
+	auto const latencyID = StatsAddLatency("test:latency");
+	REQUIRE(latencyID != kStatsNoLatency);
+	REQUIRE(std::string(StatsGetLatencyName(latencyID)) == "test:latency");
+
+	// Adding the same name again measures into the same histogram.
+	REQUIRE(StatsAddLatency("test:latency") == latencyID);
+	REQUIRE(StatsAddLatency("test:other latency") != latencyID);
+
+	// Unknown latencies are ignored.
+	REQUIRE(std::string(StatsGetLatencyName(kStatsNoLatency)).empty() == true);
+	StatsRecordLatency(kStatsNoLatency, TimerClock::now(), TimerClock::now());
+
+	using namespace std::chrono_literals;
+	auto const startTime = TimerClock::now();
+	StatsRecordLatency(latencyID, startTime, startTime + 3ms);
+
+	std::string summary;
+	StatsGetSummary(summary);
+	REQUIRE(summary.find("test:latency") != std::string::npos);
+
+	// The summary is sent as a socket response, which ends at the first empty line.
+	REQUIRE(summary.empty() == false);
+	REQUIRE(summary.find("\n\n") == std::string::npos);
+	REQUIRE(summary.front() != '\n');
+}
+
+TEST_CASE("Test routine with simulated time", "[routines]")
+{
+	Config config;
+	bool const loaded = config.ReadFromFile(SANDMAN_TEST_DATA_DIR "sandman.conf");
+	REQUIRE(loaded == true);
+
+	// Set up the example routine so that it gets loaded as the routine to run.
+	std::string const baseDirectory = SANDMAN_TEST_BUILD_DIR "simulated/";
+	std::filesystem::create_directories(baseDirectory + "routines/");
+	std::filesystem::copy_file(SANDMAN_TEST_DATA_DIR "example.rtn",
+										baseDirectory + "routines/sandman.rtn",
+										std::filesystem::copy_options::overwrite_existing);
+
+	TimerSetClockSource(kTimerClockSourceSimulated);
+
+	static constexpr bool kEnableGPIO = false;
+	GPIOInitialize(kEnableGPIO);
+
+	ControlsInitialize(config.GetControlConfigs());
+	Control::SetDurations(config.GetControlMaxMovingDurationMS(),
+								 config.GetControlCoolDownDurationMS());
+
+	RoutinesInitialize(baseDirectory);
+	RoutineStart();
+	REQUIRE(RoutineIsRunning() == true);
+
+	Control* legControl = Control::GetByName("legs");
+	REQUIRE(legControl != nullptr);
+
+	// Run a full night, jumping straight to whatever needs processing next.
+	static constexpr std::chrono::hours kNightDuration{ 8 };
+
+	auto const endTime = TimerClock::now() + kNightDuration;
+
+	unsigned int raiseCount = 0;
+	unsigned int lowerCount = 0;
+	auto previousState = Control::kStateIdle;
+
+	while (true)
+	{
+		Time deadline;
+		auto hasDeadline = RoutinesGetNextDeadline(deadline);
+
+		Time controlsDeadline;
+		if ((ControlsGetNextDeadline(controlsDeadline) == true) &&
+			 ((hasDeadline == false) || (controlsDeadline < deadline)))
+		{
+			deadline = controlsDeadline;
+			hasDeadline = true;
+		}
+
+		// The routine always has something coming up, so this only stops at the end of the night.
+		if ((hasDeadline == false) || (deadline > endTime))
+		{
+			break;
+		}
+
+		TimerSetSimulatedTime(deadline);
+
+		RoutinesProcess();
+		ControlsProcess();
+
+		// Count the movements as they start.
+		auto const state = (legControl != nullptr) ? legControl->GetState() :
+			Control::kStateIdle;
+
+		if (state != previousState)
+		{
+			raiseCount += (state == Control::kStateMovingUp) ? 1 : 0;
+			lowerCount += (state == Control::kStateMovingDown) ? 1 : 0;
+			previousState = state;
+		}
+	}
+
+	// The routine raises the legs 20 seconds in, lowers them 25 seconds later, and repeats.
+	static constexpr unsigned int kCycleDurationSec = 20 + 25;
+	static constexpr unsigned int kNightDurationSec =
+		std::chrono::duration_cast<std::chrono::seconds>(kNightDuration).count();
+	REQUIRE(raiseCount == ((kNightDurationSec - 20) / kCycleDurationSec) + 1);
+	REQUIRE(lowerCount == kNightDurationSec / kCycleDurationSec);
+
+	RoutineStop();
+	RoutinesUninitialize();
+	ControlsUninitialize();
+	GPIOUninitialize();
+
+	TimerSetClockSource(kTimerClockSourceReal);
+}